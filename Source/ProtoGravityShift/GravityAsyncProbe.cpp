@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityAsyncProbe.h"
+#include "GravityShiftStats.h"
+
+void FGravityAsyncProbe::RequestLine(UWorld* world, const FVector& start, const FVector& end, ECollisionChannel channel, const FCollisionQueryParams& params)
+{
+	INC_DWORD_STAT(STAT_GravityShift_Traces);
+	Handle = world->AsyncLineTraceByChannel(EAsyncTraceType::Single, start, end, channel, params);
+}
+
+void FGravityAsyncProbe::RequestSweep(UWorld* world, const FVector& start, const FVector& end, const FQuat& rotation, const FCollisionShape& shape,
+	ECollisionChannel channel, const FCollisionQueryParams& params)
+{
+	INC_DWORD_STAT(STAT_GravityShift_Traces);
+	Handle = world->AsyncSweepByChannel(EAsyncTraceType::Single, start, end, rotation, channel, shape, params);
+}
+
+bool FGravityAsyncProbe::Consume(UWorld* world, bool& bOutHit, FHitResult& outHit)
+{
+	if (!Handle.IsValid())
+	{
+		return false;
+	}
+
+	FTraceDatum traceData;
+	const bool bReady = world->QueryTraceData(Handle, traceData);
+	Handle.Invalidate();
+	if (!bReady)
+	{
+		return false;
+	}
+
+	bOutHit = traceData.OutHits.Num() > 0 && traceData.OutHits[0].bBlockingHit;
+	if (bOutHit)
+	{
+		outHit = traceData.OutHits[0];
+	}
+	return true;
+}
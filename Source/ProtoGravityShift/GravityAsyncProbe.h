@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/World.h"
+
+/**
+ * One async scene query that is requested this frame and consumed on the next.
+ * The engine batches every async trace of a frame and runs them on worker threads.
+ */
+struct FGravityAsyncProbe
+{
+	void RequestLine(UWorld* world, const FVector& start, const FVector& end, ECollisionChannel channel, const FCollisionQueryParams& params);
+
+	void RequestSweep(UWorld* world, const FVector& start, const FVector& end, const FQuat& rotation, const FCollisionShape& shape,
+		ECollisionChannel channel, const FCollisionQueryParams& params);
+
+	/** Returns true when last frame's result was available, bOutHit then tells if it blocked */
+	bool Consume(UWorld* world, bool& bOutHit, FHitResult& outHit);
+
+	FORCEINLINE bool IsPending() const { return Handle.IsValid(); }
+
+	/** Drops a pending request, its result would describe a stale situation */
+	FORCEINLINE void Reset() { Handle.Invalidate(); }
+
+private:
+	FTraceHandle Handle;
+};
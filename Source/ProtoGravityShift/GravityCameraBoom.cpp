@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityCameraBoom.h"
+#include "Curves/CurveFloat.h"
+
+UGravityCameraBoom::UGravityCameraBoom()
+{
+	OffsetBlendDuration = DefaultOffsetBlendDuration;
+}
+
+double UGravityCameraBoom::GetTime() const
+{
+	const UWorld* world = GetWorld();
+	return world != nullptr ? world->GetTimeSeconds() : 0.0;
+}
+
+void UGravityCameraBoom::SetOffsets(const FVector& defaultOffset, const FVector& levitatingOffset, UCurveFloat* curve)
+{
+	DefaultOffset = defaultOffset;
+	LevitatingOffset = levitatingOffset;
+	OffsetCurve = curve;
+	OffsetBlendDuration = DefaultOffsetBlendDuration;
+
+	if (OffsetCurve != nullptr)
+	{
+		float minTime = 0;
+		float maxTime = 0;
+		OffsetCurve->GetTimeRange(minTime, maxTime);
+		OffsetBlendDuration = maxTime;
+	}
+}
+
+void UGravityCameraBoom::SetLevitating(bool bLevitating)
+{
+	const double now = GetTime();
+	OffsetAlphaStart = GetOffsetAlpha(now);
+	OffsetAlphaDirection = bLevitating ? 1 : -1;
+	OffsetBlendStartTime = now;
+}
+
+void UGravityCameraBoom::SetGravityUp(const FVector& up, float duration)
+{
+	const FQuat target = FQuat::FindBetweenNormals(FVector::UpVector, up.GetSafeNormal());
+	if (target.Equals(UpRotationTarget))
+	{
+		return;
+	}
+
+	const double now = GetTime();
+	UpRotationStart = GetUpRotation(now);
+	UpRotationTarget = target;
+	UpBlendStartTime = now;
+	UpBlendDuration = duration;
+}
+
+float UGravityCameraBoom::GetOffsetAlpha(double time) const
+{
+	if (OffsetBlendDuration <= 0)
+	{
+		return OffsetAlphaDirection > 0 ? 1 : 0;
+	}
+	return FMath::Clamp(OffsetAlphaStart + (OffsetAlphaDirection * (float)(time - OffsetBlendStartTime) / OffsetBlendDuration), 0.0f, 1.0f);
+}
+
+FQuat UGravityCameraBoom::GetUpRotation(double time) const
+{
+	if (UpBlendDuration <= 0 || time - UpBlendStartTime >= UpBlendDuration)
+	{
+		return UpRotationTarget;
+	}
+	return FQuat::Slerp(UpRotationStart, UpRotationTarget, (float)(time - UpBlendStartTime) / UpBlendDuration);
+}
+
+FRotator UGravityCameraBoom::GetTargetRotation() const
+{
+	// The control rotation is taken as relative to the gravity up
+	const FRotator targetRotation = Super::GetTargetRotation();
+	const FQuat upRotation = GetUpRotation(GetTime());
+	if (upRotation.Equals(FQuat::Identity))
+	{
+		return targetRotation;
+	}
+	return (upRotation * targetRotation.Quaternion()).Rotator();
+}
+
+void UGravityCameraBoom::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	if (OffsetAlphaDirection != 0)
+	{
+		const float alpha = GetOffsetAlpha(GetTime());
+		const float blend = OffsetCurve != nullptr ? OffsetCurve->GetFloatValue(alpha * OffsetBlendDuration) : FMath::SmoothStep(0.0f, 1.0f, alpha);
+		SocketOffset = FMath::Lerp(DefaultOffset, LevitatingOffset, blend);
+
+		// Reached the end of the blend, the offset stays put until the next state change
+		if (alpha == (OffsetAlphaDirection > 0 ? 1.0f : 0.0f))
+		{
+			OffsetAlphaDirection = 0;
+			OffsetAlphaStart = alpha;
+		}
+	}
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+}
+
+void UGravityCameraBoom::UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime)
+{
+	// A lagging arm origin moves every frame anyway
+	if (!bDoTrace || bDoLocationLag)
+	{
+		bHasCachedProbe = false;
+		Super::UpdateDesiredArmLocation(bDoTrace, bDoLocationLag, bDoRotationLag, DeltaTime);
+		return;
+	}
+
+	const FVector armOrigin = GetComponentLocation() + TargetOffset;
+	const FQuat armRotation = GetTargetRotation().Quaternion();
+	const double now = GetTime();
+
+	const bool bReprobe = !bHasCachedProbe
+		|| FVector::DistSquared(armOrigin, CachedArmOrigin) > FMath::Square(ProbeDistanceThreshold)
+		|| armRotation.AngularDistance(CachedArmRotation) > FMath::DegreesToRadians(ProbeAngleThreshold)
+		|| TargetArmLength != CachedArmLength
+		|| !SocketOffset.Equals(CachedSocketOffset)
+		|| now - CachedProbeTime > MaxProbeInterval;
+
+	if (bReprobe)
+	{
+		Super::UpdateDesiredArmLocation(true, bDoLocationLag, bDoRotationLag, DeltaTime);
+
+		bHasCachedProbe = true;
+		CachedArmOrigin = armOrigin;
+		CachedArmRotation = armRotation;
+		CachedArmLength = TargetArmLength;
+		CachedSocketOffset = SocketOffset;
+		CachedProbeTime = now;
+
+		const float unfixedLength = FVector::Dist(UnfixedCameraPosition, PreviousArmOrigin);
+		const FVector socketLocation = GetComponentTransform().TransformPosition(RelativeSocketLocation);
+		CachedProbeFraction = bIsCameraFixed && unfixedLength > UE_KINDA_SMALL_NUMBER ? FVector::Dist(socketLocation, PreviousArmOrigin) / unfixedLength : 1.0f;
+		return;
+	}
+
+	// Same arm as the last probe, shorten it by the same amount instead of sweeping again
+	const float armLength = TargetArmLength;
+	const FVector socketOffset = SocketOffset;
+	TargetArmLength *= CachedProbeFraction;
+	SocketOffset *= CachedProbeFraction;
+	Super::UpdateDesiredArmLocation(false, bDoLocationLag, bDoRotationLag, DeltaTime);
+	TargetArmLength = armLength;
+	SocketOffset = socketOffset;
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "GravityCameraBoom.generated.h"
+
+class UCurveFloat;
+
+/**
+ * Spring arm that keeps the camera upright relative to the character's gravity and blends
+ * its socket offset between the default and levitating framings. Both blends are evaluated
+ * from the time they started, so nothing runs once they are done.
+ * The collision probe is only swept again when the arm moved past a threshold.
+ */
+UCLASS(ClassGroup = Camera, meta = (BlueprintSpawnableComponent))
+class PROTOGRAVITYSHIFT_API UGravityCameraBoom : public USpringArmComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGravityCameraBoom();
+
+	/** Offsets blended by SetLevitating, shaped by curve over its time range or a smoothstep when there is none */
+	void SetOffsets(const FVector& defaultOffset, const FVector& levitatingOffset, UCurveFloat* curve);
+
+	/** Blends towards the levitating offset or back, continuing from wherever the current blend is */
+	void SetLevitating(bool bLevitating);
+
+	/** Rotates the camera frame so up matches the given vector */
+	void SetGravityUp(const FVector& up, float duration);
+
+	virtual FRotator GetTargetRotation() const override;
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime) override;
+
+private:
+	float GetOffsetAlpha(double time) const;
+	FQuat GetUpRotation(double time) const;
+
+	double GetTime() const;
+
+	/** Arm movement in cm below which the last collision probe is reused */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float ProbeDistanceThreshold = 5;
+
+	/** Arm rotation in degrees below which the last collision probe is reused */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float ProbeAngleThreshold = 1;
+
+	/** Probe again after this many seconds anyway, in case something moved into the arm */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float MaxProbeInterval = 0.25f;
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float DefaultOffsetBlendDuration = 0.3f;
+
+	UPROPERTY()
+	UCurveFloat* OffsetCurve = nullptr;
+
+	FVector DefaultOffset = FVector::ZeroVector;
+	FVector LevitatingOffset = FVector::ZeroVector;
+	float OffsetBlendDuration = 0.3f;
+	float OffsetAlphaStart = 0;
+	float OffsetAlphaDirection = 0;
+	double OffsetBlendStartTime = 0;
+
+	FQuat UpRotationStart = FQuat::Identity;
+	FQuat UpRotationTarget = FQuat::Identity;
+	double UpBlendStartTime = 0;
+	float UpBlendDuration = 0;
+
+	bool bHasCachedProbe = false;
+	FVector CachedArmOrigin;
+	FQuat CachedArmRotation;
+	float CachedArmLength;
+	FVector CachedSocketOffset;
+	double CachedProbeTime;
+	/** Part of the arm left by the last probe, 1 when nothing was in the way */
+	float CachedProbeFraction = 1;
+};
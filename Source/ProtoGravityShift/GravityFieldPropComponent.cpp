@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityFieldPropComponent.h"
+#include "GravityFieldSubsystem.h"
+#include "Components/PrimitiveComponent.h"
+
+UGravityFieldPropComponent::UGravityFieldPropComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UGravityFieldPropComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UPrimitiveComponent* root = Cast<UPrimitiveComponent>(GetOwner()->GetRootComponent());
+	if (root == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s needs a primitive root component to be pulled by gravity fields"), *GetNameSafe(GetOwner()));
+		return;
+	}
+
+	if (UGravityFieldSubsystem* fields = GetWorld()->GetSubsystem<UGravityFieldSubsystem>())
+	{
+		fields->RegisterSampler(root, true);
+	}
+}
+
+void UGravityFieldPropComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UPrimitiveComponent* root = Cast<UPrimitiveComponent>(GetOwner()->GetRootComponent());
+	UGravityFieldSubsystem* fields = GetWorld()->GetSubsystem<UGravityFieldSubsystem>();
+	if (root != nullptr && fields != nullptr)
+	{
+		fields->UnregisterSampler(root);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GravityFieldPropComponent.generated.h"
+
+/**
+ * Puts a simulating prop under the gravity fields: its own gravity is turned off and
+ * UGravityFieldSubsystem pushes its root by the field it is in, or by world gravity outside them.
+ */
+UCLASS(ClassGroup = (GravityShift), meta = (BlueprintSpawnableComponent))
+class PROTOGRAVITYSHIFT_API UGravityFieldPropComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGravityFieldPropComponent();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+};
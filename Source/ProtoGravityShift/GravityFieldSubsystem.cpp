@@ -0,0 +1,386 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityFieldSubsystem.h"
+#include "GravityShiftStats.h"
+#include "Components/PrimitiveComponent.h"
+
+static constexpr float FieldCellSize = 5000;
+static constexpr int32 MaxCellsPerField = 512;
+
+// Each kernel takes positions relative to the field origin in structure of arrays, four per
+// iteration, and writes the gravity plus 1 or 0 for inside. count is a multiple of 4
+namespace GravityFieldKernels
+{
+	static void Directional(const FGravityFieldShape& shape, const float* x, const float* y, const float* z, float* gx, float* gy, float* gz, float* inside, int32 count)
+	{
+		const VectorRegister4Float axisXx = VectorSetFloat1((float)shape.AxisX.X);
+		const VectorRegister4Float axisXy = VectorSetFloat1((float)shape.AxisX.Y);
+		const VectorRegister4Float axisXz = VectorSetFloat1((float)shape.AxisX.Z);
+		const VectorRegister4Float axisYx = VectorSetFloat1((float)shape.AxisY.X);
+		const VectorRegister4Float axisYy = VectorSetFloat1((float)shape.AxisY.Y);
+		const VectorRegister4Float axisYz = VectorSetFloat1((float)shape.AxisY.Z);
+		const VectorRegister4Float axisZx = VectorSetFloat1((float)shape.AxisZ.X);
+		const VectorRegister4Float axisZy = VectorSetFloat1((float)shape.AxisZ.Y);
+		const VectorRegister4Float axisZz = VectorSetFloat1((float)shape.AxisZ.Z);
+		const VectorRegister4Float extentX = VectorSetFloat1((float)shape.Extent.X);
+		const VectorRegister4Float extentY = VectorSetFloat1((float)shape.Extent.Y);
+		const VectorRegister4Float extentZ = VectorSetFloat1((float)shape.Extent.Z);
+		const VectorRegister4Float gravityX = VectorSetFloat1((float)shape.AxisZ.X * -shape.Strength);
+		const VectorRegister4Float gravityY = VectorSetFloat1((float)shape.AxisZ.Y * -shape.Strength);
+		const VectorRegister4Float gravityZ = VectorSetFloat1((float)shape.AxisZ.Z * -shape.Strength);
+		const VectorRegister4Float zero = VectorZeroFloat();
+		const VectorRegister4Float one = VectorOneFloat();
+
+		for (int32 i = 0; i < count; i += 4)
+		{
+			const VectorRegister4Float px = VectorLoad(x + i);
+			const VectorRegister4Float py = VectorLoad(y + i);
+			const VectorRegister4Float pz = VectorLoad(z + i);
+
+			const VectorRegister4Float localX = VectorMultiplyAdd(px, axisXx, VectorMultiplyAdd(py, axisXy, VectorMultiply(pz, axisXz)));
+			const VectorRegister4Float localY = VectorMultiplyAdd(px, axisYx, VectorMultiplyAdd(py, axisYy, VectorMultiply(pz, axisYz)));
+			const VectorRegister4Float localZ = VectorMultiplyAdd(px, axisZx, VectorMultiplyAdd(py, axisZy, VectorMultiply(pz, axisZz)));
+
+			VectorRegister4Float mask = VectorBitwiseAnd(VectorCompareLE(VectorAbs(localX), extentX), VectorCompareLE(VectorAbs(localY), extentY));
+			mask = VectorBitwiseAnd(mask, VectorCompareLE(VectorAbs(localZ), extentZ));
+
+			VectorStore(VectorSelect(mask, gravityX, zero), gx + i);
+			VectorStore(VectorSelect(mask, gravityY, zero), gy + i);
+			VectorStore(VectorSelect(mask, gravityZ, zero), gz + i);
+			VectorStore(VectorSelect(mask, one, zero), inside + i);
+		}
+	}
+
+	static void Spherical(const FGravityFieldShape& shape, const float* x, const float* y, const float* z, float* gx, float* gy, float* gz, float* inside, int32 count)
+	{
+		const VectorRegister4Float radiusSq = VectorSetFloat1(FMath::Square(shape.Radius));
+		const VectorRegister4Float minDistanceSq = VectorSetFloat1(FGravityFieldShape::MinDistanceSq);
+		const VectorRegister4Float strength = VectorSetFloat1(shape.bInvert ? shape.Strength : -shape.Strength);
+		const VectorRegister4Float zero = VectorZeroFloat();
+		const VectorRegister4Float one = VectorOneFloat();
+
+		for (int32 i = 0; i < count; i += 4)
+		{
+			const VectorRegister4Float px = VectorLoad(x + i);
+			const VectorRegister4Float py = VectorLoad(y + i);
+			const VectorRegister4Float pz = VectorLoad(z + i);
+
+			const VectorRegister4Float distanceSq = VectorMultiplyAdd(px, px, VectorMultiplyAdd(py, py, VectorMultiply(pz, pz)));
+			const VectorRegister4Float mask = VectorBitwiseAnd(VectorCompareLE(distanceSq, radiusSq), VectorCompareGT(distanceSq, minDistanceSq));
+
+			// Lanes at the centre divide by zero, the mask throws them away
+			const VectorRegister4Float scale = VectorMultiply(VectorReciprocalSqrt(distanceSq), strength);
+
+			VectorStore(VectorSelect(mask, VectorMultiply(px, scale), zero), gx + i);
+			VectorStore(VectorSelect(mask, VectorMultiply(py, scale), zero), gy + i);
+			VectorStore(VectorSelect(mask, VectorMultiply(pz, scale), zero), gz + i);
+			VectorStore(VectorSelect(mask, one, zero), inside + i);
+		}
+	}
+
+	static void Cylindrical(const FGravityFieldShape& shape, const float* x, const float* y, const float* z, float* gx, float* gy, float* gz, float* inside, int32 count)
+	{
+		const VectorRegister4Float axisX = VectorSetFloat1((float)shape.AxisZ.X);
+		const VectorRegister4Float axisY = VectorSetFloat1((float)shape.AxisZ.Y);
+		const VectorRegister4Float axisZ = VectorSetFloat1((float)shape.AxisZ.Z);
+		const VectorRegister4Float halfHeight = VectorSetFloat1(shape.HalfHeight);
+		const VectorRegister4Float radiusSq = VectorSetFloat1(FMath::Square(shape.Radius));
+		const VectorRegister4Float minDistanceSq = VectorSetFloat1(FGravityFieldShape::MinDistanceSq);
+		const VectorRegister4Float strength = VectorSetFloat1(shape.bInvert ? -shape.Strength : shape.Strength);
+		const VectorRegister4Float zero = VectorZeroFloat();
+		const VectorRegister4Float one = VectorOneFloat();
+
+		for (int32 i = 0; i < count; i += 4)
+		{
+			const VectorRegister4Float px = VectorLoad(x + i);
+			const VectorRegister4Float py = VectorLoad(y + i);
+			const VectorRegister4Float pz = VectorLoad(z + i);
+
+			const VectorRegister4Float along = VectorMultiplyAdd(px, axisX, VectorMultiplyAdd(py, axisY, VectorMultiply(pz, axisZ)));
+			const VectorRegister4Float radialX = VectorNegateMultiplyAdd(axisX, along, px);
+			const VectorRegister4Float radialY = VectorNegateMultiplyAdd(axisY, along, py);
+			const VectorRegister4Float radialZ = VectorNegateMultiplyAdd(axisZ, along, pz);
+			const VectorRegister4Float radialSq = VectorMultiplyAdd(radialX, radialX, VectorMultiplyAdd(radialY, radialY, VectorMultiply(radialZ, radialZ)));
+
+			VectorRegister4Float mask = VectorBitwiseAnd(VectorCompareLE(VectorAbs(along), halfHeight), VectorCompareLE(radialSq, radiusSq));
+			mask = VectorBitwiseAnd(mask, VectorCompareGT(radialSq, minDistanceSq));
+
+			const VectorRegister4Float scale = VectorMultiply(VectorReciprocalSqrt(radialSq), strength);
+
+			VectorStore(VectorSelect(mask, VectorMultiply(radialX, scale), zero), gx + i);
+			VectorStore(VectorSelect(mask, VectorMultiply(radialY, scale), zero), gy + i);
+			VectorStore(VectorSelect(mask, VectorMultiply(radialZ, scale), zero), gz + i);
+			VectorStore(VectorSelect(mask, one, zero), inside + i);
+		}
+	}
+}
+
+// Fields
+
+void UGravityFieldSubsystem::RegisterField(AGravityFieldVolume* field)
+{
+	if (!Fields.Contains(field))
+	{
+		Fields.Add(field);
+		Shapes.Add(field->GetShape());
+		bCellsDirty = true;
+	}
+}
+
+void UGravityFieldSubsystem::UnregisterField(AGravityFieldVolume* field)
+{
+	const int32 index = Fields.Find(field);
+	if (index != INDEX_NONE)
+	{
+		// Keep the registration order, it breaks priority ties
+		Fields.RemoveAt(index);
+		Shapes.RemoveAt(index);
+		bCellsDirty = true;
+	}
+}
+
+FIntVector UGravityFieldSubsystem::GetCellCoord(const FVector& location) const
+{
+	return FIntVector(FMath::FloorToInt(location.X / FieldCellSize), FMath::FloorToInt(location.Y / FieldCellSize), FMath::FloorToInt(location.Z / FieldCellSize));
+}
+
+void UGravityFieldSubsystem::RebuildCells()
+{
+	CellFields.Reset();
+	UnboundedFields.Reset();
+
+	for (int32 i = 0; i < Shapes.Num(); i++)
+	{
+		const FIntVector minCell = GetCellCoord(Shapes[i].Bounds.Min);
+		const FIntVector maxCell = GetCellCoord(Shapes[i].Bounds.Max);
+		const FIntVector cellRange = maxCell - minCell + FIntVector(1);
+		if ((int64)cellRange.X * cellRange.Y * cellRange.Z > MaxCellsPerField)
+		{
+			UnboundedFields.Add(i);
+			continue;
+		}
+
+		for (int32 x = minCell.X; x <= maxCell.X; x++)
+		{
+			for (int32 y = minCell.Y; y <= maxCell.Y; y++)
+			{
+				for (int32 z = minCell.Z; z <= maxCell.Z; z++)
+				{
+					CellFields.FindOrAdd(FIntVector(x, y, z)).Add(i);
+				}
+			}
+		}
+	}
+	bCellsDirty = false;
+}
+
+void UGravityFieldSubsystem::EvaluateBatch(TConstArrayView<FVector> locations, TArrayView<FVector> outGravity)
+{
+	GRAVITY_SHIFT_STAT_SCOPE(EvaluateGravityFields);
+	check(locations.Num() == outGravity.Num());
+	INC_DWORD_STAT_BY(STAT_GravityShift_FieldQueries, locations.Num());
+
+	if (bCellsDirty)
+	{
+		RebuildCells();
+	}
+
+	FieldQueries.SetNum(Shapes.Num());
+	for (TArray<int32>& queries : FieldQueries)
+	{
+		queries.Reset();
+	}
+
+	// Bin the queries by the fields that can contain them
+	for (int32 i = 0; i < locations.Num(); i++)
+	{
+		outGravity[i] = FVector::ZeroVector;
+		if (const TArray<int32>* cellFields = CellFields.Find(GetCellCoord(locations[i])))
+		{
+			for (int32 field : *cellFields)
+			{
+				FieldQueries[field].Add(i);
+			}
+		}
+		for (int32 field : UnboundedFields)
+		{
+			FieldQueries[field].Add(i);
+		}
+	}
+
+	BestPriority.Init(MIN_int32, locations.Num());
+	for (int32 field = 0; field < Shapes.Num(); field++)
+	{
+		if (FieldQueries[field].Num() > 0)
+		{
+			EvaluateField(field, locations, outGravity);
+		}
+	}
+}
+
+void UGravityFieldSubsystem::EvaluateField(int32 fieldIndex, TConstArrayView<FVector> locations, TArrayView<FVector> outGravity)
+{
+	const FGravityFieldShape& shape = Shapes[fieldIndex];
+	const TArray<int32>& queries = FieldQueries[fieldIndex];
+
+	// Highest priority wins, ties go to the field registered first
+	if (shape.Shape == EGravityFieldShape::Spline)
+	{
+		// A walk along the segments per query, nothing to gain from lanes
+		for (int32 query : queries)
+		{
+			FVector gravity;
+			if (shape.Priority > BestPriority[query] && shape.Evaluate(locations[query], gravity))
+			{
+				outGravity[query] = gravity;
+				BestPriority[query] = shape.Priority;
+			}
+		}
+		return;
+	}
+
+	// Relative to the origin, so floats keep their precision in large worlds
+	const int32 count = queries.Num();
+	const int32 paddedCount = Align(count, 4);
+	QueryX.SetNumUninitialized(paddedCount, false);
+	QueryY.SetNumUninitialized(paddedCount, false);
+	QueryZ.SetNumUninitialized(paddedCount, false);
+	ResultX.SetNumUninitialized(paddedCount, false);
+	ResultY.SetNumUninitialized(paddedCount, false);
+	ResultZ.SetNumUninitialized(paddedCount, false);
+	ResultInside.SetNumUninitialized(paddedCount, false);
+
+	for (int32 i = 0; i < paddedCount; i++)
+	{
+		const FVector offset = i < count ? locations[queries[i]] - shape.Origin : FVector::ZeroVector;
+		QueryX[i] = (float)offset.X;
+		QueryY[i] = (float)offset.Y;
+		QueryZ[i] = (float)offset.Z;
+	}
+
+	switch (shape.Shape)
+	{
+	case EGravityFieldShape::Directional:
+		GravityFieldKernels::Directional(shape, QueryX.GetData(), QueryY.GetData(), QueryZ.GetData(), ResultX.GetData(), ResultY.GetData(), ResultZ.GetData(), ResultInside.GetData(), paddedCount);
+		break;
+	case EGravityFieldShape::Spherical:
+		GravityFieldKernels::Spherical(shape, QueryX.GetData(), QueryY.GetData(), QueryZ.GetData(), ResultX.GetData(), ResultY.GetData(), ResultZ.GetData(), ResultInside.GetData(), paddedCount);
+		break;
+	case EGravityFieldShape::Cylindrical:
+		GravityFieldKernels::Cylindrical(shape, QueryX.GetData(), QueryY.GetData(), QueryZ.GetData(), ResultX.GetData(), ResultY.GetData(), ResultZ.GetData(), ResultInside.GetData(), paddedCount);
+		break;
+	default:
+		return;
+	}
+
+	for (int32 i = 0; i < count; i++)
+	{
+		const int32 query = queries[i];
+		if (ResultInside[i] != 0 && shape.Priority > BestPriority[query])
+		{
+			outGravity[query] = FVector(ResultX[i], ResultY[i], ResultZ[i]);
+			BestPriority[query] = shape.Priority;
+		}
+	}
+}
+
+// Samplers
+
+void UGravityFieldSubsystem::RegisterSampler(UPrimitiveComponent* component, bool bDrivePhysics)
+{
+	if (component == nullptr || SamplerIndices.Contains(component))
+	{
+		return;
+	}
+
+	FSampler& sampler = Samplers.AddDefaulted_GetRef();
+	sampler.Component = component;
+	sampler.Key = component;
+	sampler.bDrivePhysics = bDrivePhysics;
+	SamplerIndices.Add(component, Samplers.Num() - 1);
+
+	if (bDrivePhysics)
+	{
+		component->SetEnableGravity(false);
+	}
+}
+
+void UGravityFieldSubsystem::UnregisterSampler(UPrimitiveComponent* component)
+{
+	if (const int32* index = SamplerIndices.Find(component))
+	{
+		if (Samplers[*index].bDrivePhysics)
+		{
+			component->SetEnableGravity(true);
+		}
+		RemoveSamplerAt(*index);
+	}
+}
+
+void UGravityFieldSubsystem::RemoveSamplerAt(int32 index)
+{
+	SamplerIndices.Remove(Samplers[index].Key);
+	Samplers.RemoveAtSwap(index);
+	if (index < Samplers.Num())
+	{
+		SamplerIndices.Add(Samplers[index].Key, index);
+	}
+}
+
+bool UGravityFieldSubsystem::GetSampledGravity(const UPrimitiveComponent* component, FVector& outGravity) const
+{
+	const int32* index = SamplerIndices.Find(component);
+	if (index == nullptr || Samplers[*index].Gravity.IsZero())
+	{
+		return false;
+	}
+	outGravity = Samplers[*index].Gravity;
+	return true;
+}
+
+void UGravityFieldSubsystem::Tick(float DeltaTime)
+{
+	for (int32 i = Samplers.Num() - 1; i >= 0; i--)
+	{
+		if (!Samplers[i].Component.IsValid())
+		{
+			RemoveSamplerAt(i);
+		}
+	}
+	if (Samplers.Num() == 0)
+	{
+		return;
+	}
+
+	SampleLocations.Reset(Samplers.Num());
+	for (const FSampler& sampler : Samplers)
+	{
+		SampleLocations.Add(sampler.Component->GetComponentLocation());
+	}
+	SampleGravity.SetNumUninitialized(Samplers.Num());
+	EvaluateBatch(SampleLocations, SampleGravity);
+
+	const FVector worldGravity(0, 0, GetWorld()->GetGravityZ());
+	for (int32 i = 0; i < Samplers.Num(); i++)
+	{
+		FSampler& sampler = Samplers[i];
+		sampler.Gravity = SampleGravity[i];
+
+		UPrimitiveComponent* component = sampler.Component.Get();
+		if (sampler.bDrivePhysics && component->IsSimulatingPhysics())
+		{
+			component->AddForce(sampler.Gravity.IsZero() ? worldGravity : sampler.Gravity, NAME_None, true);
+		}
+	}
+}
+
+TStatId UGravityFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGravityFieldSubsystem, STATGROUP_Tickables);
+}
+
+bool UGravityFieldSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
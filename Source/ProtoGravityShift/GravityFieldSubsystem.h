@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GravityFieldVolume.h"
+#include "GravityFieldSubsystem.generated.h"
+
+/**
+ * Spatial hash of the map's gravity fields. Once per frame it samples the field gravity of
+ * every registered component in one batch: queries are binned by field through the hash and
+ * each field evaluates its queries four at a time, instead of each actor overlapping volumes.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravityFieldSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterField(AGravityFieldVolume* field);
+	void UnregisterField(AGravityFieldVolume* field);
+
+	/** Samples component every frame. Simulating props with bDrivePhysics are also pushed by the result, with their own gravity off */
+	void RegisterSampler(UPrimitiveComponent* component, bool bDrivePhysics);
+	void UnregisterSampler(UPrimitiveComponent* component);
+
+	/** Field gravity at the component as of the last sampling pass, false outside every field */
+	bool GetSampledGravity(const UPrimitiveComponent* component, FVector& outGravity) const;
+
+	/** Gravity in cm/s² at each location, zero outside every field */
+	void EvaluateBatch(TConstArrayView<FVector> locations, TArrayView<FVector> outGravity);
+
+	FORCEINLINE int32 GetNumFields() const { return Shapes.Num(); }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FSampler
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		TObjectKey<UPrimitiveComponent> Key;
+		FVector Gravity = FVector::ZeroVector;
+		bool bDrivePhysics = false;
+	};
+
+	FIntVector GetCellCoord(const FVector& location) const;
+	void RebuildCells();
+	void EvaluateField(int32 fieldIndex, TConstArrayView<FVector> locations, TArrayView<FVector> outGravity);
+	void RemoveSamplerAt(int32 index);
+
+	UPROPERTY()
+	TArray<AGravityFieldVolume*> Fields;
+	TArray<FGravityFieldShape> Shapes;
+
+	/** Fields overlapping each cell, too large fields are tested against every query instead */
+	TMap<FIntVector, TArray<int32>> CellFields;
+	TArray<int32> UnboundedFields;
+	bool bCellsDirty = false;
+
+	TArray<FSampler> Samplers;
+	TMap<TObjectKey<UPrimitiveComponent>, int32> SamplerIndices;
+
+	// Scratch reused by every batch
+	TArray<TArray<int32>> FieldQueries;
+	TArray<int32> BestPriority;
+	TArray<float> QueryX;
+	TArray<float> QueryY;
+	TArray<float> QueryZ;
+	TArray<float> ResultX;
+	TArray<float> ResultY;
+	TArray<float> ResultZ;
+	TArray<float> ResultInside;
+	TArray<FVector> SampleLocations;
+	TArray<FVector> SampleGravity;
+};
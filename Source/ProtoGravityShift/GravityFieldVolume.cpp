@@ -0,0 +1,208 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityFieldVolume.h"
+#include "GravityFieldSubsystem.h"
+#include "Components/BoxComponent.h"
+
+bool FGravityFieldShape::Evaluate(const FVector& location, FVector& outGravity) const
+{
+	const FVector offset = location - Origin;
+
+	switch (Shape)
+	{
+	case EGravityFieldShape::Directional:
+		if (FMath::Abs(offset | AxisX) > Extent.X || FMath::Abs(offset | AxisY) > Extent.Y || FMath::Abs(offset | AxisZ) > Extent.Z)
+		{
+			return false;
+		}
+		outGravity = AxisZ * -Strength;
+		return true;
+
+	case EGravityFieldShape::Spherical:
+	{
+		const double distanceSq = offset.SizeSquared();
+		if (distanceSq > FMath::Square(Radius) || distanceSq <= MinDistanceSq)
+		{
+			return false;
+		}
+		outGravity = offset * ((bInvert ? Strength : -Strength) / FMath::Sqrt(distanceSq));
+		return true;
+	}
+
+	case EGravityFieldShape::Cylindrical:
+	{
+		const double along = offset | AxisZ;
+		const FVector radial = offset - (AxisZ * along);
+		const double radialSq = radial.SizeSquared();
+		if (FMath::Abs(along) > HalfHeight || radialSq > FMath::Square(Radius) || radialSq <= MinDistanceSq)
+		{
+			return false;
+		}
+		outGravity = radial * ((bInvert ? -Strength : Strength) / FMath::Sqrt(radialSq));
+		return true;
+	}
+
+	case EGravityFieldShape::Spline:
+	{
+		double bestDistanceSq = FMath::Square(Radius);
+		int32 bestSegment = INDEX_NONE;
+		double bestAlpha = 0;
+		for (int32 i = 0; i + 1 < SplinePoints.Num(); i++)
+		{
+			const FVector segment = SplinePoints[i + 1] - SplinePoints[i];
+			const FVector closest = FMath::ClosestPointOnSegment(location, SplinePoints[i], SplinePoints[i + 1]);
+			const double distanceSq = FVector::DistSquared(location, closest);
+			if (distanceSq <= bestDistanceSq)
+			{
+				const double segmentSq = segment.SizeSquared();
+				bestDistanceSq = distanceSq;
+				bestSegment = i;
+				bestAlpha = segmentSq > 0 ? ((closest - SplinePoints[i]) | segment) / segmentSq : 0;
+			}
+		}
+		if (bestSegment == INDEX_NONE)
+		{
+			return false;
+		}
+		const FVector up = FMath::Lerp(SplineUps[bestSegment], SplineUps[bestSegment + 1], bestAlpha).GetSafeNormal();
+		outGravity = up * (bInvert ? Strength : -Strength);
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+AGravityFieldVolume::AGravityFieldVolume()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	FieldBounds = CreateDefaultSubobject<UBoxComponent>(TEXT("FieldBounds"));
+	FieldBounds->SetupAttachment(RootComponent);
+	FieldBounds->SetBoxExtent(FVector(1000));
+	FieldBounds->SetCollisionProfileName(TEXT("OverlapAllDynamic"));
+	FieldBounds->SetGenerateOverlapEvents(false);
+	FieldBounds->SetCanEverAffectNavigation(false);
+
+	Spline = CreateDefaultSubobject<USplineComponent>(TEXT("Spline"));
+	Spline->SetupAttachment(RootComponent);
+}
+
+void AGravityFieldVolume::OnConstruction(const FTransform& Transform)
+{
+	Super::OnConstruction(Transform);
+
+	// Fit the box to the shape so the editor shows the field's reach
+	switch (Shape)
+	{
+	case EGravityFieldShape::Spherical:
+		FieldBounds->SetRelativeLocation(FVector::ZeroVector);
+		FieldBounds->SetBoxExtent(FVector(Radius), false);
+		break;
+	case EGravityFieldShape::Cylindrical:
+		FieldBounds->SetRelativeLocation(FVector::ZeroVector);
+		FieldBounds->SetBoxExtent(FVector(Radius, Radius, HalfHeight), false);
+		break;
+	case EGravityFieldShape::Spline:
+	{
+		TArray<FVector> points;
+		TArray<FVector> ups;
+		SampleSpline(points, ups, ESplineCoordinateSpace::Local);
+		const FBox box = FBox(points).ExpandBy(Radius);
+		FieldBounds->SetRelativeLocation(Spline->GetRelativeTransform().TransformPosition(box.GetCenter()));
+		FieldBounds->SetBoxExtent(box.GetExtent(), false);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void AGravityFieldVolume::SetupField(EGravityFieldShape shape, int32 priority, float radius, float halfHeight, const FVector& boxExtent,
+	TConstArrayView<FVector> splinePoints)
+{
+	Shape = shape;
+	Priority = priority;
+	Radius = radius;
+	HalfHeight = halfHeight;
+	if (Shape == EGravityFieldShape::Directional)
+	{
+		FieldBounds->SetBoxExtent(boxExtent);
+	}
+	if (Shape == EGravityFieldShape::Spline && splinePoints.Num() > 1)
+	{
+		Spline->SetSplinePoints(TArray<FVector>(splinePoints), ESplineCoordinateSpace::Local);
+	}
+}
+
+void AGravityFieldVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	FieldShape = BuildShape();
+	if (UGravityFieldSubsystem* fields = GetWorld()->GetSubsystem<UGravityFieldSubsystem>())
+	{
+		fields->RegisterField(this);
+	}
+}
+
+void AGravityFieldVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UGravityFieldSubsystem* fields = GetWorld()->GetSubsystem<UGravityFieldSubsystem>())
+	{
+		fields->UnregisterField(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGravityFieldVolume::SampleSpline(TArray<FVector>& outPoints, TArray<FVector>& outUps, ESplineCoordinateSpace::Type space) const
+{
+	const float length = Spline->GetSplineLength();
+	const int32 count = FMath::Max(2, FMath::CeilToInt32(length / SplineSampleSpacing) + 1);
+	outPoints.Reset(count);
+	outUps.Reset(count);
+	for (int32 i = 0; i < count; i++)
+	{
+		const float distance = length * i / (count - 1);
+		outPoints.Add(Spline->GetLocationAtDistanceAlongSpline(distance, space));
+		outUps.Add(Spline->GetUpVectorAtDistanceAlongSpline(distance, space));
+	}
+}
+
+FGravityFieldShape AGravityFieldVolume::BuildShape() const
+{
+	FGravityFieldShape shape;
+	shape.Shape = Shape;
+	shape.Radius = Radius;
+	shape.HalfHeight = HalfHeight;
+	shape.Strength = Strength;
+	shape.Priority = Priority;
+	shape.bInvert = bInvert;
+	shape.Bounds = FieldBounds->Bounds.GetBox();
+
+	// Directional fields live in the box, the others around the actor
+	const USceneComponent* frame = Shape == EGravityFieldShape::Directional ? (USceneComponent*)FieldBounds : GetRootComponent();
+	const FQuat rotation = frame->GetComponentQuat();
+	shape.Origin = frame->GetComponentLocation();
+	shape.AxisX = rotation.GetAxisX();
+	shape.AxisY = rotation.GetAxisY();
+	shape.AxisZ = rotation.GetAxisZ();
+	shape.Extent = FieldBounds->GetScaledBoxExtent();
+
+	if (Shape == EGravityFieldShape::Spline)
+	{
+		SampleSpline(shape.SplinePoints, shape.SplineUps, ESplineCoordinateSpace::World);
+		shape.Bounds = FBox(shape.SplinePoints).ExpandBy(Radius);
+	}
+	return shape;
+}
+
+bool AGravityFieldVolume::EvaluateAt(const FVector& location, FVector& outGravity) const
+{
+	return FieldShape.Evaluate(location, outGravity);
+}
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Components/SplineComponent.h"
+#include "GravityFieldVolume.generated.h"
+
+class UBoxComponent;
+
+UENUM(BlueprintType)
+enum class EGravityFieldShape : uint8
+{
+	/** Constant pull along the volume's -Z, anywhere inside its box */
+	Directional,
+	/** Pull towards the volume's origin, within Radius. Small planets */
+	Spherical,
+	/** Push away from the volume's Z axis, within Radius and HalfHeight. Rotating stations */
+	Cylindrical,
+	/** Pull along the spline's down vector, within Radius of the spline. Loops and twisting roads */
+	Spline,
+};
+
+/** World space snapshot of a field volume, evaluated by UGravityFieldSubsystem without touching the actor */
+struct FGravityFieldShape
+{
+	EGravityFieldShape Shape = EGravityFieldShape::Directional;
+	FVector Origin = FVector::ZeroVector;
+	FVector AxisX = FVector::ForwardVector;
+	FVector AxisY = FVector::RightVector;
+	FVector AxisZ = FVector::UpVector;
+	FVector Extent = FVector::ZeroVector;
+	float Radius = 0;
+	float HalfHeight = 0;
+	float Strength = 0;
+	int32 Priority = 0;
+	bool bInvert = false;
+	FBox Bounds = FBox(ForceInit);
+
+	TArray<FVector> SplinePoints;
+	TArray<FVector> SplineUps;
+
+	/** Closer to the centre or axis than this the pull has no direction */
+	static constexpr float MinDistanceSq = 1.0f;
+
+	/** Scalar reference of the batched kernels, false outside the field */
+	bool Evaluate(const FVector& location, FVector& outGravity) const;
+};
+
+/**
+ * Placeable region with its own gravity. Characters that go back to ground inside it fall
+ * towards the field instead of world down, and props with a GravityFieldPropComponent are
+ * pulled by it. Where fields overlap the highest Priority wins.
+ * Fields are static, they are captured by UGravityFieldSubsystem when play begins.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API AGravityFieldVolume : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AGravityFieldVolume();
+
+	virtual void OnConstruction(const FTransform& Transform) override;
+
+	/** Captured when play begins */
+	FORCEINLINE const FGravityFieldShape& GetShape() const { return FieldShape; }
+
+	/** Gravity of this field alone at location, false outside it */
+	bool EvaluateAt(const FVector& location, FVector& outGravity) const;
+
+	/**
+	 * Sets up a field spawned from code, between SpawnActorDeferred and FinishSpawning.
+	 * boxExtent sizes directional fields and the local splinePoints shape spline fields
+	 */
+	void SetupField(EGravityFieldShape shape, int32 priority, float radius, float halfHeight, const FVector& boxExtent, TConstArrayView<FVector> splinePoints);
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditAnywhere, Category = GravityField)
+	EGravityFieldShape Shape = EGravityFieldShape::Directional;
+
+	/** Acceleration in cm/s² */
+	UPROPERTY(EditAnywhere, Category = GravityField)
+	float Strength = 980;
+
+	UPROPERTY(EditAnywhere, Category = GravityField)
+	int32 Priority = 0;
+
+	/** Pushes away from planets and pulls towards the axis of stations */
+	UPROPERTY(EditAnywhere, Category = GravityField)
+	bool bInvert = false;
+
+	UPROPERTY(EditAnywhere, Category = GravityField, meta = (EditCondition = "Shape != EGravityFieldShape::Directional", ClampMin = "0"))
+	float Radius = 2000;
+
+	UPROPERTY(EditAnywhere, Category = GravityField, meta = (EditCondition = "Shape == EGravityFieldShape::Cylindrical", ClampMin = "0"))
+	float HalfHeight = 2000;
+
+	/** Distance between the points the spline is flattened to */
+	UPROPERTY(EditAnywhere, Category = GravityField, meta = (EditCondition = "Shape == EGravityFieldShape::Spline", ClampMin = "10"))
+	float SplineSampleSpacing = 200;
+
+	/** Extent of directional fields, fitted to the other shapes. Also what per-actor overlap tests would find */
+	UPROPERTY(VisibleAnywhere, Category = GravityField)
+	UBoxComponent* FieldBounds;
+
+	UPROPERTY(VisibleAnywhere, Category = GravityField)
+	USplineComponent* Spline;
+
+private:
+	FGravityFieldShape BuildShape() const;
+	void SampleSpline(TArray<FVector>& outPoints, TArray<FVector>& outUps, ESplineCoordinateSpace::Type space) const;
+
+	FGravityFieldShape FieldShape;
+};
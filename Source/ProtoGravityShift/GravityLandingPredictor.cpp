@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityLandingPredictor.h"
+#include "GravitySurfaceProxySubsystem.h"
+#include "GravityShiftSim.h"
+
+void FGravityLandingPredictor::Configure(float segmentLength, float maxDistance, int32 segmentsPerFrame)
+{
+	SegmentLength = FMath::Max(segmentLength, 1.0f);
+	MaxDistance = maxDistance;
+	SegmentsPerFrame = FMath::Clamp(segmentsPerFrame, 1, MaxSegmentsPerFrame);
+}
+
+void FGravityLandingPredictor::SetShiftParameters(float startSpeed, float acceleration, float maxSpeed)
+{
+	ShiftStartSpeed = startSpeed;
+	ShiftAcceleration = acceleration;
+	MaxShiftSpeed = maxSpeed;
+}
+
+void FGravityLandingPredictor::Update(UWorld* world, const FVector& start, const FVector& direction, const FQuat& rotation, const FCollisionShape& shape,
+	const FCollisionQueryParams& params)
+{
+	const bool bSameAim = bHasSearch
+		&& FVector::DistSquared(start, SearchStart) <= FMath::Square(ReuseDistance)
+		&& FVector::DotProduct(direction, SearchDirection) >= FMath::Cos(FMath::DegreesToRadians(ReuseAngle));
+
+	if (bSameAim)
+	{
+		if (bSearching)
+		{
+			ConsumeSegments(world);
+		}
+		else if (bApproximate)
+		{
+			// The aim settled on a result partly swept along older aims, search it again properly
+			StartSearch(start, direction, rotation, shape);
+		}
+		else
+		{
+			return;
+		}
+	}
+	else
+	{
+		// Whatever is in flight still counts, it may well complete the search
+		if (bSearching)
+		{
+			ConsumeSegments(world);
+		}
+
+		if (bSearching && FVector::DotProduct(direction, SearchDirection) >= FMath::Cos(FMath::DegreesToRadians(ContinueAngle)))
+		{
+			// The remaining segments follow the new aim, so a moving camera still gets a landing every few frames
+			SearchStart = start;
+			SearchDirection = direction;
+			SearchRotation = rotation;
+			SearchShape = shape;
+			bApproximate = true;
+		}
+		else
+		{
+			// The previous solution stays visible until the new search completes
+			StartSearch(start, direction, rotation, shape);
+		}
+	}
+
+	if (bSearching)
+	{
+		RequestSegments(world, params);
+	}
+}
+
+void FGravityLandingPredictor::StartSearch(const FVector& start, const FVector& direction, const FQuat& rotation, const FCollisionShape& shape)
+{
+	for (FGravityAsyncProbe& probe : Probes)
+	{
+		probe.Reset();
+	}
+	bHasSearch = true;
+	bSearching = true;
+	bApproximate = false;
+	SearchStart = start;
+	SearchDirection = direction;
+	SearchRotation = rotation;
+	SearchShape = shape;
+	NextSegment = 0;
+	NumPendingSegments = 0;
+}
+
+void FGravityLandingPredictor::Reset()
+{
+	for (FGravityAsyncProbe& probe : Probes)
+	{
+		probe.Reset();
+	}
+	bHasSearch = false;
+	bSearching = false;
+	bApproximate = false;
+	NumPendingSegments = 0;
+	Prediction = FGravityLandingPrediction();
+	SolutionSerial = 0;
+}
+
+void FGravityLandingPredictor::ConsumeSegments(UWorld* world)
+{
+	for (int32 i = 0; i < NumPendingSegments; i++)
+	{
+		const int32 segment = FirstPendingSegment + i;
+
+		bool bHit = false;
+		FHitResult hit;
+		if (!Probes[i].Consume(world, bHit, hit))
+		{
+			// Not answered, ask again from this segment on
+			NextSegment = segment;
+			break;
+		}
+
+		if (bHit)
+		{
+			const float segmentStart = segment * SegmentLength;
+			const float segmentLength = FMath::Min(SegmentLength, MaxDistance - segmentStart);
+			Complete(true, hit, segmentStart + (hit.Time * segmentLength));
+			break;
+		}
+		NextSegment = segment + 1;
+	}
+
+	for (FGravityAsyncProbe& probe : Probes)
+	{
+		probe.Reset();
+	}
+	NumPendingSegments = 0;
+
+	if (bSearching && NextSegment * SegmentLength >= MaxDistance)
+	{
+		Complete(false, FHitResult(), MaxDistance);
+	}
+}
+
+void FGravityLandingPredictor::RequestSegments(UWorld* world, const FCollisionQueryParams& params)
+{
+	FirstPendingSegment = NextSegment;
+	NumPendingSegments = 0;
+
+	while (NumPendingSegments < SegmentsPerFrame)
+	{
+		const float segmentStart = (FirstPendingSegment + NumPendingSegments) * SegmentLength;
+		if (segmentStart >= MaxDistance)
+		{
+			break;
+		}
+
+		const float segmentEnd = FMath::Min(segmentStart + SegmentLength, MaxDistance);
+		Probes[NumPendingSegments].RequestSweep(world, SearchStart + (SearchDirection * segmentStart), SearchStart + (SearchDirection * segmentEnd),
+			SearchRotation, SearchShape, UGravitySurfaceProxySubsystem::GetTraceChannel(), params);
+		NumPendingSegments++;
+	}
+}
+
+void FGravityLandingPredictor::Complete(bool bHit, const FHitResult& hit, float distance)
+{
+	bSearching = false;
+
+	Prediction.bHit = bHit;
+	Prediction.Distance = distance;
+	Prediction.TimeToLand = CalculateTimeToLand(distance);
+	Prediction.Location = bHit ? hit.Location : SearchStart + (SearchDirection * distance);
+	Prediction.ImpactPoint = bHit ? hit.ImpactPoint : Prediction.Location;
+	Prediction.ImpactNormal = bHit ? hit.ImpactNormal : -SearchDirection;
+	SolutionSerial++;
+}
+
+float FGravityLandingPredictor::CalculateTimeToLand(float distance) const
+{
+	// Same integration as PhysShiftFall
+	return (float)GravityShiftSim::GetShiftTime(distance, ShiftStartSpeed, ShiftAcceleration, MaxShiftSpeed);
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GravityAsyncProbe.h"
+
+struct FGravityLandingPrediction
+{
+	bool bHit = false;
+	/** Capsule centre once it touches the surface */
+	FVector Location = FVector::ZeroVector;
+	FVector ImpactPoint = FVector::ZeroVector;
+	FVector ImpactNormal = FVector::UpVector;
+	float Distance = 0;
+	/** Seconds the accelerating shift takes to cover Distance */
+	float TimeToLand = 0;
+};
+
+/**
+ * Finds where a shift along a direction would land by sweeping the capsule along it segment by segment.
+ * A few segments are requested per frame through the async trace batch, so a long shift is resolved
+ * over several frames without blocking the game thread. The solution is kept while the aim barely moves.
+ * While the aim keeps moving the search carries on along the latest aim instead of starting over, and
+ * once the aim settles the result is searched again along it.
+ */
+struct FGravityLandingPredictor
+{
+	static constexpr int32 MaxSegmentsPerFrame = 4;
+
+	void Configure(float segmentLength, float maxDistance, int32 segmentsPerFrame);
+	void SetShiftParameters(float startSpeed, float acceleration, float maxSpeed);
+
+	void Update(UWorld* world, const FVector& start, const FVector& direction, const FQuat& rotation, const FCollisionShape& shape,
+		const FCollisionQueryParams& params);
+
+	/** Drops the current search, the next Update starts a new one */
+	void Reset();
+
+	FORCEINLINE bool HasPrediction() const { return SolutionSerial > 0; }
+	FORCEINLINE const FGravityLandingPrediction& GetPrediction() const { return Prediction; }
+
+	/** Increases every time a search completes, to tell when the prediction changed */
+	FORCEINLINE uint32 GetSolutionSerial() const { return SolutionSerial; }
+
+	float CalculateTimeToLand(float distance) const;
+
+	/** Aim changes below these reuse the current solution */
+	float ReuseDistance = 5;
+	float ReuseAngle = 0.5f;
+
+	/** Aim changes below this many degrees carry a search on along the new aim, larger ones start over */
+	float ContinueAngle = 10;
+
+private:
+	void StartSearch(const FVector& start, const FVector& direction, const FQuat& rotation, const FCollisionShape& shape);
+	void ConsumeSegments(UWorld* world);
+	void RequestSegments(UWorld* world, const FCollisionQueryParams& params);
+	void Complete(bool bHit, const FHitResult& hit, float distance);
+
+	float SegmentLength = 1500;
+	float MaxDistance = 9000;
+	int32 SegmentsPerFrame = 2;
+
+	float ShiftStartSpeed = 980;
+	float ShiftAcceleration = 20;
+	float MaxShiftSpeed = 10000;
+
+	bool bHasSearch = false;
+	bool bSearching = false;
+	/** Some segments were swept along an earlier aim than the current one */
+	bool bApproximate = false;
+	FVector SearchStart;
+	FVector SearchDirection;
+	FQuat SearchRotation;
+	FCollisionShape SearchShape;
+
+	int32 NextSegment = 0;
+	int32 FirstPendingSegment = 0;
+	int32 NumPendingSegments = 0;
+	FGravityAsyncProbe Probes[MaxSegmentsPerFrame];
+
+	FGravityLandingPrediction Prediction;
+	uint32 SolutionSerial = 0;
+};
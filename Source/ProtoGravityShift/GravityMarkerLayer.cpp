@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityMarkerLayer.h"
+#include "Rendering/DrawElements.h"
+#include "Widgets/SOverlay.h"
+
+// Far enough off screen to be culled at any resolution
+static constexpr float MarkerParkedOffset = -100000;
+// Moves below this many slate units keep the last render transform
+static constexpr float MarkerMoveThreshold = 0.5f;
+// Turns below this many degrees and scale changes below this fraction keep it too
+static constexpr float MarkerTurnThreshold = 1.0f;
+static constexpr float MarkerScaleThreshold = 0.02f;
+
+void SGravityMarker::Construct(const FArguments& InArgs)
+{
+	Brush = InArgs._Brush;
+	SetVisibility(EVisibility::HitTestInvisible);
+	// Turned and scaled around its centre
+	SetRenderTransformPivot(FVector2D(0.5f, 0.5f));
+}
+
+void SGravityMarker::SetBrush(const FSlateBrush* brush)
+{
+	// Also when the pointer stays, the brush behind it may have changed
+	Brush = brush;
+	Invalidate(EInvalidateWidgetReason::Layout);
+}
+
+int32 SGravityMarker::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements,
+	int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	if (Brush != nullptr && Brush->DrawAs != ESlateBrushDrawType::NoDrawType)
+	{
+		const FLinearColor tint = InWidgetStyle.GetColorAndOpacityTint() * Brush->GetTint(InWidgetStyle);
+		FSlateDrawElement::MakeBox(OutDrawElements, LayerId, AllottedGeometry.ToPaintGeometry(), Brush, ESlateDrawEffect::None, tint);
+	}
+	return LayerId;
+}
+
+FVector2D SGravityMarker::ComputeDesiredSize(float LayoutScaleMultiplier) const
+{
+	return Brush != nullptr ? FVector2D(Brush->ImageSize) : FVector2D::ZeroVector;
+}
+
+void SGravityMarkerLayer::Construct(const FArguments& InArgs)
+{
+	SetVisibility(EVisibility::HitTestInvisible);
+
+	ChildSlot
+	[
+		SAssignNew(Overlay, SOverlay)
+	];
+}
+
+void SGravityMarkerLayer::SetBrush(EGravityMarkerKind kind, const FSlateBrush* brush)
+{
+	FPool& pool = Pools[(int32)kind];
+	pool.Brush = brush;
+	for (FMarker& marker : pool.Markers)
+	{
+		marker.Widget->SetBrush(brush);
+		marker.bParked = true;
+		MoveMarker(marker, FVector2D(MarkerParkedOffset));
+	}
+}
+
+void SGravityMarkerLayer::BeginUpdate()
+{
+	for (FPool& pool : Pools)
+	{
+		pool.Used = 0;
+	}
+	NumPlaced = 0;
+	NumTransformUpdates = 0;
+	NumPoolGrowths = 0;
+}
+
+void SGravityMarkerLayer::PlaceMarker(EGravityMarkerKind kind, const FVector2D& position, float angle, float scale)
+{
+	FPool& pool = Pools[(int32)kind];
+	if (pool.Used == pool.Markers.Num())
+	{
+		// The only change that lays the layer out again
+		FMarker& marker = pool.Markers.AddDefaulted_GetRef();
+		Overlay->AddSlot()
+			.HAlign(HAlign_Left)
+			.VAlign(VAlign_Top)
+			[
+				SAssignNew(marker.Widget, SGravityMarker)
+				.Brush(pool.Brush)
+			];
+		NumPoolGrowths++;
+	}
+
+	FMarker& marker = pool.Markers[pool.Used++];
+	const FVector2D halfSize = pool.Brush != nullptr ? FVector2D(pool.Brush->ImageSize) * 0.5f : FVector2D::ZeroVector;
+	const FVector2D translation = position - halfSize;
+	if (marker.bParked || FVector2D::DistSquared(marker.Translation, translation) > FMath::Square(MarkerMoveThreshold)
+		|| FMath::Abs(FMath::FindDeltaAngleDegrees(marker.Angle, angle)) > MarkerTurnThreshold || FMath::Abs(marker.Scale - scale) > MarkerScaleThreshold)
+	{
+		marker.bParked = false;
+		MoveMarker(marker, translation, angle, scale);
+	}
+	NumPlaced++;
+}
+
+void SGravityMarkerLayer::EndUpdate()
+{
+	for (FPool& pool : Pools)
+	{
+		for (int32 i = pool.Used; i < pool.Markers.Num(); i++)
+		{
+			FMarker& marker = pool.Markers[i];
+			if (!marker.bParked)
+			{
+				marker.bParked = true;
+				MoveMarker(marker, FVector2D(MarkerParkedOffset));
+			}
+		}
+	}
+}
+
+void SGravityMarkerLayer::MoveMarker(FMarker& marker, const FVector2D& translation, float angle, float scale)
+{
+	marker.Translation = translation;
+	marker.Angle = angle;
+	marker.Scale = scale;
+	const FMatrix2x2f turnAndScale = Concatenate(FScale2f(scale), FQuat2f(FMath::DegreesToRadians(angle)));
+	marker.Widget->SetRenderTransform(FSlateRenderTransform(turnAndScale, FVector2f(translation)));
+	NumTransformUpdates++;
+}
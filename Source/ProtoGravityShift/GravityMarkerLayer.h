@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SCompoundWidget.h"
+#include "Widgets/SLeafWidget.h"
+
+class SOverlay;
+
+enum class EGravityMarkerKind : uint8
+{
+	/** Where the local player is aiming */
+	Aim,
+	/** Where the local player's shift would land */
+	Landing,
+	/** Where another shifter is about to land, shown to every local player */
+	Telegraph,
+	Num,
+};
+
+/** One marker, draws its brush and nothing else */
+class SGravityMarker : public SLeafWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SGravityMarker)
+		: _Brush(nullptr)
+	{}
+		SLATE_ARGUMENT(const FSlateBrush*, Brush)
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+
+	void SetBrush(const FSlateBrush* brush);
+
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements,
+		int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+
+protected:
+	virtual FVector2D ComputeDesiredSize(float LayoutScaleMultiplier) const override;
+
+private:
+	const FSlateBrush* Brush = nullptr;
+};
+
+/**
+ * Every gravity marker on screen, drawn from a pool per kind. Markers are placed anew each frame
+ * between BeginUpdate and EndUpdate. A marker only changes its render transform when it moves, turns or scales,
+ * and the ones left over are parked off screen instead of hidden, so after the pool has grown
+ * the layer is never laid out again and suits invalidation panels.
+ */
+class SGravityMarkerLayer : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS(SGravityMarkerLayer)
+	{}
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+
+	/** brush has to outlive the layer */
+	void SetBrush(EGravityMarkerKind kind, const FSlateBrush* brush);
+
+	void BeginUpdate();
+
+	/** Centres the next marker of kind on position, in layer space, turned clockwise by angle in degrees and scaled around its centre */
+	void PlaceMarker(EGravityMarkerKind kind, const FVector2D& position, float angle = 0, float scale = 1);
+
+	/** Parks every marker that wasn't placed since BeginUpdate */
+	void EndUpdate();
+
+	/** Markers placed, render transforms changed and markers added to the pool by the last update */
+	FORCEINLINE int32 GetNumPlaced() const { return NumPlaced; }
+	FORCEINLINE int32 GetNumTransformUpdates() const { return NumTransformUpdates; }
+	FORCEINLINE int32 GetNumPoolGrowths() const { return NumPoolGrowths; }
+
+private:
+	struct FMarker
+	{
+		TSharedPtr<SGravityMarker> Widget;
+		FVector2D Translation = FVector2D::ZeroVector;
+		float Angle = 0;
+		float Scale = 1;
+		bool bParked = true;
+	};
+
+	struct FPool
+	{
+		TArray<FMarker> Markers;
+		int32 Used = 0;
+		const FSlateBrush* Brush = nullptr;
+	};
+
+	void MoveMarker(FMarker& marker, const FVector2D& translation, float angle = 0, float scale = 1);
+
+	TSharedPtr<SOverlay> Overlay;
+	FPool Pools[(int32)EGravityMarkerKind::Num];
+
+	int32 NumPlaced = 0;
+	int32 NumTransformUpdates = 0;
+	int32 NumPoolGrowths = 0;
+};
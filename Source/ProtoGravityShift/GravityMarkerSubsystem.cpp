@@ -0,0 +1,223 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityMarkerSubsystem.h"
+#include "GravityMarkerLayer.h"
+#include "GravityShiftStats.h"
+#include "Engine/GameInstance.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Widgets/SInvalidationPanel.h"
+
+// Under UMG widgets added to the viewport with the default order of 0
+static constexpr int32 MarkerLayerZOrder = -10;
+// World length of the surface normal projected to turn landing markers
+static constexpr float LandingNormalLength = 50;
+// Landings this many seconds or more away are drawn at LandingFarScale, growing to full size on touchdown
+static constexpr float LandingFarTime = 1.5f;
+static constexpr float LandingFarScale = 0.5f;
+
+FGravityMarkerStyle::FGravityMarkerStyle()
+{
+	AimBrush.ImageSize = FVector2D(12, 12);
+	LandingBrush.ImageSize = FVector2D(32, 32);
+	LandingBrush.TintColor = FLinearColor(0.3f, 0.8f, 1.0f, 0.8f);
+	TelegraphBrush.ImageSize = FVector2D(32, 32);
+	TelegraphBrush.TintColor = FLinearColor(1.0f, 0.35f, 0.2f, 0.8f);
+}
+
+bool FGravityMarkerStyle::operator==(const FGravityMarkerStyle& other) const
+{
+	return AimBrush == other.AimBrush && LandingBrush == other.LandingBrush && TelegraphBrush == other.TelegraphBrush;
+}
+
+void UGravityMarkerSubsystem::SetStyle(const FGravityMarkerStyle& style)
+{
+	if (Style == style)
+	{
+		return;
+	}
+
+	Style = style;
+	if (Layer.IsValid())
+	{
+		Layer->SetBrush(EGravityMarkerKind::Aim, &Style.AimBrush);
+		Layer->SetBrush(EGravityMarkerKind::Landing, &Style.LandingBrush);
+		Layer->SetBrush(EGravityMarkerKind::Telegraph, &Style.TelegraphBrush);
+	}
+}
+
+void UGravityMarkerSubsystem::SetAimMarker(const APawn* owner, bool bVisible, const FVector& location)
+{
+	FMarkerSource& source = FindOrAddSource(owner);
+	source.bAim = bVisible;
+	source.AimLocation = location;
+}
+
+void UGravityMarkerSubsystem::SetLandingMarker(const APawn* owner, bool bVisible, const FVector& location, const FVector& normal, float timeToLand)
+{
+	FMarkerSource& source = FindOrAddSource(owner);
+	source.bLanding = bVisible;
+	source.LandingLocation = location;
+	source.LandingNormal = normal;
+	source.TimeToLand = timeToLand;
+}
+
+void UGravityMarkerSubsystem::RemoveMarkers(const APawn* owner)
+{
+	Sources.RemoveAllSwap([owner](const FMarkerSource& source) { return source.Owner == owner; });
+}
+
+UGravityMarkerSubsystem::FMarkerSource& UGravityMarkerSubsystem::FindOrAddSource(const APawn* owner)
+{
+	for (FMarkerSource& source : Sources)
+	{
+		if (source.Owner == owner)
+		{
+			return source;
+		}
+	}
+
+	FMarkerSource& source = Sources.AddDefaulted_GetRef();
+	source.Owner = owner;
+	return source;
+}
+
+void UGravityMarkerSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// No viewport when running headless, e.g. in the benchmark commandlet
+	Viewport = InWorld.GetGameViewport();
+	if (!Viewport.IsValid())
+	{
+		return;
+	}
+
+	Layer = SNew(SGravityMarkerLayer);
+	Layer->SetBrush(EGravityMarkerKind::Aim, &Style.AimBrush);
+	Layer->SetBrush(EGravityMarkerKind::Landing, &Style.LandingBrush);
+	Layer->SetBrush(EGravityMarkerKind::Telegraph, &Style.TelegraphBrush);
+
+	// Marker moves only repaint the markers themselves, not the rest of the HUD
+	LayerRoot = SNew(SInvalidationPanel)
+		[
+			Layer.ToSharedRef()
+		];
+	Viewport->AddViewportWidgetContent(LayerRoot.ToSharedRef(), MarkerLayerZOrder);
+}
+
+void UGravityMarkerSubsystem::Deinitialize()
+{
+	if (Viewport.IsValid() && LayerRoot.IsValid())
+	{
+		Viewport->RemoveViewportWidgetContent(LayerRoot.ToSharedRef());
+	}
+	LayerRoot.Reset();
+	Layer.Reset();
+	Sources.Empty();
+
+	Super::Deinitialize();
+}
+
+void UGravityMarkerSubsystem::Tick(float DeltaTime)
+{
+	const UGameInstance* gameInstance = GetWorld()->GetGameInstance();
+	if (!Layer.IsValid() || !Viewport.IsValid() || gameInstance == nullptr)
+	{
+		return;
+	}
+
+	GRAVITY_SHIFT_STAT_SCOPE(UpdateMarkers);
+
+	Sources.RemoveAllSwap([](const FMarkerSource& source) { return !source.Owner.IsValid(); });
+
+	// Projections come out in viewport pixels, the layer is laid out in DPI scaled units
+	FVector2D viewportSize;
+	Viewport->GetViewportSize(viewportSize);
+	const FVector2D layerSize = Layer->GetTickSpaceGeometry().GetLocalSize();
+	if (viewportSize.X <= 0 || viewportSize.Y <= 0 || layerSize.X <= 0 || layerSize.Y <= 0)
+	{
+		return;
+	}
+	const FVector2D pixelsToLayer = layerSize / viewportSize;
+
+	Layer->BeginUpdate();
+	for (const ULocalPlayer* localPlayer : gameInstance->GetLocalPlayers())
+	{
+		APlayerController* playerController = localPlayer != nullptr ? localPlayer->GetPlayerController(GetWorld()) : nullptr;
+		if (playerController == nullptr)
+		{
+			continue;
+		}
+
+		// Each split-screen player only gets markers inside its own part of the viewport
+		const FVector2D viewMin = localPlayer->Origin * viewportSize;
+		const FVector2D viewMax = viewMin + (localPlayer->Size * viewportSize);
+		auto isInView = [&](const FVector& location, FVector2D& outScreenLocation)
+		{
+			return playerController->ProjectWorldLocationToScreen(location, outScreenLocation, false)
+				&& outScreenLocation.X >= viewMin.X && outScreenLocation.Y >= viewMin.Y && outScreenLocation.X < viewMax.X && outScreenLocation.Y < viewMax.Y;
+		};
+		auto placeMarker = [&](EGravityMarkerKind kind, const FVector& location)
+		{
+			FVector2D screenLocation;
+			if (isInView(location, screenLocation))
+			{
+				Layer->PlaceMarker(kind, screenLocation * pixelsToLayer);
+			}
+		};
+		auto placeLandingMarker = [&](EGravityMarkerKind kind, const FMarkerSource& source)
+		{
+			FVector2D screenLocation;
+			if (!isInView(source.LandingLocation, screenLocation))
+			{
+				return;
+			}
+
+			// A normal facing the camera projects to nearly nothing and keeps the marker upright
+			float angle = 0;
+			FVector2D screenNormalEnd;
+			if (playerController->ProjectWorldLocationToScreen(source.LandingLocation + (source.LandingNormal * LandingNormalLength), screenNormalEnd, false))
+			{
+				const FVector2D screenNormal = screenNormalEnd - screenLocation;
+				if (!screenNormal.IsNearlyZero(1.0f))
+				{
+					angle = FMath::RadiansToDegrees(FMath::Atan2(screenNormal.Y, screenNormal.X));
+				}
+			}
+			const float scale = FMath::Lerp(1.0f, LandingFarScale, FMath::Clamp(source.TimeToLand / LandingFarTime, 0.0f, 1.0f));
+			Layer->PlaceMarker(kind, screenLocation * pixelsToLayer, angle, scale);
+		};
+
+		for (const FMarkerSource& source : Sources)
+		{
+			const bool bOwnMarker = source.Owner->GetController() == playerController;
+			if (bOwnMarker && source.bAim)
+			{
+				placeMarker(EGravityMarkerKind::Aim, source.AimLocation);
+			}
+			if (source.bLanding)
+			{
+				placeLandingMarker(bOwnMarker ? EGravityMarkerKind::Landing : EGravityMarkerKind::Telegraph, source);
+			}
+		}
+	}
+	Layer->EndUpdate();
+
+	INC_DWORD_STAT_BY(STAT_GravityShift_MarkersPlaced, Layer->GetNumPlaced());
+	INC_DWORD_STAT_BY(STAT_GravityShift_MarkerTransformUpdates, Layer->GetNumTransformUpdates());
+	INC_DWORD_STAT_BY(STAT_GravityShift_MarkerPoolGrowths, Layer->GetNumPoolGrowths());
+}
+
+TStatId UGravityMarkerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGravityMarkerSubsystem, STATGROUP_Tickables);
+}
+
+bool UGravityMarkerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Styling/SlateBrush.h"
+#include "GravityMarkerSubsystem.generated.h"
+
+class SGravityMarkerLayer;
+class SWidget;
+class UGameViewportClient;
+
+USTRUCT(BlueprintType)
+struct PROTOGRAVITYSHIFT_API FGravityMarkerStyle
+{
+	GENERATED_BODY()
+
+	FGravityMarkerStyle();
+
+	bool operator==(const FGravityMarkerStyle& other) const;
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	FSlateBrush AimBrush;
+
+	/** Drawn with its +X side along the landing surface normal */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	FSlateBrush LandingBrush;
+
+	/** Where other shifters are about to land, turned like LandingBrush */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	FSlateBrush TelegraphBrush;
+};
+
+/**
+ * Draws the aim and landing markers of every local player, and the landing telegraphs of every
+ * other shifter, in one pooled Slate layer over the game viewport. Shifters only hand over world
+ * locations when they change; each frame the layer projects them for every split-screen player
+ * and moves the markers that changed.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravityMarkerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void SetStyle(const FGravityMarkerStyle& style);
+
+	/** Shows owner's aim at location to the player controlling it */
+	void SetAimMarker(const APawn* owner, bool bVisible, const FVector& location = FVector::ZeroVector);
+
+	/**
+	 * Shows where owner's shift would land, as a landing marker to its own player and a telegraph to the others.
+	 * The marker points along the surface normal and grows as timeToLand runs out.
+	 */
+	void SetLandingMarker(const APawn* owner, bool bVisible, const FVector& location = FVector::ZeroVector, const FVector& normal = FVector::UpVector, float timeToLand = 0);
+
+	void RemoveMarkers(const APawn* owner);
+
+	/** False without a game viewport, e.g. headless, where shifters needn't predict landings for markers */
+	FORCEINLINE bool IsDrawing() const { return Layer.IsValid(); }
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FMarkerSource
+	{
+		TWeakObjectPtr<const APawn> Owner;
+		FVector AimLocation = FVector::ZeroVector;
+		FVector LandingLocation = FVector::ZeroVector;
+		FVector LandingNormal = FVector::UpVector;
+		float TimeToLand = 0;
+		bool bAim = false;
+		bool bLanding = false;
+	};
+
+	FMarkerSource& FindOrAddSource(const APawn* owner);
+
+	UPROPERTY()
+	FGravityMarkerStyle Style;
+
+	TArray<FMarkerSource> Sources;
+
+	TWeakObjectPtr<UGameViewportClient> Viewport;
+	TSharedPtr<SGravityMarkerLayer> Layer;
+	TSharedPtr<SWidget> LayerRoot;
+};
@@ -2,10 +2,3 @@
 
 
 #include "GravityMarkerWidget.h"
-
-void UGravityMarkerWidget::NativeConstruct()
-{
-    Super::NativeConstruct();
-
-    // Bind delegates here.
-}
\ No newline at end of file
@@ -7,13 +7,11 @@
 #include "GravityMarkerWidget.generated.h"
 
 /**
- * 
+ * Per-character marker widget of the Blueprint HUD. Characters no longer create it, their markers
+ * are drawn by UGravityMarkerSubsystem. Kept so existing widget Blueprints still load.
  */
 UCLASS()
 class PROTOGRAVITYSHIFT_API UGravityMarkerWidget : public UUserWidget
 {
 	GENERATED_BODY()
-
-	virtual void NativeConstruct() override;
-
 };
@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityMath.h"
+
+void GravityMath::MakeSurfaceBases(const float* normalX, const float* normalY, const float* normalZ,
+	const float* hintX, const float* hintY, const float* hintZ,
+	float* outX, float* outY, float* outZ, float* outW, int32 count)
+{
+	const VectorRegister4Float zero = VectorZeroFloat();
+	const VectorRegister4Float one = VectorOneFloat();
+	const VectorRegister4Float two = VectorSetFloat1(2.0f);
+	const VectorRegister4Float minusOne = VectorSetFloat1(-1.0f);
+	const VectorRegister4Float minSizeSq = VectorSetFloat1(MinRotationSizeSq);
+	const VectorRegister4Float smallNumber = VectorSetFloat1(UE_SMALL_NUMBER);
+
+	for (int32 i = 0; i < count; i += 4)
+	{
+		const VectorRegister4Float nx = VectorLoad(normalX + i);
+		const VectorRegister4Float ny = VectorLoad(normalY + i);
+		const VectorRegister4Float nz = VectorLoad(normalZ + i);
+
+		// Up to normal, as FindBetweenNormals: (Up x normal, 1 + Up . normal), or a half turn about -Y facing down
+		const VectorRegister4Float upW = VectorAdd(one, nz);
+		const VectorRegister4Float upSizeSq = VectorMultiplyAdd(nx, nx, VectorMultiplyAdd(ny, ny, VectorMultiply(upW, upW)));
+		const VectorRegister4Float upValid = VectorCompareGE(upSizeSq, minSizeSq);
+		const VectorRegister4Float upScale = VectorReciprocalSqrt(VectorSelect(upValid, upSizeSq, one));
+		const VectorRegister4Float ax = VectorSelect(upValid, VectorMultiply(VectorNegate(ny), upScale), zero);
+		const VectorRegister4Float ay = VectorSelect(upValid, VectorMultiply(nx, upScale), minusOne);
+		const VectorRegister4Float aw = VectorSelect(upValid, VectorMultiply(upW, upScale), zero);
+
+		// Its X axis, the Z of the rotation being zero
+		const VectorRegister4Float tx = VectorSubtract(one, VectorMultiply(two, VectorMultiply(ay, ay)));
+		const VectorRegister4Float ty = VectorMultiply(two, VectorMultiply(ax, ay));
+		const VectorRegister4Float tz = VectorNegate(VectorMultiply(two, VectorMultiply(aw, ay)));
+
+		// Hint projected on the surface
+		const VectorRegister4Float hx = VectorLoad(hintX + i);
+		const VectorRegister4Float hy = VectorLoad(hintY + i);
+		const VectorRegister4Float hz = VectorLoad(hintZ + i);
+		const VectorRegister4Float hintDot = VectorMultiplyAdd(hx, nx, VectorMultiplyAdd(hy, ny, VectorMultiply(hz, nz)));
+		VectorRegister4Float fx = VectorNegateMultiplyAdd(nx, hintDot, hx);
+		VectorRegister4Float fy = VectorNegateMultiplyAdd(ny, hintDot, hy);
+		VectorRegister4Float fz = VectorNegateMultiplyAdd(nz, hintDot, hz);
+		const VectorRegister4Float forwardSq = VectorMultiplyAdd(fx, fx, VectorMultiplyAdd(fy, fy, VectorMultiply(fz, fz)));
+		const VectorRegister4Float forwardValid = VectorCompareGT(forwardSq, smallNumber);
+		const VectorRegister4Float forwardScale = VectorReciprocalSqrt(VectorSelect(forwardValid, forwardSq, one));
+		fx = VectorMultiply(fx, forwardScale);
+		fy = VectorMultiply(fy, forwardScale);
+		fz = VectorMultiply(fz, forwardScale);
+
+		// Twist about the normal from the tilted X to the forward
+		const VectorRegister4Float cosAngle = VectorMultiplyAdd(tx, fx, VectorMultiplyAdd(ty, fy, VectorMultiply(tz, fz)));
+		const VectorRegister4Float crossX = VectorNegateMultiplyAdd(tz, fy, VectorMultiply(ty, fz));
+		const VectorRegister4Float crossY = VectorNegateMultiplyAdd(tx, fz, VectorMultiply(tz, fx));
+		const VectorRegister4Float crossZ = VectorNegateMultiplyAdd(ty, fx, VectorMultiply(tx, fy));
+		const VectorRegister4Float sinAngle = VectorMultiplyAdd(crossX, nx, VectorMultiplyAdd(crossY, ny, VectorMultiply(crossZ, nz)));
+		const VectorRegister4Float twistW = VectorAdd(one, cosAngle);
+		const VectorRegister4Float twistSizeSq = VectorMultiplyAdd(sinAngle, sinAngle, VectorMultiply(twistW, twistW));
+		const VectorRegister4Float twistValid = VectorCompareGE(twistSizeSq, minSizeSq);
+		const VectorRegister4Float twistScale = VectorReciprocalSqrt(VectorSelect(twistValid, twistSizeSq, one));
+		const VectorRegister4Float twistSin = VectorSelect(twistValid, VectorMultiply(sinAngle, twistScale), one);
+		const VectorRegister4Float bx = VectorMultiply(nx, twistSin);
+		const VectorRegister4Float by = VectorMultiply(ny, twistSin);
+		const VectorRegister4Float bz = VectorMultiply(nz, twistSin);
+		const VectorRegister4Float bw = VectorSelect(twistValid, VectorMultiply(twistW, twistScale), zero);
+
+		// twist * tilt, keeping the tilt alone where the hint was along the normal
+		const VectorRegister4Float qx = VectorNegateMultiplyAdd(bz, ay, VectorMultiplyAdd(bw, ax, VectorMultiply(bx, aw)));
+		const VectorRegister4Float qy = VectorMultiplyAdd(bz, ax, VectorMultiplyAdd(bw, ay, VectorMultiply(by, aw)));
+		const VectorRegister4Float qz = VectorNegateMultiplyAdd(by, ax, VectorMultiplyAdd(bx, ay, VectorMultiply(bz, aw)));
+		const VectorRegister4Float qw = VectorNegateMultiplyAdd(bx, ax, VectorNegateMultiplyAdd(by, ay, VectorMultiply(bw, aw)));
+
+		VectorStore(VectorSelect(forwardValid, qx, ax), outX + i);
+		VectorStore(VectorSelect(forwardValid, qy, ay), outY + i);
+		VectorStore(VectorSelect(forwardValid, qz, zero), outZ + i);
+		VectorStore(VectorSelect(forwardValid, qw, aw), outW + i);
+	}
+}
+
+void GravityMath::SignedAngles(const float* fromX, const float* fromY, const float* fromZ,
+	const float* toX, const float* toY, const float* toZ,
+	const float* normalX, const float* normalY, const float* normalZ, float* outDegrees, int32 count)
+{
+	const VectorRegister4Float toDegrees = VectorSetFloat1(180.0f / UE_PI);
+
+	for (int32 i = 0; i < count; i += 4)
+	{
+		const VectorRegister4Float ax = VectorLoad(fromX + i);
+		const VectorRegister4Float ay = VectorLoad(fromY + i);
+		const VectorRegister4Float az = VectorLoad(fromZ + i);
+		const VectorRegister4Float bx = VectorLoad(toX + i);
+		const VectorRegister4Float by = VectorLoad(toY + i);
+		const VectorRegister4Float bz = VectorLoad(toZ + i);
+
+		const VectorRegister4Float crossX = VectorNegateMultiplyAdd(az, by, VectorMultiply(ay, bz));
+		const VectorRegister4Float crossY = VectorNegateMultiplyAdd(ax, bz, VectorMultiply(az, bx));
+		const VectorRegister4Float crossZ = VectorNegateMultiplyAdd(ay, bx, VectorMultiply(ax, by));
+
+		const VectorRegister4Float sinAngle = VectorMultiplyAdd(crossX, VectorLoad(normalX + i), VectorMultiplyAdd(crossY, VectorLoad(normalY + i), VectorMultiply(crossZ, VectorLoad(normalZ + i))));
+		const VectorRegister4Float cosAngle = VectorMultiplyAdd(ax, bx, VectorMultiplyAdd(ay, by, VectorMultiply(az, bz)));
+
+		VectorStore(VectorMultiply(VectorATan2(sinAngle, cosAngle), toDegrees), outDegrees + i);
+	}
+}
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Orientation math of the gravity shift, in quaternions only. Each function matches a chain of
+ * Kismet rotator, matrix and trigonometry calls used to orient the capsule and mesh on a surface,
+ * see Tests/GravityMathTests for the equivalence checks and the -Mode=Math benchmark for timings.
+ */
+namespace GravityMath
+{
+	/** Below this a rotation's unnormalized size squared is a half turn, its sine and 1 + cosine both vanishing */
+	constexpr float MinRotationSizeSq = 1e-12f;
+
+	/** Rotation about axis, of an angle given by its cosine and sine, without trigonometry */
+	FORCEINLINE FQuat MakeAxisRotation(const FVector& axis, double cosAngle, double sinAngle)
+	{
+		// (axis * sin, 1 + cos) is the half angle quaternion scaled by 2 cos(angle / 2)
+		const double w = 1.0 + cosAngle;
+		const double sizeSq = (sinAngle * sinAngle) + (w * w);
+		if (sizeSq < MinRotationSizeSq)
+		{
+			return FQuat(axis.X, axis.Y, axis.Z, 0.0);
+		}
+		const double scale = FMath::InvSqrt(sizeSq);
+		return FQuat(axis.X * sinAngle * scale, axis.Y * sinAngle * scale, axis.Z * sinAngle * scale, w * scale);
+	}
+
+	/** Rotation with Z along normal and X along forwardHint projected on the surface, like MakeRotFromZX */
+	FORCEINLINE FQuat MakeSurfaceBasis(const FVector& normal, const FVector& forwardHint)
+	{
+		const FQuat toNormal = FQuat::FindBetweenNormals(FVector::UpVector, normal);
+		const FVector forward = FVector::VectorPlaneProject(forwardHint, normal).GetSafeNormal();
+		if (forward.IsZero())
+		{
+			return toNormal;
+		}
+
+		// Then turn about the normal until the tilted X meets the forward
+		const FVector tiltedX = toNormal.GetAxisX();
+		const double cosAngle = FVector::DotProduct(tiltedX, forward);
+		const double sinAngle = FVector::DotProduct(FVector::CrossProduct(tiltedX, forward), normal);
+		return MakeAxisRotation(normal, cosAngle, sinAngle) * toNormal;
+	}
+
+	/** Yaw only rotation facing direction, like FindLookAtRotation along a level direction */
+	FORCEINLINE FQuat MakeHeadingRotation(const FVector& direction)
+	{
+		const FVector2D level(direction.X, direction.Y);
+		const double length = level.Size();
+		if (length < UE_KINDA_SMALL_NUMBER)
+		{
+			return FQuat::Identity;
+		}
+		return MakeAxisRotation(FVector::UpVector, level.X / length, level.Y / length);
+	}
+
+	/** Degrees from from to to, turning about normal, -180 to 180 */
+	FORCEINLINE double SignedAngle(const FVector& from, const FVector& to, const FVector& normal)
+	{
+		return FMath::RadiansToDegrees(FMath::Atan2(FVector::DotProduct(FVector::CrossProduct(from, to), normal), FVector::DotProduct(from, to)));
+	}
+
+	/** Degrees an input turns away from forward in a right handed forward/right basis: the acos of the dot product, signed by the input's X */
+	FORCEINLINE double InputHeading(const FVector2D& input)
+	{
+		return FMath::RadiansToDegrees(FMath::Atan2(input.X, input.Y));
+	}
+
+	/** rotation turned by degrees about a world axis, like RotateAngleAxis on its forward then MakeRotFromZX */
+	FORCEINLINE FQuat RotateAboutAxis(const FQuat& rotation, const FVector& axis, double degrees)
+	{
+		return FQuat(axis, FMath::DegreesToRadians(degrees)) * rotation;
+	}
+
+	/** rotation expressed relative to parent, like InverseTransformRotation */
+	FORCEINLINE FQuat MakeRelativeRotation(const FQuat& parent, const FQuat& rotation)
+	{
+		return parent.Inverse() * rotation;
+	}
+
+	/**
+	 * MakeSurfaceBasis over arrays of floats in structure of arrays layout, four at a time.
+	 * count must be a multiple of 4, and the normals are expected to be unit length.
+	 */
+	PROTOGRAVITYSHIFT_API void MakeSurfaceBases(const float* normalX, const float* normalY, const float* normalZ,
+		const float* hintX, const float* hintY, const float* hintZ,
+		float* outX, float* outY, float* outZ, float* outW, int32 count);
+
+	/** SignedAngle over arrays of floats, count a multiple of 4 */
+	PROTOGRAVITYSHIFT_API void SignedAngles(const float* fromX, const float* fromY, const float* fromZ,
+		const float* toX, const float* toY, const float* toZ,
+		const float* normalX, const float* normalY, const float* normalZ, float* outDegrees, int32 count);
+}
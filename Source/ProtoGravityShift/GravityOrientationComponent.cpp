@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityOrientationComponent.h"
+#include "GravityShiftStats.h"
+#include "Components/SceneComponent.h"
+
+namespace
+{
+	/** Closed form critically damped spring towards zero (Game Programming Gems 4, 1.10) */
+	FVector SmoothCriticallyDamped(const FVector& offset, FVector& velocity, float smoothTime, float deltaTime)
+	{
+		const float omega = 2.f / FMath::Max(smoothTime, KINDA_SMALL_NUMBER);
+		const float x = omega * deltaTime;
+		const float decay = 1.f / (1.f + x + (0.48f * x * x) + (0.235f * x * x * x));
+		const FVector temp = (velocity + (offset * omega)) * deltaTime;
+		velocity = (velocity - (temp * omega)) * decay;
+		return (offset + temp) * decay;
+	}
+}
+
+UGravityOrientationComponent::UGravityOrientationComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	StartLocation = TargetLocation = FVector::ZeroVector;
+	StartRotation = TargetRotation = FQuat::Identity;
+	Duration = ElapsedTime = 0;
+	LocationVelocity = AngularVelocity = FVector::ZeroVector;
+}
+
+void UGravityOrientationComponent::SetUpdatedComponent(USceneComponent* component)
+{
+	UpdatedComponent = component;
+}
+
+void UGravityOrientationComponent::MoveTo(const FVector& location, const FQuat& rotation, float duration)
+{
+	if (UpdatedComponent == nullptr)
+	{
+		return;
+	}
+
+	// Retargeting to where we're already going must not restart the blend
+	if (bHasTarget && TargetLocation.Equals(location) && TargetRotation.Equals(rotation))
+	{
+		return;
+	}
+
+	const FTransform& current = UpdatedComponent->GetRelativeTransform();
+	StartLocation = current.GetLocation();
+	StartRotation = current.GetRotation();
+	bHasTarget = true;
+	TargetLocation = location;
+	TargetRotation = rotation;
+	Duration = duration;
+	ElapsedTime = 0;
+	INC_DWORD_STAT(STAT_GravityShift_BlendsStarted);
+
+	if (duration <= 0)
+	{
+		Snap();
+		return;
+	}
+
+	SetComponentTickEnabled(true);
+}
+
+void UGravityOrientationComponent::RotateTo(const FQuat& rotation, float duration)
+{
+	if (UpdatedComponent != nullptr)
+	{
+		MoveTo(IsComponentTickEnabled() ? TargetLocation : UpdatedComponent->GetRelativeLocation(), rotation, duration);
+	}
+}
+
+void UGravityOrientationComponent::Snap()
+{
+	UpdatedComponent->SetRelativeLocationAndRotation(TargetLocation, TargetRotation);
+	LocationVelocity = AngularVelocity = FVector::ZeroVector;
+	SetComponentTickEnabled(false);
+}
+
+void UGravityOrientationComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	GRAVITY_SHIFT_STAT_SCOPE(OrientationBlend);
+
+	if (UpdatedComponent == nullptr)
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	ElapsedTime += DeltaTime;
+
+	FVector location;
+	FQuat rotation;
+	if (BlendMode == EGravityOrientationBlend::E_Slerp)
+	{
+		if (ElapsedTime >= Duration)
+		{
+			Snap();
+			return;
+		}
+
+		const float alpha = ElapsedTime / Duration;
+		location = FMath::Lerp(StartLocation, TargetLocation, alpha);
+		rotation = FQuat::Slerp(StartRotation, TargetRotation, alpha);
+	}
+	else
+	{
+		// The spring settles in about twice its smooth time, which matches the requested duration
+		const float smoothTime = Duration * 0.5f;
+		const FTransform& current = UpdatedComponent->GetRelativeTransform();
+		const FVector locationOffset = SmoothCriticallyDamped(current.GetLocation() - TargetLocation, LocationVelocity, smoothTime, DeltaTime);
+
+		FQuat rotationOffset = current.GetRotation() * TargetRotation.Inverse();
+		rotationOffset.EnforceShortestArcWith(FQuat::Identity);
+		const FVector angularOffset = SmoothCriticallyDamped(rotationOffset.ToRotationVector(), AngularVelocity, smoothTime, DeltaTime);
+
+		if (locationOffset.IsNearlyZero(0.01) && angularOffset.IsNearlyZero(1e-4) && LocationVelocity.IsNearlyZero(0.1) && AngularVelocity.IsNearlyZero(1e-3))
+		{
+			Snap();
+			return;
+		}
+
+		location = TargetLocation + locationOffset;
+		rotation = FQuat::MakeFromRotationVector(angularOffset) * TargetRotation;
+	}
+
+	UpdatedComponent->SetRelativeLocationAndRotation(location, rotation);
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GravityOrientationComponent.generated.h"
+
+UENUM(BlueprintType)
+enum class EGravityOrientationBlend : uint8
+{
+	E_Slerp				UMETA(DisplayName = "Slerp"),
+	E_CriticallyDamped	UMETA(DisplayName = "CriticallyDamped"),
+};
+
+/**
+ * Moves a scene component's relative transform towards a single target that can be
+ * retargeted at any time. Replaces MoveComponentTo latent actions and stops ticking at rest.
+ */
+UCLASS(ClassGroup = GravityShift, meta = (BlueprintSpawnableComponent))
+class PROTOGRAVITYSHIFT_API UGravityOrientationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGravityOrientationComponent();
+
+	void SetUpdatedComponent(USceneComponent* component);
+
+	/** Blends the relative transform to the target over duration, snaps when duration is 0 */
+	void MoveTo(const FVector& location, const FQuat& rotation, float duration);
+
+	/** Same as MoveTo keeping the current location target */
+	void RotateTo(const FQuat& rotation, float duration);
+
+	FORCEINLINE bool IsAtRest() const { return !IsComponentTickEnabled(); }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+private:
+	void Snap();
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	EGravityOrientationBlend BlendMode = EGravityOrientationBlend::E_Slerp;
+
+	UPROPERTY()
+	USceneComponent* UpdatedComponent;
+
+	FVector StartLocation;
+	FVector TargetLocation;
+	FQuat StartRotation;
+	FQuat TargetRotation;
+	float Duration;
+	float ElapsedTime;
+	bool bHasTarget = false;
+
+	/** Critically damped spring state */
+	FVector LocationVelocity;
+	FVector AngularVelocity;
+};
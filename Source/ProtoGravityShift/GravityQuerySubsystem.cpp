@@ -0,0 +1,355 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityQuerySubsystem.h"
+#include "GravityShiftStats.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "SignificanceManager.h"
+
+static float GravityQueryBudgetMs = 1.0f;
+static FAutoConsoleVariableRef CVarGravityQueryBudgetMs(
+	TEXT("GravityShift.QueryBudgetMs"),
+	GravityQueryBudgetMs,
+	TEXT("Milliseconds of scene queries the gravity characters' wall and aim probes may take per frame"));
+
+// Waiting a second is worth as much as full significance, players come before everybody
+static constexpr float QueryWaitPriority = 1.0f;
+static constexpr float QueryPlayerPriority = 1000.0f;
+
+// Weight of the latest query in the running cost average
+static constexpr double QueryCostSmoothing = 0.05;
+// A query counts at most this many times the average, so one hitch doesn't stall the schedule
+static constexpr double QueryOutlierScale = 4.0;
+// Shrinks the estimate each frame it held queries back, in case it is still too pessimistic
+static constexpr double QueryEstimateDecay = 0.9;
+
+// FGravityScheduledProbe
+
+FGravityScheduledProbe::~FGravityScheduledProbe()
+{
+	Unregister();
+}
+
+void FGravityScheduledProbe::Register(UWorld* world, const AActor* owner, const FCollisionQueryParams& params)
+{
+	Unregister();
+
+	World = world;
+	Params = params;
+	if (UGravityQuerySubsystem* scheduler = world != nullptr ? world->GetSubsystem<UGravityQuerySubsystem>() : nullptr)
+	{
+		Scheduler = scheduler;
+		Slot = scheduler->RegisterProbe(owner, params);
+	}
+}
+
+void FGravityScheduledProbe::Unregister()
+{
+	if (UGravityQuerySubsystem* scheduler = Scheduler.Get())
+	{
+		scheduler->UnregisterProbe(Slot);
+	}
+	Scheduler.Reset();
+	Slot = INDEX_NONE;
+	World = nullptr;
+	bHasResult = false;
+	bNewResult = false;
+}
+
+void FGravityScheduledProbe::RequestLine(const FVector& start, const FVector& end, ECollisionChannel channel)
+{
+	if (UGravityQuerySubsystem* scheduler = Scheduler.Get())
+	{
+		scheduler->RequestLine(Slot, start, end, channel);
+	}
+	else if (World != nullptr)
+	{
+		INC_DWORD_STAT(STAT_GravityShift_Traces);
+		bHit = World->LineTraceSingleByChannel(Hit, start, end, channel, Params);
+		bHasResult = true;
+		bNewResult = true;
+	}
+}
+
+void FGravityScheduledProbe::RequestSweep(const FVector& start, const FVector& end, const FQuat& rotation, const FCollisionShape& shape, ECollisionChannel channel)
+{
+	if (UGravityQuerySubsystem* scheduler = Scheduler.Get())
+	{
+		scheduler->RequestSweep(Slot, start, end, rotation, shape, channel);
+	}
+	else if (World != nullptr)
+	{
+		INC_DWORD_STAT(STAT_GravityShift_Traces);
+		bHit = World->SweepSingleByChannel(Hit, start, end, rotation, channel, shape, Params);
+		bHasResult = true;
+		bNewResult = true;
+	}
+}
+
+bool FGravityScheduledProbe::Consume(bool& bOutHit, FHitResult& outHit)
+{
+	if (UGravityQuerySubsystem* scheduler = Scheduler.Get())
+	{
+		return scheduler->ConsumeResult(Slot, bOutHit, outHit);
+	}
+	if (!bNewResult)
+	{
+		return false;
+	}
+	bNewResult = false;
+	return GetLastResult(bOutHit, outHit);
+}
+
+bool FGravityScheduledProbe::GetLastResult(bool& bOutHit, FHitResult& outHit) const
+{
+	if (const UGravityQuerySubsystem* scheduler = Scheduler.Get())
+	{
+		return scheduler->GetLastResult(Slot, bOutHit, outHit);
+	}
+	if (!bHasResult)
+	{
+		return false;
+	}
+	bOutHit = bHit;
+	if (bHit)
+	{
+		outHit = Hit;
+	}
+	return true;
+}
+
+bool FGravityScheduledProbe::IsPending() const
+{
+	const UGravityQuerySubsystem* scheduler = Scheduler.Get();
+	return scheduler != nullptr && scheduler->IsPending(Slot);
+}
+
+void FGravityScheduledProbe::Reset()
+{
+	if (UGravityQuerySubsystem* scheduler = Scheduler.Get())
+	{
+		scheduler->CancelRequest(Slot);
+	}
+	bNewResult = false;
+}
+
+// UGravityQuerySubsystem
+
+int32 UGravityQuerySubsystem::RegisterProbe(const AActor* owner, const FCollisionQueryParams& params)
+{
+	FQuerySlot slot;
+	slot.Owner = owner;
+	slot.Params = params;
+	slot.LastRunTime = GetWorld()->GetTimeSeconds();
+	return Slots.Add(MoveTemp(slot));
+}
+
+void UGravityQuerySubsystem::UnregisterProbe(int32 slot)
+{
+	if (Slots.IsValidIndex(slot))
+	{
+		CancelRequest(slot);
+		Slots.RemoveAt(slot);
+	}
+}
+
+void UGravityQuerySubsystem::RequestLine(int32 slot, const FVector& start, const FVector& end, ECollisionChannel channel)
+{
+	FQuerySlot& query = Slots[slot];
+	query.bSweep = false;
+	query.Start = start;
+	query.End = end;
+	query.Channel = channel;
+	MarkPending(query);
+}
+
+void UGravityQuerySubsystem::RequestSweep(int32 slot, const FVector& start, const FVector& end, const FQuat& rotation, const FCollisionShape& shape, ECollisionChannel channel)
+{
+	FQuerySlot& query = Slots[slot];
+	query.bSweep = true;
+	query.Start = start;
+	query.End = end;
+	query.Rotation = rotation;
+	query.Shape = shape;
+	query.Channel = channel;
+	MarkPending(query);
+}
+
+void UGravityQuerySubsystem::MarkPending(FQuerySlot& slot)
+{
+	// A request replacing a pending one keeps its place, it has waited all the same
+	if (!slot.bPending)
+	{
+		slot.bPending = true;
+		NumPending++;
+	}
+}
+
+void UGravityQuerySubsystem::CancelRequest(int32 slot)
+{
+	FQuerySlot& query = Slots[slot];
+	if (query.bPending)
+	{
+		query.bPending = false;
+		NumPending--;
+	}
+	query.bNewResult = false;
+}
+
+bool UGravityQuerySubsystem::ConsumeResult(int32 slot, bool& bOutHit, FHitResult& outHit)
+{
+	FQuerySlot& query = Slots[slot];
+	if (!query.bNewResult)
+	{
+		return false;
+	}
+	query.bNewResult = false;
+	return GetLastResult(slot, bOutHit, outHit);
+}
+
+bool UGravityQuerySubsystem::GetLastResult(int32 slot, bool& bOutHit, FHitResult& outHit) const
+{
+	const FQuerySlot& query = Slots[slot];
+	if (!query.bHasResult)
+	{
+		return false;
+	}
+	bOutHit = query.bHit;
+	if (query.bHit)
+	{
+		outHit = query.Hit;
+	}
+	return true;
+}
+
+bool UGravityQuerySubsystem::IsPending(int32 slot) const
+{
+	return Slots[slot].bPending;
+}
+
+bool UGravityQuerySubsystem::LineTraceNow(FHitResult& outHit, const FVector& start, const FVector& end, ECollisionChannel channel, const FCollisionQueryParams& params)
+{
+	INC_DWORD_STAT(STAT_GravityShift_Traces);
+	const double startTime = FPlatformTime::Seconds();
+	const bool bHit = GetWorld()->LineTraceSingleByChannel(outHit, start, end, channel, params);
+	SpentSeconds += FPlatformTime::Seconds() - startTime;
+	return bHit;
+}
+
+bool UGravityQuerySubsystem::SweepNow(FHitResult& outHit, const FVector& start, const FVector& end, const FQuat& rotation, const FCollisionShape& shape,
+	ECollisionChannel channel, const FCollisionQueryParams& params)
+{
+	INC_DWORD_STAT(STAT_GravityShift_Traces);
+	const double startTime = FPlatformTime::Seconds();
+	const bool bHit = GetWorld()->SweepSingleByChannel(outHit, start, end, rotation, channel, shape, params);
+	SpentSeconds += FPlatformTime::Seconds() - startTime;
+	return bHit;
+}
+
+void UGravityQuerySubsystem::Tick(float DeltaTime)
+{
+	GRAVITY_SHIFT_STAT_SCOPE(RunScheduledQueries);
+
+	const double budgetSeconds = FMath::Max(0.0f, GravityQueryBudgetMs) / 1000.0;
+	const double time = GetWorld()->GetTimeSeconds();
+
+	Schedule.Reset();
+	for (TSparseArray<FQuerySlot>::TIterator it(Slots); it; ++it)
+	{
+		if (it->bPending)
+		{
+			Schedule.Emplace(GetPriority(*it, time), it.GetIndex());
+		}
+	}
+	Schedule.Sort([](const TPair<float, int32>& a, const TPair<float, int32>& b) { return a.Key > b.Key; });
+
+	bool bHeldBack = false;
+	for (int32 i = 0; i < Schedule.Num(); i++)
+	{
+		// Stop before the query that would likely overrun, not after it. The most urgent one always runs,
+		// so the schedule keeps moving whatever the estimate says
+		if (i > 0 && SpentSeconds + AverageQuerySeconds > budgetSeconds)
+		{
+			bHeldBack = true;
+			break;
+		}
+
+		FQuerySlot& slot = Slots[Schedule[i].Value];
+		const double startTime = FPlatformTime::Seconds();
+		RunQuery(slot);
+		const double querySeconds = FPlatformTime::Seconds() - startTime;
+
+		SpentSeconds += querySeconds;
+		slot.LastRunTime = time;
+
+		// A cold first trace or a hitch only nudges the estimate
+		if (AverageQuerySeconds > 0)
+		{
+			AverageQuerySeconds = FMath::Lerp(AverageQuerySeconds, FMath::Min(querySeconds, AverageQuerySeconds * QueryOutlierScale), QueryCostSmoothing);
+		}
+		else
+		{
+			AverageQuerySeconds = budgetSeconds > 0 ? FMath::Min(querySeconds, budgetSeconds) : querySeconds;
+		}
+	}
+
+	if (bHeldBack)
+	{
+		AverageQuerySeconds *= QueryEstimateDecay;
+	}
+
+	SET_DWORD_STAT(STAT_GravityShift_DeferredQueries, NumPending);
+	SpentSeconds = 0;
+}
+
+float UGravityQuerySubsystem::GetPriority(const FQuerySlot& slot, double time) const
+{
+	const float waited = (float)(time - slot.LastRunTime) * QueryWaitPriority;
+
+	const APawn* pawn = Cast<APawn>(slot.Owner.Get());
+	if (pawn != nullptr && pawn->IsPlayerControlled())
+	{
+		return QueryPlayerPriority + waited;
+	}
+
+	// Without viewers the significance manager isn't updated, waiting alone decides then
+	float significance = 0;
+	const USignificanceManager* significanceManager = USignificanceManager::Get(GetWorld());
+	if (significanceManager != nullptr && slot.Owner.IsValid())
+	{
+		significance = significanceManager->GetSignificance(slot.Owner.Get());
+	}
+	return significance + waited;
+}
+
+void UGravityQuerySubsystem::RunQuery(FQuerySlot& slot)
+{
+	INC_DWORD_STAT(STAT_GravityShift_Traces);
+	INC_DWORD_STAT(STAT_GravityShift_ScheduledQueries);
+
+	slot.Hit = FHitResult();
+	if (slot.bSweep)
+	{
+		slot.bHit = GetWorld()->SweepSingleByChannel(slot.Hit, slot.Start, slot.End, slot.Rotation, slot.Channel, slot.Shape, slot.Params);
+	}
+	else
+	{
+		slot.bHit = GetWorld()->LineTraceSingleByChannel(slot.Hit, slot.Start, slot.End, slot.Channel, slot.Params);
+	}
+
+	slot.bPending = false;
+	slot.bHasResult = true;
+	slot.bNewResult = true;
+	NumPending--;
+}
+
+TStatId UGravityQuerySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGravityQuerySubsystem, STATGROUP_Tickables);
+}
+
+bool UGravityQuerySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
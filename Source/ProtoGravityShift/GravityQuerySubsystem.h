@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GravityQuerySubsystem.generated.h"
+
+class UGravityQuerySubsystem;
+
+/**
+ * One scene query run by the world's UGravityQuerySubsystem when the frame's budget allows.
+ * A request replaces the pending one, and until it ran the last result stays available.
+ * Without a scheduler, e.g. in editor worlds, requests run straight away.
+ */
+struct PROTOGRAVITYSHIFT_API FGravityScheduledProbe
+{
+	UE_NONCOPYABLE(FGravityScheduledProbe);
+
+	FGravityScheduledProbe() = default;
+	~FGravityScheduledProbe();
+
+	/** owner sets the priority: players first, then by significance */
+	void Register(UWorld* world, const AActor* owner, const FCollisionQueryParams& params);
+	void Unregister();
+
+	void RequestLine(const FVector& start, const FVector& end, ECollisionChannel channel);
+	void RequestSweep(const FVector& start, const FVector& end, const FQuat& rotation, const FCollisionShape& shape, ECollisionChannel channel);
+
+	/** Returns true when a result came in since the last call, bOutHit then tells if it blocked */
+	bool Consume(bool& bOutHit, FHitResult& outHit);
+
+	/** The last result whether consumed or not, false until one came in */
+	bool GetLastResult(bool& bOutHit, FHitResult& outHit) const;
+
+	bool IsPending() const;
+
+	/** Drops a pending request, its result would describe a stale situation */
+	void Reset();
+
+private:
+	TWeakObjectPtr<UGravityQuerySubsystem> Scheduler;
+	int32 Slot = INDEX_NONE;
+
+	// Unscheduled fallback
+	UWorld* World = nullptr;
+	FCollisionQueryParams Params;
+	bool bHasResult = false;
+	bool bNewResult = false;
+	bool bHit = false;
+	FHitResult Hit;
+};
+
+/**
+ * Runs the wall and aim probes of every gravity character within a per frame time budget,
+ * GravityShift.QueryBudgetMs. Pending queries run in order of priority: player characters, then
+ * significance plus how long the query has waited, so nobody starves. Whatever doesn't fit waits
+ * for the next frame while its requester keeps using the last result.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravityQuerySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	int32 RegisterProbe(const AActor* owner, const FCollisionQueryParams& params);
+	void UnregisterProbe(int32 slot);
+
+	void RequestLine(int32 slot, const FVector& start, const FVector& end, ECollisionChannel channel);
+	void RequestSweep(int32 slot, const FVector& start, const FVector& end, const FQuat& rotation, const FCollisionShape& shape, ECollisionChannel channel);
+	void CancelRequest(int32 slot);
+
+	bool ConsumeResult(int32 slot, bool& bOutHit, FHitResult& outHit);
+	bool GetLastResult(int32 slot, bool& bOutHit, FHitResult& outHit) const;
+	bool IsPending(int32 slot) const;
+
+	/**
+	 * Line trace that can't wait for the schedule, e.g. a player pressing shift with no fresh aim.
+	 * It always runs, and its time comes out of the frame's budget.
+	 */
+	bool LineTraceNow(FHitResult& outHit, const FVector& start, const FVector& end, ECollisionChannel channel, const FCollisionQueryParams& params);
+	bool SweepNow(FHitResult& outHit, const FVector& start, const FVector& end, const FQuat& rotation, const FCollisionShape& shape, ECollisionChannel channel,
+		const FCollisionQueryParams& params);
+
+	FORCEINLINE int32 GetNumPending() const { return NumPending; }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FQuerySlot
+	{
+		TWeakObjectPtr<const AActor> Owner;
+		FCollisionQueryParams Params;
+
+		bool bPending = false;
+		bool bSweep = false;
+		FVector Start = FVector::ZeroVector;
+		FVector End = FVector::ZeroVector;
+		FQuat Rotation = FQuat::Identity;
+		FCollisionShape Shape;
+		ECollisionChannel Channel = ECC_Visibility;
+
+		/** World time of the last run, or of the registration */
+		double LastRunTime = 0;
+
+		bool bHasResult = false;
+		bool bNewResult = false;
+		bool bHit = false;
+		FHitResult Hit;
+	};
+
+	void MarkPending(FQuerySlot& slot);
+	float GetPriority(const FQuerySlot& slot, double time) const;
+	void RunQuery(FQuerySlot& slot);
+
+	TSparseArray<FQuerySlot> Slots;
+	int32 NumPending = 0;
+
+	/** Seconds spent on queries this frame, immediate ones included */
+	double SpentSeconds = 0;
+
+	/** Running average of one query's cost, to stop before the one that would overrun the budget */
+	double AverageQuerySeconds = 0;
+
+	TArray<TPair<float, int32>> Schedule;
+};
@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftAnimInstance.h"
+#include "Animation/AnimNodeBase.h"
+#include "BoneContainer.h"
+#include "BonePose.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "TwoBoneIK.h"
+
+// Proxy, game thread
+
+void FGravityShiftAnimInstanceProxy::Initialize(UAnimInstance* InAnimInstance)
+{
+	FAnimInstanceProxy::Initialize(InAnimInstance);
+
+	const UGravityShiftAnimInstance* instance = CastChecked<UGravityShiftAnimInstance>(InAnimInstance);
+	Feet[LeftFoot].BoneName = instance->LeftFootBone;
+	Feet[RightFoot].BoneName = instance->RightFootBone;
+	PelvisBoneName = instance->PelvisBone;
+	CachedBonesSerial = 0;
+
+	FootQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(GravityFootProbe), false, InAnimInstance->GetOwningActor());
+}
+
+void FGravityShiftAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+	FAnimInstanceProxy::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	const UGravityShiftAnimInstance* instance = CastChecked<UGravityShiftAnimInstance>(InAnimInstance);
+	const AProtoGravityShiftCharacter* character = Cast<AProtoGravityShiftCharacter>(InAnimInstance->GetOwningActor());
+	if (character == nullptr)
+	{
+		return;
+	}
+
+	// Everything the workers need, in the mesh's own space
+	const FTransform& meshTransform = InAnimInstance->GetSkelMeshComponent()->GetComponentTransform();
+	const FVector worldUp = -character->GetGravityMovement()->GetGravityDirection();
+	ShiftState = character->ShiftState;
+	ComponentVelocity = meshTransform.InverseTransformVectorNoScale(character->GetVelocity());
+	ComponentUp = meshTransform.InverseTransformVectorNoScale(worldUp);
+	ForwardAxis = instance->ForwardAxis.GetSafeNormal();
+	TargetWallFacing = ShiftState == EShiftState::E_WallGrounded ? instance->TargetWallFacing : 0;
+	WallFacingSpeed = instance->WallFacingSpeed;
+	FootInterpSpeed = instance->FootInterpSpeed;
+
+	const bool bOnGround = ShiftState == EShiftState::E_NoShift && character->GetCharacterMovement()->IsMovingOnGround();
+	bFootIK = instance->bFootIK && (bOnGround || ShiftState == EShiftState::E_WallGrounded);
+	if (bFootIK)
+	{
+		UpdateFootProbes(instance, worldUp);
+	}
+	else
+	{
+		for (FFoot& foot : Feet)
+		{
+			foot.Probe.Reset();
+			foot.bHit = false;
+		}
+	}
+}
+
+void FGravityShiftAnimInstanceProxy::UpdateFootProbes(const UGravityShiftAnimInstance* instance, const FVector& worldUp)
+{
+	const USkeletalMeshComponent* mesh = instance->GetSkelMeshComponent();
+	UWorld* world = mesh->GetWorld();
+
+	// The mesh origin sits on the surface, so that is where an unmoved foot rests
+	const FVector surfaceLocation = mesh->GetComponentLocation();
+	const FQuat meshRotation = mesh->GetComponentQuat();
+
+	for (FFoot& foot : Feet)
+	{
+		bool bHit = false;
+		FHitResult hit;
+		if (foot.Probe.Consume(world, bHit, hit))
+		{
+			foot.bHit = bHit;
+			if (bHit)
+			{
+				foot.TargetOffset = FMath::Clamp(FVector::DotProduct(hit.ImpactPoint - surfaceLocation, worldUp), -instance->MaxFootOffset, instance->MaxFootOffset);
+				foot.TargetRotation = FQuat::FindBetweenNormals(ComponentUp, meshRotation.UnrotateVector(hit.ImpactNormal));
+			}
+		}
+
+		if (foot.BoneName != NAME_None && mesh->DoesSocketExist(foot.BoneName))
+		{
+			// Probe under the animated foot, without last frame's IK
+			foot.ProbeLocation = mesh->GetSocketLocation(foot.BoneName) - (worldUp * foot.Offset);
+			foot.Probe.RequestLine(world, foot.ProbeLocation + (worldUp * instance->FootProbeHeight), foot.ProbeLocation - (worldUp * instance->FootProbeDepth),
+				ECC_Visibility, FootQueryParams);
+		}
+	}
+}
+
+// Proxy, worker threads
+
+void FGravityShiftAnimInstanceProxy::Update(float DeltaSeconds)
+{
+	FAnimInstanceProxy::Update(DeltaSeconds);
+
+	bOnWall = ShiftState == EShiftState::E_WallGrounded;
+	WallFacing += FRotator::NormalizeAxis(TargetWallFacing - WallFacing) * FMath::Min(1.0f, DeltaSeconds * WallFacingSpeed);
+
+	// Locomotion in the plane of the surface, whichever way it faces in the world
+	const FVector surfaceVelocity = FVector::VectorPlaneProject(ComponentVelocity, ComponentUp);
+	Speed = surfaceVelocity.Size();
+	VerticalSpeed = FVector::DotProduct(ComponentVelocity, ComponentUp);
+
+	const FVector forward = FQuat(ComponentUp, FMath::DegreesToRadians(WallFacing)).RotateVector(FVector::VectorPlaneProject(ForwardAxis, ComponentUp).GetSafeNormal());
+	if (Speed > UE_KINDA_SMALL_NUMBER)
+	{
+		const FVector moveDirection = surfaceVelocity / Speed;
+		Direction = FMath::RadiansToDegrees(FMath::Atan2(FVector::DotProduct(FVector::CrossProduct(forward, moveDirection), ComponentUp), FVector::DotProduct(forward, moveDirection)));
+	}
+	else
+	{
+		Direction = 0;
+	}
+
+	const float footBlend = FMath::Min(1.0f, DeltaSeconds * FootInterpSpeed);
+	for (FFoot& foot : Feet)
+	{
+		const bool bPlanted = bFootIK && foot.bHit;
+		foot.Offset = FMath::Lerp(foot.Offset, bPlanted ? foot.TargetOffset : 0.0f, footBlend);
+		foot.Rotation = FQuat::Slerp(foot.Rotation, bPlanted ? foot.TargetRotation : FQuat::Identity, footBlend);
+	}
+	LeftFootOffset = Feet[LeftFoot].Offset;
+	RightFootOffset = Feet[RightFoot].Offset;
+
+	// The pelvis drops to let the lower foot reach, the higher one bends up
+	PelvisOffset = FMath::Min3(LeftFootOffset, RightFootOffset, 0.0f);
+}
+
+void FGravityShiftAnimInstanceProxy::CacheBones(const FBoneContainer& bones)
+{
+	CachedBonesSerial = bones.GetSerialNumber();
+
+	auto findBone = [&bones](FName boneName)
+	{
+		FBoneReference reference(boneName);
+		reference.Initialize(bones);
+		return reference.GetCompactPoseIndex(bones);
+	};
+
+	PelvisIndex = findBone(PelvisBoneName);
+	for (FFoot& foot : Feet)
+	{
+		foot.FootIndex = findBone(foot.BoneName);
+		foot.JointIndex = foot.FootIndex.IsValid() ? bones.GetParentBoneIndex(foot.FootIndex) : FCompactPoseBoneIndex(INDEX_NONE);
+		foot.RootIndex = foot.JointIndex.IsValid() ? bones.GetParentBoneIndex(foot.JointIndex) : FCompactPoseBoneIndex(INDEX_NONE);
+	}
+}
+
+bool FGravityShiftAnimInstanceProxy::Evaluate_WithRoot(FPoseContext& Output, FAnimNode_Base* InRootNode)
+{
+	// Linked graphs are left alone, the main graph's pose gets everything once
+	if (InRootNode != GetRootNode())
+	{
+		return false;
+	}
+	EvaluateAnimationNode_WithRoot(Output, InRootNode);
+
+	const FBoneContainer& bones = Output.Pose.GetBoneContainer();
+	if (bones.GetSerialNumber() != CachedBonesSerial)
+	{
+		CacheBones(bones);
+	}
+
+	// Turning the root instead of the mesh component keeps wall facing off the game thread
+	if (!FMath::IsNearlyZero(WallFacing, 0.01f))
+	{
+		const FQuat facing(ComponentUp, FMath::DegreesToRadians(WallFacing));
+		FTransform& root = Output.Pose[FCompactPoseBoneIndex(0)];
+		root.SetRotation(facing * root.GetRotation());
+		root.SetTranslation(facing.RotateVector(root.GetTranslation()));
+	}
+
+	if (!bFootIK && FMath::IsNearlyZero(LeftFootOffset, 0.1f) && FMath::IsNearlyZero(RightFootOffset, 0.1f))
+	{
+		return true;
+	}
+
+	FCSPose<FCompactPose> componentPose;
+	componentPose.InitPose(Output.Pose);
+
+	if (PelvisIndex.IsValid() && PelvisOffset < 0)
+	{
+		FTransform pelvis = componentPose.GetComponentSpaceTransform(PelvisIndex);
+		pelvis.AddToTranslation(ComponentUp * PelvisOffset);
+		TArray<FBoneTransform> pelvisTransform = { FBoneTransform(PelvisIndex, pelvis) };
+		componentPose.LocalBlendCSBoneTransforms(pelvisTransform, 1.0f);
+	}
+
+	for (const FFoot& foot : Feet)
+	{
+		ApplyFootIK(componentPose, foot, foot.Offset - PelvisOffset);
+	}
+
+	FCSPose<FCompactPose>::ConvertComponentPosesToLocalPoses(MoveTemp(componentPose), Output.Pose);
+	return true;
+}
+
+void FGravityShiftAnimInstanceProxy::ApplyFootIK(FCSPose<FCompactPose>& pose, const FFoot& foot, float offset) const
+{
+	if (!foot.RootIndex.IsValid() || (FMath::IsNearlyZero(offset, 0.1f) && foot.Rotation.IsIdentity(0.001f)))
+	{
+		return;
+	}
+
+	FTransform root = pose.GetComponentSpaceTransform(foot.RootIndex);
+	FTransform joint = pose.GetComponentSpaceTransform(foot.JointIndex);
+	FTransform end = pose.GetComponentSpaceTransform(foot.FootIndex);
+
+	// Keep the knee bending the way the animation has it
+	const FVector effector = end.GetLocation() + (ComponentUp * offset);
+	const FVector jointTarget = joint.GetLocation() + (joint.GetLocation() - ((root.GetLocation() + end.GetLocation()) * 0.5f));
+	AnimationCore::SolveTwoBoneIK(root, joint, end, jointTarget, effector, false, 1.0, 1.0);
+	end.SetRotation(foot.Rotation * end.GetRotation());
+
+	TArray<FBoneTransform> legTransforms = { FBoneTransform(foot.RootIndex, root), FBoneTransform(foot.JointIndex, joint), FBoneTransform(foot.FootIndex, end) };
+	pose.LocalBlendCSBoneTransforms(legTransforms, 1.0f);
+}
+
+// Anim instance
+
+FAnimInstanceProxy* UGravityShiftAnimInstance::CreateAnimInstanceProxy()
+{
+	return &Proxy;
+}
+
+void UGravityShiftAnimInstance::DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy)
+{
+	// Proxy is a member, nothing to free
+}
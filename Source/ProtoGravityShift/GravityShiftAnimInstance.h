@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "BonePose.h"
+#include "GravityAsyncProbe.h"
+#include "ProtoGravityShiftCharacter.h"
+#include "GravityShiftAnimInstance.generated.h"
+
+class UGravityShiftAnimInstance;
+
+/**
+ * Animation state of a gravity shifter, worked out relative to the surface it stands on rather
+ * than world up. The game thread only copies the character's state and requests the foot probes,
+ * locomotion values are updated on the animation worker threads, and the wall facing, pelvis
+ * and foot IK are applied to the pose after the anim graph evaluates.
+ */
+USTRUCT(BlueprintType)
+struct PROTOGRAVITYSHIFT_API FGravityShiftAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+	FGravityShiftAnimInstanceProxy() = default;
+	FGravityShiftAnimInstanceProxy(UAnimInstance* instance) : FAnimInstanceProxy(instance) {}
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift)
+	EShiftState ShiftState = EShiftState::E_NoShift;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift)
+	bool bOnWall = false;
+
+	/** Speed along the surface the character stands on */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift)
+	float Speed = 0;
+
+	/** Degrees between the surface velocity and the facing, -180 to 180 */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift)
+	float Direction = 0;
+
+	/** Speed away from the surface, negative when falling towards it */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift)
+	float VerticalSpeed = 0;
+
+	/** Degrees the mesh is turned around the wall normal, applied to the root bone */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift)
+	float WallFacing = 0;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift)
+	float PelvisOffset = 0;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift)
+	float LeftFootOffset = 0;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift)
+	float RightFootOffset = 0;
+
+protected:
+	virtual void Initialize(UAnimInstance* InAnimInstance) override;
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+	virtual void Update(float DeltaSeconds) override;
+	virtual bool Evaluate_WithRoot(FPoseContext& Output, FAnimNode_Base* InRootNode) override;
+
+private:
+	enum EFoot
+	{
+		LeftFoot,
+		RightFoot,
+		NumFeet
+	};
+
+	struct FFoot
+	{
+		FName BoneName;
+		FGravityAsyncProbe Probe;
+
+		/** Foot location before IK the pending probe was requested for */
+		FVector ProbeLocation = FVector::ZeroVector;
+
+		// Game thread results, as of the last consumed probe
+		bool bHit = false;
+		float TargetOffset = 0;
+		FQuat TargetRotation = FQuat::Identity;
+
+		// Worker results
+		float Offset = 0;
+		FQuat Rotation = FQuat::Identity;
+
+		FCompactPoseBoneIndex FootIndex = FCompactPoseBoneIndex(INDEX_NONE);
+		FCompactPoseBoneIndex JointIndex = FCompactPoseBoneIndex(INDEX_NONE);
+		FCompactPoseBoneIndex RootIndex = FCompactPoseBoneIndex(INDEX_NONE);
+	};
+
+	void UpdateFootProbes(const UGravityShiftAnimInstance* instance, const FVector& worldUp);
+	void CacheBones(const FBoneContainer& bones);
+	void ApplyFootIK(FCSPose<FCompactPose>& pose, const FFoot& foot, float offset) const;
+
+	FFoot Feet[NumFeet];
+	FName PelvisBoneName;
+	FCompactPoseBoneIndex PelvisIndex = FCompactPoseBoneIndex(INDEX_NONE);
+	uint16 CachedBonesSerial = 0;
+
+	// Copied on the game thread
+	FVector ComponentVelocity = FVector::ZeroVector;
+	FVector ComponentUp = FVector::UpVector;
+	FVector ForwardAxis = FVector::YAxisVector;
+	float TargetWallFacing = 0;
+	float WallFacingSpeed = 12;
+	float FootInterpSpeed = 15;
+	bool bFootIK = true;
+	FCollisionQueryParams FootQueryParams;
+};
+
+/** Native base for the character's anim blueprint, see FGravityShiftAnimInstanceProxy */
+UCLASS(Transient, Blueprintable)
+class PROTOGRAVITYSHIFT_API UGravityShiftAnimInstance : public UAnimInstance
+{
+	GENERATED_BODY()
+
+public:
+	/** Degrees to turn the mesh around the wall normal, blended in on the animation threads */
+	FORCEINLINE void SetWallFacing(float angle) { TargetWallFacing = angle; }
+
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	FName LeftFootBone = TEXT("foot_l");
+
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	FName RightFootBone = TEXT("foot_r");
+
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	FName PelvisBone = TEXT("pelvis");
+
+	/** The mesh's forward in component space, +Y for the UE mannequins */
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	FVector ForwardAxis = FVector::YAxisVector;
+
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	bool bFootIK = true;
+
+	/** Feet are probed from this high above them down to this far below */
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	float FootProbeHeight = 50;
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	float FootProbeDepth = 75;
+
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	float MaxFootOffset = 50;
+
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	float FootInterpSpeed = 15;
+
+	UPROPERTY(EditDefaultsOnly, Category = GravityShift)
+	float WallFacingSpeed = 12;
+
+protected:
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+	virtual void DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy) override;
+
+private:
+	UPROPERTY(Transient, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
+	FGravityShiftAnimInstanceProxy Proxy;
+
+	float TargetWallFacing = 0;
+
+	friend struct FGravityShiftAnimInstanceProxy;
+};
@@ -0,0 +1,307 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftBenchmarkCommandlet.h"
+#include "GravityShiftBenchmarkHelpers.h"
+#include "GravityShiftRecording.h"
+#include "GravityShiftTiming.h"
+#include "GravitySurfaceProxySubsystem.h"
+#include "ProtoGravityShiftCharacter.h"
+#include "Components/WorldPartitionStreamingSourceComponent.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerStart.h"
+#include "Misc/Paths.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+
+// Seconds spent in each part of the scripted cycle
+static constexpr float BenchmarkGroundTime = 1.0f;
+static constexpr float BenchmarkLevitateTime = 0.5f;
+static constexpr float BenchmarkShiftTimeout = 4.0f;
+static constexpr float BenchmarkWallWalkTime = 1.5f;
+
+static constexpr float BenchmarkSpawnSpacing = 250;
+static constexpr float BenchmarkStreamingRadius = 50000;
+static constexpr int32 BenchmarkMaxStreamingFrames = 600;
+
+UGravityShiftBenchmarkCommandlet::UGravityShiftBenchmarkCommandlet()
+{
+	// Runs the map like a dedicated server would, no editor world and no viewport
+	IsClient = false;
+	IsServer = true;
+	IsEditor = false;
+	LogToConsole = true;
+	HelpDescription = TEXT("Stress tests the gravity shift with scripted characters and writes frame timings as JSON");
+}
+
+int32 UGravityShiftBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString mode;
+	if (FParse::Value(*Params, TEXT("Mode="), mode) && mode == TEXT("Fields"))
+	{
+		return RunFieldBenchmark(Params);
+	}
+	if (mode == TEXT("Replay"))
+	{
+		return RunReplay(Params);
+	}
+	if (mode == TEXT("Streaming"))
+	{
+		return RunStreamingBenchmark(Params);
+	}
+	if (mode == TEXT("Math"))
+	{
+		return RunMathBenchmark(Params);
+	}
+	if (mode == TEXT("Probes"))
+	{
+		return RunProbeBenchmark(Params);
+	}
+	if (mode == TEXT("Tuning"))
+	{
+		return RunTuningSweep(Params);
+	}
+
+	int32 characterCount = 100;
+	int32 frameCount = 1200;
+	int32 warmupFrames = 120;
+	float deltaTime = 1.0f / 60.0f;
+	int32 seed = 0;
+	FString mapName = TEXT("/Game/ThirdPerson/Maps/ThirdPersonMap");
+	FString characterClassPath;
+	FString outputPath = FPaths::ProjectSavedDir() / TEXT("GravityShiftBenchmark.json");
+
+	FParse::Value(*Params, TEXT("Count="), characterCount);
+	FParse::Value(*Params, TEXT("Frames="), frameCount);
+	FParse::Value(*Params, TEXT("Warmup="), warmupFrames);
+	FParse::Value(*Params, TEXT("DeltaTime="), deltaTime);
+	FParse::Value(*Params, TEXT("Seed="), seed);
+	FParse::Value(*Params, TEXT("Map="), mapName);
+	FParse::Value(*Params, TEXT("CharacterClass="), characterClassPath);
+	FParse::Value(*Params, TEXT("Output="), outputPath);
+
+	UClass* characterClass = GravityShiftBenchmark::LoadCharacterClass(characterClassPath);
+	if (characterClass == nullptr)
+	{
+		return 1;
+	}
+
+	if (LoadWorld(mapName) == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: could not load %s"), *mapName);
+		return 1;
+	}
+
+	Random.Initialize(seed);
+	SpawnShifters(characterCount, characterClass);
+
+	for (int32 frame = 0; frame < warmupFrames; frame++)
+	{
+		DriveShifters(deltaTime);
+		TickWorld(deltaTime);
+	}
+
+	TArray<double> frameTimes;
+	frameTimes.Reserve(frameCount);
+	CompletedCycles = 0;
+	GravityShiftTiming::Reset();
+	GravityShiftTiming::SetRecording(true);
+
+	for (int32 frame = 0; frame < frameCount; frame++)
+	{
+		const double frameStart = FPlatformTime::Seconds();
+		DriveShifters(deltaTime);
+		TickWorld(deltaTime);
+		frameTimes.Add((FPlatformTime::Seconds() - frameStart) * 1000.0);
+	}
+
+	GravityShiftTiming::SetRecording(false);
+
+	int32 aliveShifters = 0;
+	for (const FShifter& shifter : Shifters)
+	{
+		aliveShifters += shifter.Character.IsValid() ? 1 : 0;
+	}
+
+	DestroyWorld();
+
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetStringField(TEXT("map"), mapName);
+	report->SetStringField(TEXT("characterClass"), characterClass->GetPathName());
+	report->SetNumberField(TEXT("characters"), characterCount);
+	report->SetNumberField(TEXT("charactersAlive"), aliveShifters);
+	report->SetNumberField(TEXT("frames"), frameTimes.Num());
+	report->SetNumberField(TEXT("deltaTime"), deltaTime);
+	report->SetNumberField(TEXT("completedCycles"), CompletedCycles);
+	report->SetStringField(TEXT("surfaceChannel"), UGravitySurfaceProxySubsystem::GetTraceChannel() == ECC_GravitySurface ? TEXT("GravitySurface") : TEXT("Visibility"));
+	report->SetObjectField(TEXT("gameThread"), GravityShiftBenchmark::MakeFrameTimeReport(frameTimes));
+	report->SetArrayField(TEXT("functions"), GravityShiftBenchmark::MakeFunctionReport(frameTimes.Num()));
+	return GravityShiftBenchmark::WriteReport(report, outputPath) ? 0 : 1;
+}
+
+UWorld* UGravityShiftBenchmarkCommandlet::LoadWorld(const FString& mapName, bool bStreamAroundOrigin)
+{
+	GameInstance = NewObject<UGameInstance>(GEngine);
+	GameInstance->InitializeStandalone();
+
+	FWorldContext* worldContext = GameInstance->GetWorldContext();
+	FString error;
+	if (!GEngine->LoadMap(*worldContext, FURL(nullptr, *mapName, TRAVEL_Absolute), nullptr, error))
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: %s"), *error);
+		return nullptr;
+	}
+	World = worldContext->World();
+
+	if (!bStreamAroundOrigin)
+	{
+		return World;
+	}
+
+	// Nobody is playing, stream the map in around the origin like a player would
+	FActorSpawnParameters spawnParams;
+	spawnParams.ObjectFlags |= RF_Transient;
+	AActor* streamingSource = World->SpawnActor<AActor>(spawnParams);
+	UWorldPartitionStreamingSourceComponent* streamingComponent = NewObject<UWorldPartitionStreamingSourceComponent>(streamingSource);
+	FStreamingSourceShape shape;
+	shape.bUseGridLoadingRange = false;
+	shape.Radius = BenchmarkStreamingRadius;
+	streamingComponent->Shapes.Add(shape);
+	streamingComponent->RegisterComponent();
+	streamingComponent->EnableStreamingSource();
+
+	WaitForStreaming();
+	return World;
+}
+
+void UGravityShiftBenchmarkCommandlet::WaitForStreaming()
+{
+	if (UWorldPartitionSubsystem* worldPartition = World->GetSubsystem<UWorldPartitionSubsystem>())
+	{
+		for (int32 frame = 0; frame < BenchmarkMaxStreamingFrames && !worldPartition->IsStreamingCompleted(); frame++)
+		{
+			TickWorld(1.0f / 60.0f);
+			World->BlockTillLevelStreamingCompleted();
+		}
+	}
+}
+
+void UGravityShiftBenchmarkCommandlet::DestroyWorld()
+{
+	Shifters.Reset();
+	if (World != nullptr)
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		World = nullptr;
+	}
+	if (GameInstance != nullptr)
+	{
+		GameInstance->Shutdown();
+		GameInstance = nullptr;
+	}
+}
+
+void UGravityShiftBenchmarkCommandlet::SpawnShifters(int32 count, UClass* characterClass)
+{
+	FVector origin = FVector(0, 0, 200);
+	for (TActorIterator<APlayerStart> it(World); it; ++it)
+	{
+		origin = it->GetActorLocation();
+		break;
+	}
+
+	const int32 rowLength = FMath::Max(1, FMath::CeilToInt32(FMath::Sqrt((float)count)));
+	const FVector rowOffset = FVector(rowLength - 1, rowLength - 1, 0) * (BenchmarkSpawnSpacing * 0.5f);
+
+	FActorSpawnParameters spawnParams;
+	spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 i = 0; i < count; i++)
+	{
+		const FVector location = origin - rowOffset + (FVector(i % rowLength, i / rowLength, 0) * BenchmarkSpawnSpacing);
+		AProtoGravityShiftCharacter* character = World->SpawnActor<AProtoGravityShiftCharacter>(characterClass, location, FRotator::ZeroRotator, spawnParams);
+		if (character == nullptr)
+		{
+			continue;
+		}
+		if (character->GetController() == nullptr)
+		{
+			character->SpawnDefaultController();
+		}
+
+		// Spread the cycles so the characters don't all shift on the same frame
+		FShifter& shifter = Shifters.AddDefaulted_GetRef();
+		shifter.Character = character;
+		shifter.StateTime = Random.FRandRange(0, BenchmarkGroundTime);
+	}
+}
+
+void UGravityShiftBenchmarkCommandlet::DriveShifters(float deltaTime)
+{
+	// Pressed like a local player would, not requested like a server applying a client's shift
+	for (FShifter& shifter : Shifters)
+	{
+		AProtoGravityShiftCharacter* character = shifter.Character.Get();
+		if (character == nullptr)
+		{
+			continue;
+		}
+
+		if ((uint8)character->ShiftState != shifter.LastState)
+		{
+			shifter.LastState = (uint8)character->ShiftState;
+			shifter.StateTime = 0;
+		}
+		shifter.StateTime += deltaTime;
+
+		switch (character->ShiftState)
+		{
+		case EShiftState::E_NoShift:
+			if (shifter.StateTime >= BenchmarkGroundTime)
+			{
+				character->PlayInput(FVector2D::ZeroVector, GravityShiftRecording::ActionShift, FVector::ZeroVector);
+			}
+			break;
+		case EShiftState::E_Levitating:
+			if (shifter.StateTime >= BenchmarkLevitateTime)
+			{
+				// Mostly sideways so the shift ends on a wall rather than the floor
+				const FRotator aim(Random.FRandRange(-20, 20), Random.FRandRange(0, 360), 0);
+				character->PlayInput(FVector2D::ZeroVector, GravityShiftRecording::ActionShift, aim.Vector());
+			}
+			break;
+		case EShiftState::E_Accelerating:
+			if (shifter.StateTime >= BenchmarkShiftTimeout)
+			{
+				character->PlayInput(FVector2D::ZeroVector, GravityShiftRecording::ActionCancel, FVector::ZeroVector);
+			}
+			break;
+		case EShiftState::E_WallGrounded:
+			if (shifter.StateTime >= BenchmarkWallWalkTime)
+			{
+				character->PlayInput(FVector2D::ZeroVector, GravityShiftRecording::ActionCancel, FVector::ZeroVector);
+				CompletedCycles++;
+			}
+			else
+			{
+				character->PlayInput(FVector2D(0, 1), 0, FVector::ZeroVector);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void UGravityShiftBenchmarkCommandlet::TickWorld(float deltaTime)
+{
+	FApp::SetDeltaTime(deltaTime);
+	FApp::SetCurrentTime(FApp::GetCurrentTime() + deltaTime);
+
+	World->Tick(LEVELTICK_All, deltaTime);
+	FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+	GFrameCounter++;
+}
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "GravityShiftBenchmarkCommandlet.generated.h"
+
+class AProtoGravityShiftCharacter;
+class FJsonObject;
+class UGameInstance;
+
+/**
+ * Headless stress test of the gravity shift. Spawns characters into a map, drives them through
+ * levitate, accelerate, wall-ground and back-to-ground cycles and writes frame timings as JSON.
+ *
+ * UnrealEditor-Cmd ProtoGravityShift.uproject -run=GravityShiftBenchmark -nullrhi -unattended
+ *     [-Count=100] [-Frames=1200] [-Warmup=120] [-DeltaTime=0.0166] [-Seed=0]
+ *     [-Map=/Game/ThirdPerson/Maps/ThirdPersonMap] [-CharacterClass=/Game/...BP_C] [-Output=Saved/GravityShiftBenchmark.json]
+ *
+ * With -Mode=Fields it instead spawns random gravity fields and times sampling them through
+ * UGravityFieldSubsystem's batch against an overlap query plus evaluation per sample.
+ *     [-Fields=64] [-Queries=2000] [-Iterations=200] [-Seed=0] [-Map=...] [-Output=Saved/GravityFieldBenchmark.json]
+ *
+ * With -Mode=Replay it feeds a session saved by GravityShift.Record to one character in the
+ * recorded map and reports the frame timings and how far the replay drifts from the recording.
+ * -Resync snaps the character back onto the recording once it drifts further than that many cm.
+ *     -Recording=Saved/Recordings/....gsr [-Resync=0] [-CharacterClass=...] [-Output=Saved/GravityShiftReplay.json]
+ *
+ * With -Mode=Streaming one character, streaming the map around itself like a player, makes
+ * scripted long shifts twice: without and with the predictive shift streaming source. Each pass
+ * reports how many shift frames the character spent in cells that weren't loaded yet.
+ *     [-Shifts=20] [-ShiftTime=3] [-DeltaTime=0.0166] [-Seed=0] [-Map=...] [-CharacterClass=...] [-Output=Saved/GravityStreamingBenchmark.json]
+ *
+ * With -Mode=Math it loads no map: it times GravityMath against the Kismet chains the wall
+ * orientation used to be written with, on random surfaces. Tests/GravityMathTests checks they agree.
+ *     [-Samples=4096] [-Iterations=100] [-Seed=0] [-Output=Saved/GravityMathBenchmark.json]
+ *
+ * With -Mode=Probes it casts the same wall, sweep and aim probes at the map's gravity surface proxies
+ * twice: on the Visibility channel against the full collision, then on the GravitySurface channel
+ * against the proxies. It reports the ns per probe of each and how often they land apart.
+ *     [-Probes=2000] [-Iterations=20] [-Seed=0] [-Map=...] [-Output=Saved/GravityProbeBenchmark.json]
+ *
+ * With -Mode=Tuning it loads no map: it sweeps the shift parameters through the GravityShiftSim core
+ * on its analytic test level, every combination in parallel, and writes a CSV of landing times and
+ * speeds per combination. Each range is min:max:steps.
+ *     [-StartSpeed=500:2000:4] [-Acceleration=0:3000:4] [-MaxSpeed=3000:10000:4] [-WallTransition=0.1:0.4:4]
+ *     [-BackToGroundTransition=0.1:0.4:4] [-Scenarios=64] [-Seed=1] [-StepRate=120] [-Timeout=10] [-Output=Saved/GravityShiftTuning.csv]
+ *
+ * Each mode is implemented in its own GravityShiftBenchmark<Mode>.cpp.
+ */
+UCLASS()
+class UGravityShiftBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGravityShiftBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FShifter
+	{
+		TWeakObjectPtr<AProtoGravityShiftCharacter> Character;
+		float StateTime = 0;
+		uint8 LastState = 0;
+	};
+
+	/** Without bStreamAroundOrigin nothing streams in until a streaming source is added */
+	UWorld* LoadWorld(const FString& mapName, bool bStreamAroundOrigin = true);
+	void WaitForStreaming();
+	void DestroyWorld();
+
+	void SpawnShifters(int32 count, UClass* characterClass);
+	void DriveShifters(float deltaTime);
+
+	void TickWorld(float deltaTime);
+
+	int32 RunFieldBenchmark(const FString& params);
+	void SpawnFields(int32 count);
+
+	int32 RunReplay(const FString& params);
+
+	int32 RunStreamingBenchmark(const FString& params);
+	TSharedPtr<FJsonObject> RunStreamingPass(const FString& mapName, UClass* characterClass, int32 seed, int32 shifts, float shiftTime, float deltaTime,
+		bool bPredictShiftPath);
+
+	int32 RunMathBenchmark(const FString& params);
+
+	int32 RunProbeBenchmark(const FString& params);
+
+	int32 RunTuningSweep(const FString& params);
+
+	UPROPERTY()
+	UGameInstance* GameInstance = nullptr;
+	UPROPERTY()
+	UWorld* World = nullptr;
+
+	TArray<FShifter> Shifters;
+	FRandomStream Random;
+
+	int32 CompletedCycles = 0;
+};
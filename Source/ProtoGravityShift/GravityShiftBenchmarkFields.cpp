@@ -0,0 +1,168 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftBenchmarkCommandlet.h"
+#include "GravityShiftBenchmarkHelpers.h"
+#include "GravityFieldSubsystem.h"
+#include "GravityFieldVolume.h"
+#include "Engine/OverlapResult.h"
+#include "Engine/World.h"
+#include "Misc/Paths.h"
+
+// Half size of the cube the field benchmark scatters fields and samples in
+static constexpr float BenchmarkFieldArea = 30000;
+
+int32 UGravityShiftBenchmarkCommandlet::RunFieldBenchmark(const FString& params)
+{
+	int32 fieldCount = 64;
+	int32 queryCount = 2000;
+	int32 iterations = 200;
+	int32 seed = 0;
+	FString mapName = TEXT("/Game/ThirdPerson/Maps/ThirdPersonMap");
+	FString outputPath = FPaths::ProjectSavedDir() / TEXT("GravityFieldBenchmark.json");
+
+	FParse::Value(*params, TEXT("Fields="), fieldCount);
+	FParse::Value(*params, TEXT("Queries="), queryCount);
+	FParse::Value(*params, TEXT("Iterations="), iterations);
+	FParse::Value(*params, TEXT("Seed="), seed);
+	FParse::Value(*params, TEXT("Map="), mapName);
+	FParse::Value(*params, TEXT("Output="), outputPath);
+	iterations = FMath::Max(1, iterations);
+
+	if (LoadWorld(mapName) == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: could not load %s"), *mapName);
+		return 1;
+	}
+
+	UGravityFieldSubsystem* fields = World->GetSubsystem<UGravityFieldSubsystem>();
+	if (fields == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: no gravity field subsystem in %s"), *mapName);
+		DestroyWorld();
+		return 1;
+	}
+
+	Random.Initialize(seed);
+	SpawnFields(fieldCount);
+	TickWorld(1.0f / 60.0f);
+
+	TArray<FVector> locations;
+	locations.Reserve(queryCount);
+	for (int32 i = 0; i < queryCount; i++)
+	{
+		locations.Add(FVector(Random.FRandRange(-1, 1), Random.FRandRange(-1, 1), Random.FRandRange(-1, 1)) * BenchmarkFieldArea);
+	}
+
+	TArray<FVector> batchedGravity;
+	batchedGravity.SetNumZeroed(queryCount);
+	const double batchedStart = FPlatformTime::Seconds();
+	for (int32 iteration = 0; iteration < iterations; iteration++)
+	{
+		fields->EvaluateBatch(locations, batchedGravity);
+	}
+	const double batchedMs = (FPlatformTime::Seconds() - batchedStart) * 1000.0 / iterations;
+
+	// What each actor would do on its own: find the volumes around it, then evaluate them
+	TArray<FVector> overlapGravity;
+	overlapGravity.SetNumZeroed(queryCount);
+	TArray<FOverlapResult> overlaps;
+	const FCollisionShape point = FCollisionShape::MakeSphere(1);
+	const FCollisionObjectQueryParams objectParams(ECC_WorldDynamic);
+	const FCollisionQueryParams queryParams(SCENE_QUERY_STAT(GravityFieldOverlap), false);
+
+	const double overlapStart = FPlatformTime::Seconds();
+	for (int32 iteration = 0; iteration < iterations; iteration++)
+	{
+		for (int32 i = 0; i < queryCount; i++)
+		{
+			overlaps.Reset();
+			World->OverlapMultiByObjectType(overlaps, locations[i], FQuat::Identity, objectParams, point, queryParams);
+
+			FVector gravity = FVector::ZeroVector;
+			int32 bestPriority = MIN_int32;
+			for (const FOverlapResult& overlap : overlaps)
+			{
+				const AGravityFieldVolume* field = Cast<AGravityFieldVolume>(overlap.GetActor());
+				FVector fieldGravity;
+				if (field != nullptr && field->GetShape().Priority > bestPriority && field->EvaluateAt(locations[i], fieldGravity))
+				{
+					gravity = fieldGravity;
+					bestPriority = field->GetShape().Priority;
+				}
+			}
+			overlapGravity[i] = gravity;
+		}
+	}
+	const double overlapMs = (FPlatformTime::Seconds() - overlapStart) * 1000.0 / iterations;
+
+	// The kernels run in float relative to each field, so allow for a little rounding
+	int32 insideFields = 0;
+	int32 mismatches = 0;
+	for (int32 i = 0; i < queryCount; i++)
+	{
+		insideFields += overlapGravity[i].IsZero() ? 0 : 1;
+		mismatches += batchedGravity[i].Equals(overlapGravity[i], 1.0) ? 0 : 1;
+	}
+
+	const int32 spawnedFields = fields->GetNumFields();
+	DestroyWorld();
+
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetStringField(TEXT("map"), mapName);
+	report->SetNumberField(TEXT("fields"), spawnedFields);
+	report->SetNumberField(TEXT("queries"), queryCount);
+	report->SetNumberField(TEXT("queriesInsideFields"), insideFields);
+	report->SetNumberField(TEXT("iterations"), iterations);
+	report->SetNumberField(TEXT("batchedMsPerPass"), batchedMs);
+	report->SetNumberField(TEXT("overlapMsPerPass"), overlapMs);
+	report->SetNumberField(TEXT("speedup"), batchedMs > 0 ? overlapMs / batchedMs : 0.0);
+	report->SetNumberField(TEXT("mismatches"), mismatches);
+
+	if (mismatches > 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("GravityShiftBenchmark: batched and overlap gravity differ for %d samples"), mismatches);
+	}
+	return GravityShiftBenchmark::WriteReport(report, outputPath) ? 0 : 1;
+}
+
+void UGravityShiftBenchmarkCommandlet::SpawnFields(int32 count)
+{
+	for (int32 i = 0; i < count; i++)
+	{
+		const FVector location = FVector(Random.FRandRange(-1, 1), Random.FRandRange(-1, 1), Random.FRandRange(-1, 1)) * BenchmarkFieldArea;
+		const FRotator rotation(Random.FRandRange(-90, 90), Random.FRandRange(0, 360), Random.FRandRange(-180, 180));
+		const FTransform transform(rotation, location);
+
+		AGravityFieldVolume* field = World->SpawnActorDeferred<AGravityFieldVolume>(AGravityFieldVolume::StaticClass(), transform);
+		if (field == nullptr)
+		{
+			continue;
+		}
+
+		const EGravityFieldShape shape = (EGravityFieldShape)(i % 4);
+		float radius = Random.FRandRange(1000, 6000);
+		const float halfHeight = Random.FRandRange(1000, 4000);
+		FVector boxExtent = FVector::ZeroVector;
+		TArray<FVector> splinePoints;
+		switch (shape)
+		{
+		case EGravityFieldShape::Directional:
+			boxExtent = FVector(Random.FRandRange(1000, 5000), Random.FRandRange(1000, 5000), Random.FRandRange(1000, 5000));
+			break;
+		case EGravityFieldShape::Spline:
+			for (int32 p = 0; p < 4; p++)
+			{
+				splinePoints.Add(FVector(Random.FRandRange(-4000, 4000), Random.FRandRange(-4000, 4000), Random.FRandRange(-4000, 4000)));
+			}
+			radius = Random.FRandRange(500, 1500);
+			break;
+		default:
+			break;
+		}
+
+		// Distinct priorities, so both paths resolve overlaps the same way
+		field->SetupField(shape, i, radius, halfHeight, boxExtent, splinePoints);
+		field->FinishSpawning(transform);
+	}
+}
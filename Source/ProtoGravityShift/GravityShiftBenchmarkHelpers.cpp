@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftBenchmarkHelpers.h"
+#include "GravityShiftTiming.h"
+#include "ProtoGravityShiftCharacter.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace GravityShiftBenchmark
+{
+	UClass* LoadCharacterClass(const FString& characterClassPath)
+	{
+		if (characterClassPath.IsEmpty())
+		{
+			return AProtoGravityShiftCharacter::StaticClass();
+		}
+
+		UClass* characterClass = LoadClass<AProtoGravityShiftCharacter>(nullptr, *characterClassPath);
+		if (characterClass == nullptr)
+		{
+			UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: %s is not a ProtoGravityShiftCharacter class"), *characterClassPath);
+		}
+		return characterClass;
+	}
+
+	TSharedRef<FJsonObject> MakeFrameTimeReport(const TArray<double>& frameTimes)
+	{
+		TArray<double> sortedFrameTimes = frameTimes;
+		sortedFrameTimes.Sort();
+		auto percentile = [&sortedFrameTimes](double fraction)
+		{
+			return sortedFrameTimes.Num() > 0 ? sortedFrameTimes[FMath::Clamp(FMath::FloorToInt32(fraction * sortedFrameTimes.Num()), 0, sortedFrameTimes.Num() - 1)] : 0.0;
+		};
+
+		double totalMs = 0;
+		for (double frameTime : frameTimes)
+		{
+			totalMs += frameTime;
+		}
+
+		TSharedRef<FJsonObject> gameThread = MakeShared<FJsonObject>();
+		gameThread->SetNumberField(TEXT("meanMs"), frameTimes.Num() > 0 ? totalMs / frameTimes.Num() : 0.0);
+		gameThread->SetNumberField(TEXT("p50Ms"), percentile(0.5));
+		gameThread->SetNumberField(TEXT("p99Ms"), percentile(0.99));
+		gameThread->SetNumberField(TEXT("maxMs"), sortedFrameTimes.Num() > 0 ? sortedFrameTimes.Last() : 0.0);
+		return gameThread;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> MakeFunctionReport(int32 frames)
+	{
+		TArray<TSharedPtr<FJsonValue>> functions;
+		for (int32 i = 0; i < (int32)GravityShiftTiming::EScope::Num; i++)
+		{
+			const GravityShiftTiming::EScope scope = (GravityShiftTiming::EScope)i;
+			const double scopeMs = GravityShiftTiming::GetSeconds(scope) * 1000.0;
+
+			TSharedRef<FJsonObject> function = MakeShared<FJsonObject>();
+			function->SetStringField(TEXT("name"), GravityShiftTiming::GetScopeName(scope));
+			function->SetNumberField(TEXT("totalMs"), scopeMs);
+			function->SetNumberField(TEXT("msPerFrame"), frames > 0 ? scopeMs / frames : 0.0);
+			function->SetNumberField(TEXT("calls"), GravityShiftTiming::GetCalls(scope));
+			functions.Add(MakeShared<FJsonValueObject>(function));
+		}
+		return functions;
+	}
+
+	bool WriteReport(const TSharedRef<FJsonObject>& report, const FString& outputPath)
+	{
+		FString json;
+		TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+		FJsonSerializer::Serialize(report, writer);
+
+		UE_LOG(LogTemp, Display, TEXT("%s"), *json);
+		if (!FFileHelper::SaveStringToFile(json, *outputPath))
+		{
+			UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: could not write %s"), *outputPath);
+			return false;
+		}
+		return true;
+	}
+}
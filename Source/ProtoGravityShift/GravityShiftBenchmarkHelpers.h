@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+/** Loading, timing and report writing shared by the GravityShiftBenchmark modes */
+namespace GravityShiftBenchmark
+{
+	/** The native character when the path is empty, null and an error if it isn't a ProtoGravityShiftCharacter class */
+	UClass* LoadCharacterClass(const FString& characterClassPath);
+
+	/** Mean, p50, p99 and max of frame times in ms */
+	TSharedRef<FJsonObject> MakeFrameTimeReport(const TArray<double>& frameTimes);
+
+	/** Time spent in each GravityShiftTiming scope since the last reset */
+	TArray<TSharedPtr<FJsonValue>> MakeFunctionReport(int32 frames);
+
+	/** Logs the report and writes it as JSON */
+	bool WriteReport(const TSharedRef<FJsonObject>& report, const FString& outputPath);
+
+	/** Nanoseconds per call of function(i) over calls indices, averaged over iterations */
+	template<typename FunctionType>
+	double TimeNsPerCall(int32 calls, int32 iterations, FunctionType&& function)
+	{
+		const double start = FPlatformTime::Seconds();
+		for (int32 iteration = 0; iteration < iterations; iteration++)
+		{
+			for (int32 i = 0; i < calls; i++)
+			{
+				function(i);
+			}
+		}
+		return (FPlatformTime::Seconds() - start) * 1e9 / ((double)calls * iterations);
+	}
+}
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftBenchmarkCommandlet.h"
+#include "GravityShiftBenchmarkHelpers.h"
+#include "Tests/GravityMathReference.h"
+#include "Misc/Paths.h"
+
+static TSharedRef<FJsonObject> MakeMathReport(const TCHAR* name, double referenceNs, double mathNs)
+{
+	TSharedRef<FJsonObject> function = MakeShared<FJsonObject>();
+	function->SetStringField(TEXT("name"), name);
+	function->SetNumberField(TEXT("referenceNsPerCall"), referenceNs);
+	function->SetNumberField(TEXT("mathNsPerCall"), mathNs);
+	function->SetNumberField(TEXT("speedup"), mathNs > 0 ? referenceNs / mathNs : 0.0);
+	return function;
+}
+
+int32 UGravityShiftBenchmarkCommandlet::RunMathBenchmark(const FString& params)
+{
+	int32 sampleCount = 4096;
+	int32 iterations = 100;
+	int32 seed = 0;
+	FString outputPath = FPaths::ProjectSavedDir() / TEXT("GravityMathBenchmark.json");
+
+	FParse::Value(*params, TEXT("Samples="), sampleCount);
+	FParse::Value(*params, TEXT("Iterations="), iterations);
+	FParse::Value(*params, TEXT("Seed="), seed);
+	FParse::Value(*params, TEXT("Output="), outputPath);
+	iterations = FMath::Max(1, iterations);
+	// The batch kernels take four at a time
+	sampleCount = Align(FMath::Max(4, sampleCount), 4);
+
+	Random.Initialize(seed);
+	TArray<FVector> normals;
+	TArray<FVector2D> inputs;
+	TArray<FVector> hints;
+	GravityMathReference::MakeSamples(Random, sampleCount, normals, inputs, hints);
+
+	// Wall rotations, as AdjustToWall computes them
+	TArray<FQuat> look, meshWall, mesh;
+	look.SetNum(sampleCount);
+	meshWall.SetNum(sampleCount);
+	mesh.SetNum(sampleCount);
+	const double kismetWallNs = GravityShiftBenchmark::TimeNsPerCall(sampleCount, iterations, [&](int32 i)
+	{
+		GravityMathReference::KismetWallRotations(normals[i], look[i], meshWall[i], mesh[i]);
+	});
+	const double mathWallNs = GravityShiftBenchmark::TimeNsPerCall(sampleCount, iterations, [&](int32 i)
+	{
+		GravityMathReference::MathWallRotations(normals[i], look[i], meshWall[i], mesh[i]);
+	});
+
+	// Mesh facing, as OrientMeshToWall computes it on the wall AdjustToWall left
+	TArray<FRotator> wallRotators;
+	wallRotators.Reserve(sampleCount);
+	for (const FQuat& rotation : meshWall)
+	{
+		wallRotators.Add(rotation.Rotator());
+	}
+	TArray<FQuat> facing;
+	facing.SetNum(sampleCount);
+	const double kismetFacingNs = GravityShiftBenchmark::TimeNsPerCall(sampleCount, iterations, [&](int32 i)
+	{
+		facing[i] = GravityMathReference::KismetMeshFacing(inputs[i], meshWall[i].GetAxisY(), look[i].GetAxisY(), normals[i], wallRotators[i], look[i]);
+	});
+	const double mathFacingNs = GravityShiftBenchmark::TimeNsPerCall(sampleCount, iterations, [&](int32 i)
+	{
+		facing[i] = GravityMathReference::MathMeshFacing(inputs[i], normals[i], wallRotators[i].Quaternion(), look[i]);
+	});
+
+	// Batched surface bases against one MakeSurfaceBasis call each
+	TArray<float> normalX, normalY, normalZ, hintX, hintY, hintZ, basisX, basisY, basisZ, basisW;
+	for (TArray<float>* values : { &normalX, &normalY, &normalZ, &hintX, &hintY, &hintZ, &basisX, &basisY, &basisZ, &basisW })
+	{
+		values->SetNumZeroed(sampleCount);
+	}
+	for (int32 i = 0; i < sampleCount; i++)
+	{
+		normalX[i] = normals[i].X;
+		normalY[i] = normals[i].Y;
+		normalZ[i] = normals[i].Z;
+		hintX[i] = hints[i].X;
+		hintY[i] = hints[i].Y;
+		hintZ[i] = hints[i].Z;
+	}
+
+	TArray<FQuat> scalarBases;
+	scalarBases.SetNum(sampleCount);
+	const double scalarBasisNs = GravityShiftBenchmark::TimeNsPerCall(sampleCount, iterations, [&](int32 i)
+	{
+		scalarBases[i] = GravityMath::MakeSurfaceBasis(normals[i], hints[i]);
+	});
+	const double batchStart = FPlatformTime::Seconds();
+	for (int32 iteration = 0; iteration < iterations; iteration++)
+	{
+		GravityMath::MakeSurfaceBases(normalX.GetData(), normalY.GetData(), normalZ.GetData(), hintX.GetData(), hintY.GetData(), hintZ.GetData(),
+			basisX.GetData(), basisY.GetData(), basisZ.GetData(), basisW.GetData(), sampleCount);
+	}
+	const double batchBasisNs = (FPlatformTime::Seconds() - batchStart) * 1e9 / ((double)sampleCount * iterations);
+
+	TArray<TSharedPtr<FJsonValue>> functions;
+	functions.Add(MakeShared<FJsonValueObject>(MakeMathReport(TEXT("AdjustToWall"), kismetWallNs, mathWallNs)));
+	functions.Add(MakeShared<FJsonValueObject>(MakeMathReport(TEXT("OrientMeshToWall"), kismetFacingNs, mathFacingNs)));
+	functions.Add(MakeShared<FJsonValueObject>(MakeMathReport(TEXT("MakeSurfaceBases"), scalarBasisNs, batchBasisNs)));
+
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetNumberField(TEXT("samples"), sampleCount);
+	report->SetNumberField(TEXT("iterations"), iterations);
+	report->SetArrayField(TEXT("functions"), functions);
+	return GravityShiftBenchmark::WriteReport(report, outputPath) ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftBenchmarkCommandlet.h"
+#include "GravityShiftBenchmarkHelpers.h"
+#include "GravitySurfaceProxyComponent.h"
+#include "GravitySurfaceProxySubsystem.h"
+#include "Engine/World.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectIterator.h"
+
+// Probe lengths of the character's defaults, WallRaycastLength and AimRaycastLength
+static constexpr float ProbeWallLength = 200;
+static constexpr float ProbeAimLength = 9000;
+
+// A proxy face is a box or convex face of the full collision, probes should land on it where they did before
+static constexpr double ProbeAgreementDistance = 15;
+static constexpr double ProbeAgreementDegrees = 10;
+
+/** Times the same probes against the full Visibility collision and the GravitySurface proxies, and counts where they land apart */
+static TSharedRef<FJsonObject> TimeSurfaceProbes(UWorld* world, const TCHAR* name, const TArray<FVector>& starts, const TArray<FVector>& ends,
+	const FCollisionShape* sweepShape, int32 iterations)
+{
+	const FCollisionQueryParams queryParams(SCENE_QUERY_STAT(GravityProbeBenchmark), false);
+	const int32 probeCount = starts.Num();
+	TArray<FHitResult> visibilityHits;
+	TArray<FHitResult> surfaceHits;
+	visibilityHits.SetNum(probeCount);
+	surfaceHits.SetNum(probeCount);
+
+	const auto probe = [&](int32 i, ECollisionChannel channel, FHitResult& outHit)
+	{
+		outHit = FHitResult(1.f);
+		if (sweepShape != nullptr)
+		{
+			world->SweepSingleByChannel(outHit, starts[i], ends[i], FQuat::Identity, channel, *sweepShape, queryParams);
+		}
+		else
+		{
+			world->LineTraceSingleByChannel(outHit, starts[i], ends[i], channel, queryParams);
+		}
+	};
+
+	const double visibilityNs = GravityShiftBenchmark::TimeNsPerCall(probeCount, iterations, [&](int32 i)
+	{
+		probe(i, ECC_Visibility, visibilityHits[i]);
+	});
+	const double surfaceNs = GravityShiftBenchmark::TimeNsPerCall(probeCount, iterations, [&](int32 i)
+	{
+		probe(i, ECC_GravitySurface, surfaceHits[i]);
+	});
+
+	int32 visibilityHitCount = 0;
+	int32 surfaceHitCount = 0;
+	int32 disagreements = 0;
+	const double agreementCos = FMath::Cos(FMath::DegreesToRadians(ProbeAgreementDegrees));
+	for (int32 i = 0; i < probeCount; i++)
+	{
+		const FHitResult& visibilityHit = visibilityHits[i];
+		const FHitResult& surfaceHit = surfaceHits[i];
+		visibilityHitCount += visibilityHit.bBlockingHit ? 1 : 0;
+		surfaceHitCount += surfaceHit.bBlockingHit ? 1 : 0;
+
+		if (visibilityHit.bBlockingHit != surfaceHit.bBlockingHit)
+		{
+			disagreements++;
+		}
+		else if (visibilityHit.bBlockingHit && (FVector::Dist(visibilityHit.ImpactPoint, surfaceHit.ImpactPoint) > ProbeAgreementDistance
+			|| FVector::DotProduct(visibilityHit.ImpactNormal, surfaceHit.ImpactNormal) < agreementCos))
+		{
+			disagreements++;
+		}
+	}
+
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetStringField(TEXT("name"), name);
+	report->SetNumberField(TEXT("visibilityNsPerProbe"), visibilityNs);
+	report->SetNumberField(TEXT("surfaceNsPerProbe"), surfaceNs);
+	report->SetNumberField(TEXT("speedup"), surfaceNs > 0 ? visibilityNs / surfaceNs : 0.0);
+	report->SetNumberField(TEXT("visibilityHits"), visibilityHitCount);
+	report->SetNumberField(TEXT("surfaceHits"), surfaceHitCount);
+	report->SetNumberField(TEXT("disagreements"), disagreements);
+	return report;
+}
+
+int32 UGravityShiftBenchmarkCommandlet::RunProbeBenchmark(const FString& params)
+{
+	int32 probeCount = 2000;
+	int32 iterations = 20;
+	int32 seed = 0;
+	FString mapName = TEXT("/Game/ThirdPerson/Maps/ThirdPersonMap");
+	FString outputPath = FPaths::ProjectSavedDir() / TEXT("GravityProbeBenchmark.json");
+
+	FParse::Value(*params, TEXT("Probes="), probeCount);
+	FParse::Value(*params, TEXT("Iterations="), iterations);
+	FParse::Value(*params, TEXT("Seed="), seed);
+	FParse::Value(*params, TEXT("Map="), mapName);
+	FParse::Value(*params, TEXT("Output="), outputPath);
+	probeCount = FMath::Max(1, probeCount);
+	iterations = FMath::Max(1, iterations);
+
+	if (LoadWorld(mapName) == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: could not load %s"), *mapName);
+		return 1;
+	}
+
+	// Built by UGravitySurfaceProxySubsystem as the map's levels came in
+	int32 proxyCount = 0;
+	TArray<FKBoxElem> boxes;
+	for (TObjectIterator<UGravitySurfaceProxyComponent> it; it; ++it)
+	{
+		if (it->GetWorld() == World && it->IsRegistered())
+		{
+			proxyCount++;
+			boxes.Append(it->GetBoxes());
+		}
+	}
+	if (boxes.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: no gravity surface proxies in %s"), *mapName);
+		DestroyWorld();
+		return 1;
+	}
+
+	// Each probe heads for a random point on a random proxy face, off its normal like a character at an angle to the wall
+	Random.Initialize(seed);
+	TArray<FVector> wallStarts, wallEnds, aimStarts, aimEnds;
+	for (int32 i = 0; i < probeCount; i++)
+	{
+		const FKBoxElem& box = boxes[Random.RandHelper(boxes.Num())];
+		const FQuat rotation = box.Rotation.Quaternion();
+		const FVector halfSize(box.X * 0.5f, box.Y * 0.5f, box.Z * 0.5f);
+		const int32 axis = Random.RandHelper(3);
+
+		FVector facePoint = box.Center;
+		FVector normal = FVector::ZeroVector;
+		for (int32 other = 0; other < 3; other++)
+		{
+			FVector unit = FVector::ZeroVector;
+			unit[other] = 1;
+			const FVector worldAxis = rotation.RotateVector(unit);
+			if (other == axis)
+			{
+				normal = worldAxis * (Random.FRand() < 0.5f ? -1 : 1);
+				facePoint += normal * halfSize[other];
+			}
+			else
+			{
+				facePoint += worldAxis * (Random.FRandRange(-1, 1) * halfSize[other]);
+			}
+		}
+
+		const FVector direction = -Random.VRandCone(normal, FMath::DegreesToRadians(20.0f));
+		wallStarts.Add(facePoint - (direction * Random.FRandRange(50, ProbeWallLength)));
+		wallEnds.Add(wallStarts.Last() + (direction * ProbeWallLength));
+		aimStarts.Add(facePoint - (direction * Random.FRandRange(500, 3000)));
+		aimEnds.Add(aimStarts.Last() + (direction * ProbeAimLength));
+	}
+
+	// The wall probes, the combined wall probe and landing prediction sweeps, and the camera aim
+	const FCollisionShape capsule = FCollisionShape::MakeCapsule(42, 96);
+	TArray<TSharedPtr<FJsonValue>> passes;
+	passes.Add(MakeShared<FJsonValueObject>(TimeSurfaceProbes(World, TEXT("WallLines"), wallStarts, wallEnds, nullptr, iterations)));
+	passes.Add(MakeShared<FJsonValueObject>(TimeSurfaceProbes(World, TEXT("WallSweeps"), wallStarts, wallEnds, &capsule, iterations)));
+	passes.Add(MakeShared<FJsonValueObject>(TimeSurfaceProbes(World, TEXT("AimLines"), aimStarts, aimEnds, nullptr, iterations)));
+
+	DestroyWorld();
+
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetStringField(TEXT("map"), mapName);
+	report->SetNumberField(TEXT("proxies"), proxyCount);
+	report->SetNumberField(TEXT("proxyBoxes"), boxes.Num());
+	report->SetNumberField(TEXT("probes"), probeCount);
+	report->SetNumberField(TEXT("iterations"), iterations);
+	report->SetArrayField(TEXT("passes"), passes);
+	return GravityShiftBenchmark::WriteReport(report, outputPath) ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftBenchmarkCommandlet.h"
+#include "GravityShiftBenchmarkHelpers.h"
+#include "GravityShiftRecording.h"
+#include "GravityShiftTiming.h"
+#include "ProtoGravityShiftCharacter.h"
+#include "Engine/World.h"
+#include "Misc/Paths.h"
+
+// Distance in cm a replay may drift before it counts as diverged from the recording
+static constexpr float ReplayDivergenceDistance = 10;
+
+int32 UGravityShiftBenchmarkCommandlet::RunReplay(const FString& params)
+{
+	FString recordingPath;
+	float resyncDistance = 0;
+	FString characterClassPath;
+	FString outputPath = FPaths::ProjectSavedDir() / TEXT("GravityShiftReplay.json");
+
+	FParse::Value(*params, TEXT("Recording="), recordingPath);
+	FParse::Value(*params, TEXT("Resync="), resyncDistance);
+	FParse::Value(*params, TEXT("CharacterClass="), characterClassPath);
+	FParse::Value(*params, TEXT("Output="), outputPath);
+
+	FGravityShiftRecordingReader reader;
+	FGravityShiftRecordFrame frame;
+	if (!reader.Open(recordingPath) || !reader.Next(frame))
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: %s is not a gravity shift recording"), *recordingPath);
+		return 1;
+	}
+
+	UClass* characterClass = GravityShiftBenchmark::LoadCharacterClass(characterClassPath);
+	if (characterClass == nullptr)
+	{
+		return 1;
+	}
+
+	if (LoadWorld(reader.GetMapName()) == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: could not load %s"), *reader.GetMapName());
+		return 1;
+	}
+
+	// Start from where the first frame ended up, the rest replay its input
+	FActorSpawnParameters spawnParams;
+	spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AProtoGravityShiftCharacter* character = World->SpawnActor<AProtoGravityShiftCharacter>(characterClass, frame.Location, frame.Rotation, spawnParams);
+	if (character == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: could not spawn %s"), *characterClass->GetName());
+		DestroyWorld();
+		return 1;
+	}
+	if (character->GetController() == nullptr)
+	{
+		character->SpawnDefaultController();
+	}
+	character->RestoreShiftState((EShiftState)frame.ShiftState, frame.GravityDirection);
+
+	const float deltaTime = 1.0f / reader.GetSampleRate();
+	TArray<double> frameTimes;
+	frameTimes.Reserve(reader.GetNumFrames());
+	double totalError = 0;
+	double maxError = 0;
+	int32 stateMismatches = 0;
+	int32 resyncs = 0;
+	int32 firstDivergentFrame = INDEX_NONE;
+
+	GravityShiftTiming::Reset();
+	GravityShiftTiming::SetRecording(true);
+
+	while (reader.Next(frame) && IsValid(character))
+	{
+		const double frameStart = FPlatformTime::Seconds();
+
+		// An AI controller ignores look input, so take the recorded aim as is
+		if (AController* controller = character->GetController())
+		{
+			controller->SetControlRotation(frame.ControlRotation);
+		}
+
+		// The camera aim isn't replayed, the direction it resolved to is
+		character->PlayInput(frame.Move, frame.Actions, frame.GravityDirection);
+
+		TickWorld(deltaTime);
+		frameTimes.Add((FPlatformTime::Seconds() - frameStart) * 1000.0);
+
+		const double error = FVector::Dist(character->GetActorLocation(), frame.Location);
+		const bool bStateMatches = (uint8)character->ShiftState == frame.ShiftState;
+		totalError += error;
+		maxError = FMath::Max(maxError, error);
+		stateMismatches += bStateMatches ? 0 : 1;
+		if (firstDivergentFrame == INDEX_NONE && (!bStateMatches || error > ReplayDivergenceDistance))
+		{
+			firstDivergentFrame = frameTimes.Num();
+		}
+
+		if (resyncDistance > 0 && (!bStateMatches || error > resyncDistance))
+		{
+			character->SetActorLocationAndRotation(frame.Location, frame.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+			if (!bStateMatches)
+			{
+				character->RestoreShiftState((EShiftState)frame.ShiftState, frame.GravityDirection);
+			}
+			resyncs++;
+		}
+	}
+
+	GravityShiftTiming::SetRecording(false);
+	DestroyWorld();
+
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetStringField(TEXT("recording"), recordingPath);
+	report->SetStringField(TEXT("map"), reader.GetMapName());
+	report->SetStringField(TEXT("characterClass"), characterClass->GetPathName());
+	report->SetNumberField(TEXT("sampleRate"), reader.GetSampleRate());
+	report->SetNumberField(TEXT("recordedFrames"), reader.GetNumFrames());
+	report->SetNumberField(TEXT("frames"), frameTimes.Num());
+	report->SetNumberField(TEXT("resyncDistance"), resyncDistance);
+	report->SetNumberField(TEXT("maxPositionError"), maxError);
+	report->SetNumberField(TEXT("meanPositionError"), frameTimes.Num() > 0 ? totalError / frameTimes.Num() : 0.0);
+	report->SetNumberField(TEXT("stateMismatches"), stateMismatches);
+	report->SetNumberField(TEXT("resyncs"), resyncs);
+	report->SetNumberField(TEXT("firstDivergentFrame"), firstDivergentFrame);
+	report->SetObjectField(TEXT("gameThread"), GravityShiftBenchmark::MakeFrameTimeReport(frameTimes));
+	report->SetArrayField(TEXT("functions"), GravityShiftBenchmark::MakeFunctionReport(frameTimes.Num()));
+	return GravityShiftBenchmark::WriteReport(report, outputPath) ? 0 : 1;
+}
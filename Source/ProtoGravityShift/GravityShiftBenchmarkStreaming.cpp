@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftBenchmarkCommandlet.h"
+#include "GravityShiftBenchmarkHelpers.h"
+#include "GravityShiftRecording.h"
+#include "ProtoGravityShiftCharacter.h"
+#include "Components/WorldPartitionStreamingSourceComponent.h"
+#include "Engine/World.h"
+#include "Misc/Paths.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+
+// Seconds spent levitating before each shift and standing after it
+static constexpr float StreamingLevitateTime = 0.5f;
+static constexpr float StreamingGroundTime = 1.0f;
+
+// Radius around the character that must be loaded for it to count as standing in loaded cells
+static constexpr float StreamingCheckRadius = 500;
+
+int32 UGravityShiftBenchmarkCommandlet::RunStreamingBenchmark(const FString& params)
+{
+	int32 shifts = 20;
+	float shiftTime = 3;
+	float deltaTime = 1.0f / 60.0f;
+	int32 seed = 0;
+	FString mapName = TEXT("/Game/ThirdPerson/Maps/ThirdPersonMap");
+	FString characterClassPath;
+	FString outputPath = FPaths::ProjectSavedDir() / TEXT("GravityStreamingBenchmark.json");
+
+	FParse::Value(*params, TEXT("Shifts="), shifts);
+	FParse::Value(*params, TEXT("ShiftTime="), shiftTime);
+	FParse::Value(*params, TEXT("DeltaTime="), deltaTime);
+	FParse::Value(*params, TEXT("Seed="), seed);
+	FParse::Value(*params, TEXT("Map="), mapName);
+	FParse::Value(*params, TEXT("CharacterClass="), characterClassPath);
+	FParse::Value(*params, TEXT("Output="), outputPath);
+
+	UClass* characterClass = GravityShiftBenchmark::LoadCharacterClass(characterClassPath);
+	if (characterClass == nullptr)
+	{
+		return 1;
+	}
+
+	// Same seed for both passes, so they fly the same shifts
+	const TSharedPtr<FJsonObject> reactive = RunStreamingPass(mapName, characterClass, seed, shifts, shiftTime, deltaTime, false);
+	const TSharedPtr<FJsonObject> predictive = RunStreamingPass(mapName, characterClass, seed, shifts, shiftTime, deltaTime, true);
+	if (!reactive.IsValid() || !predictive.IsValid())
+	{
+		return 1;
+	}
+
+	TSharedRef<FJsonObject> report = MakeShared<FJsonObject>();
+	report->SetStringField(TEXT("map"), mapName);
+	report->SetStringField(TEXT("characterClass"), characterClass->GetPathName());
+	report->SetNumberField(TEXT("shifts"), shifts);
+	report->SetNumberField(TEXT("shiftTime"), shiftTime);
+	report->SetNumberField(TEXT("deltaTime"), deltaTime);
+	report->SetObjectField(TEXT("reactive"), reactive);
+	report->SetObjectField(TEXT("predictive"), predictive);
+	return GravityShiftBenchmark::WriteReport(report, outputPath) ? 0 : 1;
+}
+
+TSharedPtr<FJsonObject> UGravityShiftBenchmarkCommandlet::RunStreamingPass(const FString& mapName, UClass* characterClass, int32 seed, int32 shifts,
+	float shiftTime, float deltaTime, bool bPredictShiftPath)
+{
+	if (LoadWorld(mapName, false) == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: could not load %s"), *mapName);
+		return nullptr;
+	}
+
+	UWorldPartitionSubsystem* worldPartition = World->GetSubsystem<UWorldPartitionSubsystem>();
+	SpawnShifters(1, characterClass);
+	AProtoGravityShiftCharacter* character = Shifters.Num() > 0 ? Shifters[0].Character.Get() : nullptr;
+	if (worldPartition == nullptr || character == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: %s needs World Partition and a spawnable character"), *mapName);
+		DestroyWorld();
+		return nullptr;
+	}
+
+	// What the player controller would stream around the character
+	UWorldPartitionStreamingSourceComponent* playerSource = NewObject<UWorldPartitionStreamingSourceComponent>(character);
+	playerSource->RegisterComponent();
+	playerSource->EnableStreamingSource();
+	character->GetShiftStreamingSource()->bPredictShiftPath = bPredictShiftPath;
+	WaitForStreaming();
+
+	Random.Initialize(seed);
+	TArray<double> frameTimes;
+	int32 unloadedFrames = 0;
+	int32 completedShifts = 0;
+	double shiftDistance = 0;
+
+	for (int32 shift = 0; shift < shifts && IsValid(character); shift++)
+	{
+		character->PlayInput(FVector2D::ZeroVector, GravityShiftRecording::ActionShift, FVector::ZeroVector);
+		for (float time = 0; time < StreamingLevitateTime; time += deltaTime)
+		{
+			TickWorld(deltaTime);
+		}
+
+		// Long and mostly level, the shifts that outrun streaming
+		const FRotator aim(Random.FRandRange(-10, 10), Random.FRandRange(0, 360), 0);
+		character->PlayInput(FVector2D::ZeroVector, GravityShiftRecording::ActionShift, aim.Vector());
+		const FVector shiftStart = character->GetActorLocation();
+
+		for (float time = 0; time < shiftTime && IsValid(character) && character->ShiftState == EShiftState::E_Accelerating; time += deltaTime)
+		{
+			const double frameStart = FPlatformTime::Seconds();
+			TickWorld(deltaTime);
+			frameTimes.Add((FPlatformTime::Seconds() - frameStart) * 1000.0);
+
+			if (IsValid(character))
+			{
+				FWorldPartitionStreamingQuerySource query(character->GetActorLocation());
+				query.Radius = StreamingCheckRadius;
+				query.bUseGridLoadingRange = false;
+				unloadedFrames += worldPartition->IsStreamingCompleted(EWorldPartitionRuntimeCellState::Activated, { query }, false) ? 0 : 1;
+			}
+		}
+
+		if (!IsValid(character))
+		{
+			break;
+		}
+		shiftDistance += FVector::Dist(shiftStart, character->GetActorLocation());
+		completedShifts++;
+
+		if (character->ShiftState != EShiftState::E_NoShift)
+		{
+			character->PlayInput(FVector2D::ZeroVector, GravityShiftRecording::ActionCancel, FVector::ZeroVector);
+		}
+		for (float time = 0; time < StreamingGroundTime; time += deltaTime)
+		{
+			TickWorld(deltaTime);
+		}
+	}
+
+	DestroyWorld();
+
+	TSharedRef<FJsonObject> pass = MakeShared<FJsonObject>();
+	pass->SetBoolField(TEXT("predictShiftPath"), bPredictShiftPath);
+	pass->SetNumberField(TEXT("completedShifts"), completedShifts);
+	pass->SetNumberField(TEXT("shiftFrames"), frameTimes.Num());
+	pass->SetNumberField(TEXT("unloadedFrames"), unloadedFrames);
+	pass->SetNumberField(TEXT("unloadedFraction"), frameTimes.Num() > 0 ? (double)unloadedFrames / frameTimes.Num() : 0.0);
+	pass->SetNumberField(TEXT("meanShiftDistance"), completedShifts > 0 ? shiftDistance / completedShifts : 0.0);
+	pass->SetObjectField(TEXT("gameThread"), GravityShiftBenchmark::MakeFrameTimeReport(frameTimes));
+	return pass;
+}
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftBenchmarkCommandlet.h"
+#include "GravityShiftSimBatch.h"
+#include "Async/ParallelFor.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+// Default step rate and per scenario timeout of the sweep, as in the standalone build
+static constexpr double TuningStepRate = 120;
+static constexpr double TuningTimeout = 10;
+
+static void ParseSimRange(const FString& params, const TCHAR* name, GravityShiftSim::FSimRange& outRange)
+{
+	// -Name=min:max:steps
+	FString value;
+	TArray<FString> parts;
+	if (FParse::Value(*params, name, value) && value.ParseIntoArray(parts, TEXT(":")) == 3)
+	{
+		outRange.Min = FCString::Atod(*parts[0]);
+		outRange.Max = FCString::Atod(*parts[1]);
+		outRange.Steps = FMath::Max(1, FCString::Atoi(*parts[2]));
+	}
+}
+
+int32 UGravityShiftBenchmarkCommandlet::RunTuningSweep(const FString& params)
+{
+	int32 scenarioCount = 64;
+	int32 seed = 1;
+	double stepRate = TuningStepRate;
+	double timeout = TuningTimeout;
+	FString outputPath = FPaths::ProjectSavedDir() / TEXT("GravityShiftTuning.csv");
+
+	GravityShiftSim::FSimSweep sweep;
+	FParse::Value(*params, TEXT("Scenarios="), scenarioCount);
+	FParse::Value(*params, TEXT("Seed="), seed);
+	FParse::Value(*params, TEXT("StepRate="), stepRate);
+	FParse::Value(*params, TEXT("Timeout="), timeout);
+	FParse::Value(*params, TEXT("Output="), outputPath);
+	ParseSimRange(params, TEXT("StartSpeed="), sweep.ShiftStartSpeed);
+	ParseSimRange(params, TEXT("Acceleration="), sweep.ShiftAcceleration);
+	ParseSimRange(params, TEXT("MaxSpeed="), sweep.MaxShiftSpeed);
+	ParseSimRange(params, TEXT("WallTransition="), sweep.WallTransitionDuration);
+	ParseSimRange(params, TEXT("BackToGroundTransition="), sweep.BackToGroundTransitionDuration);
+	stepRate = FMath::Max(1.0, stepRate);
+
+	// Same level, scenarios and step as the standalone build, so both give the same table
+	const GravityShiftSim::FSimParams base;
+	GravityShiftSim::FSimBoxLevel level;
+	GravityShiftSim::MakeTestLevel(level);
+	const std::vector<GravityShiftSim::FSimScenario> scenarios = GravityShiftSim::MakeTestScenarios(level, FMath::Max(1, scenarioCount), (uint32)seed, base.CapsuleRadius);
+
+	const int32 combinations = sweep.GetNumCombinations();
+	TArray<GravityShiftSim::FSimCombinationResult> results;
+	results.SetNum(combinations);
+
+	const double startTime = FPlatformTime::Seconds();
+	ParallelFor(combinations, [&](int32 index)
+	{
+		results[index] = GravityShiftSim::RunCombination(sweep.GetCombination(index, base), level, scenarios, 1 / stepRate, timeout);
+	});
+	const double seconds = FPlatformTime::Seconds() - startTime;
+
+	FString csv = ANSI_TO_TCHAR(GravityShiftSim::GetCsvHeader());
+	csv += LINE_TERMINATOR;
+	for (const GravityShiftSim::FSimCombinationResult& result : results)
+	{
+		csv += ANSI_TO_TCHAR(GravityShiftSim::FormatCsvRow(result).c_str());
+		csv += LINE_TERMINATOR;
+	}
+
+	if (!FFileHelper::SaveStringToFile(csv, *outputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("GravityShiftBenchmark: could not write %s"), *outputPath);
+		return 1;
+	}
+	UE_LOG(LogTemp, Display, TEXT("GravityShiftBenchmark: %d combinations x %d scenarios in %.2f s, written to %s"),
+		combinations, (int32)scenarios.size(), seconds, *outputPath);
+	return 0;
+}
@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftMassProcessors.h"
+#include "GravityShiftMassTypes.h"
+#include "GravityShiftSim.h"
+#include "GravitySurfaceIndex.h"
+#include "GravitySurfaceSubsystem.h"
+#include "MassCommonFragments.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+//////////////////////////////////////////////////////////////////////////
+// UGravityShiftProcessor
+
+UGravityShiftProcessor::UGravityShiftProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = (int32)EProcessorExecutionFlags::All;
+	ExecutionOrder.ExecuteInGroup = UE::Mass::ProcessorGroupNames::Movement;
+}
+
+void UGravityShiftProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FGravityDirectionFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FShiftSpeedFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FShiftStateFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FWallBasisFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FShiftMoveFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddConstSharedRequirement<FGravityShiftParamsFragment>();
+	EntityQuery.AddTagRequirement<FGravityShiftPromotedTag>(EMassFragmentPresence::None);
+}
+
+void UGravityShiftProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	// The index is immutable at runtime, so the worker threads can all read it
+	const UGravitySurfaceSubsystem* surfaceSubsystem = EntityManager.GetWorld()->GetSubsystem<UGravitySurfaceSubsystem>();
+	const AGravitySurfaceIndex* surfaceIndex = surfaceSubsystem != nullptr ? surfaceSubsystem->GetSurfaceIndex() : nullptr;
+
+	EntityQuery.ParallelForEachEntityChunk(EntityManager, Context, [surfaceIndex](FMassExecutionContext& chunkContext)
+	{
+		const float deltaTime = chunkContext.GetDeltaTimeSeconds();
+		const FGravityShiftParamsFragment& params = chunkContext.GetConstSharedFragment<FGravityShiftParamsFragment>();
+		const TArrayView<FTransformFragment> transforms = chunkContext.GetMutableFragmentView<FTransformFragment>();
+		const TArrayView<FGravityDirectionFragment> directions = chunkContext.GetMutableFragmentView<FGravityDirectionFragment>();
+		const TArrayView<FShiftSpeedFragment> speeds = chunkContext.GetMutableFragmentView<FShiftSpeedFragment>();
+		const TArrayView<FShiftStateFragment> states = chunkContext.GetMutableFragmentView<FShiftStateFragment>();
+		const TArrayView<FWallBasisFragment> wallBases = chunkContext.GetMutableFragmentView<FWallBasisFragment>();
+		const TConstArrayView<FShiftMoveFragment> moves = chunkContext.GetFragmentView<FShiftMoveFragment>();
+
+		for (int32 i = 0; i < chunkContext.GetNumEntities(); i++)
+		{
+			FTransform& transform = transforms[i].GetMutableTransform();
+			FVector& gravityDirection = directions[i].Value;
+			float& shiftSpeed = speeds[i].Value;
+			EShiftState& shiftState = states[i].Value;
+
+			if (shiftState == EShiftState::E_Accelerating)
+			{
+				shiftSpeed = (float)GravityShiftSim::AdvanceShiftSpeed(shiftSpeed, deltaTime, params.ShiftAcceleration, params.MaxShiftSpeed);
+				const FVector location = transform.GetLocation();
+				const float step = shiftSpeed * deltaTime;
+
+				FGravitySurfaceHit surfaceHit;
+				if (surfaceIndex != nullptr && surfaceIndex->Raycast(location, gravityDirection, step + params.AgentRadius, surfaceHit))
+				{
+					// Adhere to the surface the same way AdjustToWall does
+					const FGravitySurfacePatch& patch = *surfaceHit.Patch;
+					transform.SetLocation(surfaceHit.Location + (patch.Normal * params.AgentRadius));
+					wallBases[i].Normal = patch.Normal;
+					wallBases[i].Forward = patch.WallForward;
+					wallBases[i].Right = patch.WallRight;
+					gravityDirection = -patch.Normal;
+					shiftSpeed = params.ShiftStartSpeed;
+					shiftState = EShiftState::E_WallGrounded;
+				}
+				else
+				{
+					transform.SetLocation(location + (gravityDirection * step));
+				}
+			}
+			else if (shiftState == EShiftState::E_WallGrounded)
+			{
+				const FVector velocity = FVector::VectorPlaneProject(moves[i].DesiredVelocity, wallBases[i].Normal);
+				if (velocity.IsNearlyZero())
+				{
+					continue;
+				}
+
+				const FVector location = transform.GetLocation() + (velocity * deltaTime);
+				transform.SetLocation(location);
+
+				FGravitySurfaceHit surfaceHit;
+				if (surfaceIndex != nullptr && !surfaceIndex->Raycast(location, gravityDirection, params.WallProbeLength, surfaceHit))
+				{
+					// Walked off the wall, keep falling along the same gravity
+					shiftSpeed = params.ShiftStartSpeed;
+					shiftState = EShiftState::E_Accelerating;
+				}
+			}
+		}
+	});
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UGravityShiftPromotionProcessor
+
+UGravityShiftPromotionProcessor::UGravityShiftPromotionProcessor()
+	: SimulatedQuery(*this)
+	, PromotedQuery(*this)
+{
+	ExecutionFlags = (int32)(EProcessorExecutionFlags::Standalone | EProcessorExecutionFlags::Server);
+	ExecutionOrder.ExecuteAfter.Add(UE::Mass::ProcessorGroupNames::Movement);
+	// Spawns and destroys actors
+	bRequiresGameThreadExecution = true;
+}
+
+void UGravityShiftPromotionProcessor::ConfigureQueries()
+{
+	for (FMassEntityQuery* query : { &SimulatedQuery, &PromotedQuery })
+	{
+		query->AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadWrite);
+		query->AddRequirement<FGravityDirectionFragment>(EMassFragmentAccess::ReadWrite);
+		query->AddRequirement<FShiftSpeedFragment>(EMassFragmentAccess::ReadWrite);
+		query->AddRequirement<FShiftStateFragment>(EMassFragmentAccess::ReadWrite);
+		query->AddRequirement<FWallBasisFragment>(EMassFragmentAccess::ReadWrite);
+		query->AddRequirement<FGravityShiftActorFragment>(EMassFragmentAccess::ReadWrite);
+		query->AddConstSharedRequirement<FGravityShiftParamsFragment>();
+	}
+	SimulatedQuery.AddTagRequirement<FGravityShiftPromotedTag>(EMassFragmentPresence::None);
+	PromotedQuery.AddTagRequirement<FGravityShiftPromotedTag>(EMassFragmentPresence::All);
+}
+
+void UGravityShiftPromotionProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	UWorld* world = EntityManager.GetWorld();
+
+	TArray<FVector, TInlineAllocator<4>> viewerLocations;
+	for (FConstPlayerControllerIterator it = world->GetPlayerControllerIterator(); it; ++it)
+	{
+		if (const APawn* pawn = it->Get()->GetPawn())
+		{
+			viewerLocations.Add(pawn->GetActorLocation());
+		}
+	}
+
+	auto distanceToViewersSquared = [&viewerLocations](const FVector& location)
+	{
+		double closest = TNumericLimits<double>::Max();
+		for (const FVector& viewerLocation : viewerLocations)
+		{
+			closest = FMath::Min(closest, FVector::DistSquared(location, viewerLocation));
+		}
+		return closest;
+	};
+
+	SimulatedQuery.ForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& chunkContext)
+	{
+		const FGravityShiftParamsFragment& params = chunkContext.GetConstSharedFragment<FGravityShiftParamsFragment>();
+		const TConstArrayView<FTransformFragment> transforms = chunkContext.GetFragmentView<FTransformFragment>();
+		const TConstArrayView<FGravityDirectionFragment> directions = chunkContext.GetFragmentView<FGravityDirectionFragment>();
+		const TConstArrayView<FShiftSpeedFragment> speeds = chunkContext.GetFragmentView<FShiftSpeedFragment>();
+		const TConstArrayView<FShiftStateFragment> states = chunkContext.GetFragmentView<FShiftStateFragment>();
+		const TArrayView<FGravityShiftActorFragment> actors = chunkContext.GetMutableFragmentView<FGravityShiftActorFragment>();
+
+		for (int32 i = 0; i < chunkContext.GetNumEntities(); i++)
+		{
+			if (distanceToViewersSquared(transforms[i].GetTransform().GetLocation()) > FMath::Square(params.PromoteRadius))
+			{
+				continue;
+			}
+
+			FActorSpawnParameters spawnParams;
+			spawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+			UClass* characterClass = params.CharacterClass != nullptr ? params.CharacterClass.Get() : AProtoGravityShiftCharacter::StaticClass();
+			AProtoGravityShiftCharacter* character = world->SpawnActor<AProtoGravityShiftCharacter>(characterClass, transforms[i].GetTransform(), spawnParams);
+			if (character == nullptr)
+			{
+				continue;
+			}
+
+			if (character->GetController() == nullptr)
+			{
+				character->SpawnDefaultController();
+			}
+			character->RestoreShiftState(states[i].Value, directions[i].Value);
+			if (states[i].Value == EShiftState::E_Accelerating)
+			{
+				// The fall restarts at ShiftStartSpeed, carry on at the speed the entity had reached instead
+				UGravityShiftMovementComponent* movement = character->GetGravityMovement();
+				movement->RestorePredictedShift(movement->GetGravityDirection(), speeds[i].Value);
+			}
+
+			actors[i].Character = character;
+			chunkContext.Defer().AddTag<FGravityShiftPromotedTag>(chunkContext.GetEntity(i));
+		}
+	});
+
+	PromotedQuery.ForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& chunkContext)
+	{
+		const FGravityShiftParamsFragment& params = chunkContext.GetConstSharedFragment<FGravityShiftParamsFragment>();
+		const TArrayView<FTransformFragment> transforms = chunkContext.GetMutableFragmentView<FTransformFragment>();
+		const TArrayView<FGravityDirectionFragment> directions = chunkContext.GetMutableFragmentView<FGravityDirectionFragment>();
+		const TArrayView<FShiftSpeedFragment> speeds = chunkContext.GetMutableFragmentView<FShiftSpeedFragment>();
+		const TArrayView<FShiftStateFragment> states = chunkContext.GetMutableFragmentView<FShiftStateFragment>();
+		const TArrayView<FWallBasisFragment> wallBases = chunkContext.GetMutableFragmentView<FWallBasisFragment>();
+		const TArrayView<FGravityShiftActorFragment> actors = chunkContext.GetMutableFragmentView<FGravityShiftActorFragment>();
+
+		for (int32 i = 0; i < chunkContext.GetNumEntities(); i++)
+		{
+			AProtoGravityShiftCharacter* character = actors[i].Character.Get();
+			if (character == nullptr)
+			{
+				// Killed by gameplay, the entity goes with it. Simulating it again would promote it right back
+				chunkContext.Defer().DestroyEntity(chunkContext.GetEntity(i));
+				continue;
+			}
+
+			// The character is authoritative while promoted
+			transforms[i].GetMutableTransform() = character->GetActorTransform();
+			directions[i].Value = character->GetGravityDirection();
+			speeds[i].Value = character->GetGravityMovement()->GetCurrentShiftSpeed();
+			states[i].Value = character->ShiftState;
+			if (character->ShiftState == EShiftState::E_WallGrounded)
+			{
+				wallBases[i].Normal = character->GetWallNormal();
+				AGravitySurfaceIndex::MakeWallBasis(wallBases[i].Normal, wallBases[i].Forward, wallBases[i].Right);
+			}
+
+			if (distanceToViewersSquared(character->GetActorLocation()) > FMath::Square(params.DemoteRadius))
+			{
+				character->Destroy();
+				actors[i].Character = nullptr;
+				chunkContext.Defer().RemoveTag<FGravityShiftPromotedTag>(chunkContext.GetEntity(i));
+			}
+		}
+	});
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "MassEntityQuery.h"
+#include "GravityShiftMassProcessors.generated.h"
+
+/**
+ * Accelerate, adhere and wall-walk update for simulated shifters, run in parallel chunks.
+ * Adhesion only sees the baked surface index, dynamic actors are ignored until promotion.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravityShiftProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UGravityShiftProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+	FMassEntityQuery EntityQuery;
+};
+
+/**
+ * Spawns characters for the entities near a player pawn and hands them back to the
+ * simulation once they are far again. An entity whose character is destroyed by gameplay is destroyed too.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravityShiftPromotionProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UGravityShiftPromotionProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+	FMassEntityQuery SimulatedQuery;
+	FMassEntityQuery PromotedQuery;
+};
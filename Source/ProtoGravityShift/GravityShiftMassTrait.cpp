@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftMassTrait.h"
+#include "MassCommonFragments.h"
+#include "MassEntityTemplateRegistry.h"
+#include "MassEntityUtils.h"
+
+void UGravityShiftMassTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+	BuildContext.AddFragment<FTransformFragment>();
+	BuildContext.AddFragment<FGravityDirectionFragment>();
+	BuildContext.AddFragment<FShiftSpeedFragment>();
+	BuildContext.AddFragment<FShiftStateFragment>();
+	BuildContext.AddFragment<FWallBasisFragment>();
+	BuildContext.AddFragment<FShiftMoveFragment>();
+	BuildContext.AddFragment<FGravityShiftActorFragment>();
+
+	FMassEntityManager& entityManager = UE::Mass::Utils::GetEntityManagerChecked(World);
+	BuildContext.AddConstSharedFragment(entityManager.GetOrCreateConstSharedFragment(Params));
+}
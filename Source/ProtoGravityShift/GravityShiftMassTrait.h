@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTraitBase.h"
+#include "GravityShiftMassTypes.h"
+#include "GravityShiftMassTrait.generated.h"
+
+/**
+ * Makes a Mass entity a lightweight gravity shifter, simulated by UGravityShiftProcessor
+ * and promoted to a full AProtoGravityShiftCharacter near the players.
+ */
+UCLASS(meta = (DisplayName = "Gravity Shifter"))
+class PROTOGRAVITYSHIFT_API UGravityShiftMassTrait : public UMassEntityTraitBase
+{
+	GENERATED_BODY()
+
+protected:
+	virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	FGravityShiftParamsFragment Params;
+};
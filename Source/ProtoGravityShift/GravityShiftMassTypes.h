@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "ProtoGravityShiftCharacter.h"
+#include "GravityShiftMassTypes.generated.h"
+
+/** Each piece of shift state lives in its own fragment so the processors stream through tight arrays */
+
+USTRUCT()
+struct PROTOGRAVITYSHIFT_API FGravityDirectionFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	FVector Value = FVector::DownVector;
+};
+
+USTRUCT()
+struct PROTOGRAVITYSHIFT_API FShiftSpeedFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	/** Same as CurrentShiftAcceleration on the character, the current speed of the shift */
+	float Value = 0;
+};
+
+USTRUCT()
+struct PROTOGRAVITYSHIFT_API FShiftStateFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	EShiftState Value = EShiftState::E_NoShift;
+};
+
+USTRUCT()
+struct PROTOGRAVITYSHIFT_API FWallBasisFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	FVector Normal = FVector::UpVector;
+	FVector Forward = FVector::ForwardVector;
+	FVector Right = FVector::RightVector;
+};
+
+USTRUCT()
+struct PROTOGRAVITYSHIFT_API FShiftMoveFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	/** Requested velocity while wall grounded, written by whatever behaviour drives the shifter */
+	FVector DesiredVelocity = FVector::ZeroVector;
+};
+
+USTRUCT()
+struct PROTOGRAVITYSHIFT_API FGravityShiftActorFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	TWeakObjectPtr<AProtoGravityShiftCharacter> Character;
+};
+
+/** The entity is represented by a full character, which is authoritative until it is demoted */
+USTRUCT()
+struct PROTOGRAVITYSHIFT_API FGravityShiftPromotedTag : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct PROTOGRAVITYSHIFT_API FGravityShiftParamsFragment : public FMassConstSharedFragment
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float ShiftStartSpeed = 980;
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float ShiftAcceleration = 20;
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float MaxShiftSpeed = 10000;
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float WallProbeLength = 200;
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float AgentRadius = 42;
+
+	/** Entities closer than this to a player pawn become full characters */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float PromoteRadius = 3000;
+	/** Promoted characters further than this go back to the simulation, keep it above PromoteRadius */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float DemoteRadius = 3500;
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	TSubclassOf<AProtoGravityShiftCharacter> CharacterClass;
+};
@@ -0,0 +1,644 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftMovementComponent.h"
+#include "GravitySurfaceIndex.h"
+#include "GravitySurfaceSubsystem.h"
+#include "GravitySurfaceProxySubsystem.h"
+#include "GravityShiftStats.h"
+#include "GravityShiftSim.h"
+#include "ProtoGravityShiftCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+#include "UObject/UObjectIterator.h"
+
+static FAutoConsoleCommandWithWorld GravityShiftNetReportCommand(
+	TEXT("GravityShift.NetReport"),
+	TEXT("Logs the gravity shift move and replicated state bytes/s sent for each character since the last report"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&UGravityShiftMovementComponent::LogNetReport));
+
+UGravityShiftMovementComponent::UGravityShiftMovementComponent()
+{
+	GravityDirection = -FVector::UpVector;
+	ServerMoveGravityDirection = GravityDirection;
+
+	SetNetworkMoveDataContainer(NetworkMoveDataContainer);
+	SetMoveResponseDataContainer(MoveResponseDataContainer);
+}
+
+void UGravityShiftMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Built once, the wall probes run every frame while wall walking
+	WallQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(GravityWallProbe), false, GetOwner());
+	SurfaceSubsystem = GetWorld()->GetSubsystem<UGravitySurfaceSubsystem>();
+	QuerySubsystem = GetWorld()->GetSubsystem<UGravityQuerySubsystem>();
+	WallProbes[0].Register(GetWorld(), GetOwner(), WallQueryParams);
+	WallProbes[1].Register(GetWorld(), GetOwner(), WallQueryParams);
+	EdgeProbe.Register(GetWorld(), GetOwner(), WallQueryParams);
+}
+
+void UGravityShiftMovementComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	WallProbes[0].Unregister();
+	WallProbes[1].Unregister();
+	EdgeProbe.Unregister();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UGravityShiftMovementComponent::SetShiftParameters(float startSpeed, float acceleration, float maxSpeed, float wallProbeLength)
+{
+	ShiftStartSpeed = startSpeed;
+	ShiftAcceleration = acceleration;
+	MaxShiftSpeed = maxSpeed;
+	WallProbeLength = wallProbeLength;
+}
+
+// Mode transitions
+
+void UGravityShiftMovementComponent::EnterLevitate()
+{
+	Velocity = FVector::ZeroVector;
+	SetMovementMode(EMovementMode::MOVE_Custom, (uint8)EGravityMovementMode::CMOVE_Levitate);
+}
+
+void UGravityShiftMovementComponent::EnterShiftFall(const FVector& direction)
+{
+	GravityDirection = direction.GetSafeNormal();
+	CurrentShiftSpeed = ShiftStartSpeed;
+	SetMovementMode(EMovementMode::MOVE_Custom, (uint8)EGravityMovementMode::CMOVE_ShiftFall);
+}
+
+void UGravityShiftMovementComponent::EnterWallWalk(const FVector& wallNormal)
+{
+	const FVector previousUp = -GravityDirection;
+	GravityDirection = -wallNormal.GetSafeNormal();
+	CurrentShiftSpeed = ShiftStartSpeed;
+	WallProbes[0].Reset();
+	WallProbes[1].Reset();
+	EdgeProbe.Reset();
+	WallProbeCooldown = 0;
+	MarkSurfaceProbed();
+
+	// Wrapping onto the next face, carry the walk over the edge
+	if (IsGravityMovementMode(EGravityMovementMode::CMOVE_WallWalk))
+	{
+		Velocity = FQuat::FindBetweenNormals(previousUp, wallNormal.GetSafeNormal()).RotateVector(Velocity);
+		LastWallMoveDirection = Velocity.GetSafeNormal();
+		return;
+	}
+
+	StopMovementImmediately();
+	LastWallMoveDirection = FVector::ZeroVector;
+	SetMovementMode(EMovementMode::MOVE_Custom, (uint8)EGravityMovementMode::CMOVE_WallWalk);
+}
+
+void UGravityShiftMovementComponent::ExitGravityShift()
+{
+	GravityDirection = -FVector::UpVector;
+	SetMovementMode(EMovementMode::MOVE_Falling);
+}
+
+bool UGravityShiftMovementComponent::IsGravityMovementMode(EGravityMovementMode mode) const
+{
+	return MovementMode == EMovementMode::MOVE_Custom && CustomMovementMode == (uint8)mode;
+}
+
+float UGravityShiftMovementComponent::GetMaxSpeed() const
+{
+	if (IsGravityMovementMode(EGravityMovementMode::CMOVE_WallWalk))
+	{
+		return MaxWalkSpeed;
+	}
+	if (IsGravityMovementMode(EGravityMovementMode::CMOVE_ShiftFall))
+	{
+		return MaxShiftSpeed;
+	}
+	return Super::GetMaxSpeed();
+}
+
+float UGravityShiftMovementComponent::GetMaxBrakingDeceleration() const
+{
+	if (IsGravityMovementMode(EGravityMovementMode::CMOVE_WallWalk))
+	{
+		return BrakingDecelerationWalking;
+	}
+	return Super::GetMaxBrakingDeceleration();
+}
+
+void UGravityShiftMovementComponent::MarkShiftInput(double inputTime, uint64 inputFrame)
+{
+	bShiftInputPending = true;
+	ShiftInputTime = inputTime;
+	ShiftInputFrame = inputFrame;
+}
+
+// Networking
+
+FNetworkPredictionData_Client* UGravityShiftMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UGravityShiftMovementComponent* mutableThis = const_cast<UGravityShiftMovementComponent*>(this);
+		mutableThis->ClientPredictionData = new FNetworkPredictionData_Client_GravityShift(*this);
+	}
+	return ClientPredictionData;
+}
+
+void UGravityShiftMovementComponent::MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel)
+{
+	const FGravityShiftNetworkMoveData* moveData = static_cast<const FGravityShiftNetworkMoveData*>(GetCurrentNetworkMoveData());
+	AProtoGravityShiftCharacter* character = Cast<AProtoGravityShiftCharacter>(CharacterOwner);
+	if (moveData != nullptr && character != nullptr)
+	{
+		character->ApplyShiftRequest((EShiftState)moveData->ShiftState, moveData->GravityDirection);
+	}
+	ServerMoveGravityDirection = GravityDirection;
+
+	Super::MoveAutonomous(ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
+}
+
+void UGravityShiftMovementComponent::ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse)
+{
+	if (MoveResponse.IsCorrection())
+	{
+		const FGravityShiftMoveResponseDataContainer& shiftResponse = static_cast<const FGravityShiftMoveResponseDataContainer&>(MoveResponse);
+		AProtoGravityShiftCharacter* character = Cast<AProtoGravityShiftCharacter>(CharacterOwner);
+		if (character != nullptr && (uint8)character->ShiftState != shiftResponse.ShiftState)
+		{
+			character->RestoreShiftState((EShiftState)shiftResponse.ShiftState, shiftResponse.GravityDirection);
+		}
+		RestorePredictedShift(shiftResponse.GravityDirection, shiftResponse.ShiftSpeed);
+	}
+
+	Super::ClientHandleMoveResponse(MoveResponse);
+}
+
+bool UGravityShiftMovementComponent::ServerExceedsAllowablePositionError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation,
+	const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	if (MovementMode != EMovementMode::MOVE_Custom)
+	{
+		return Super::ServerExceedsAllowablePositionError(ClientTimeStamp, DeltaTime, Accel, ClientWorldLocation, RelativeClientLocation,
+			ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+	}
+
+	if (PackNetworkMovementMode() != ClientMovementMode)
+	{
+		return true;
+	}
+
+	// Moving the capsule can't fix a different gravity, it always needs a correction
+	const FGravityShiftNetworkMoveData* moveData = static_cast<const FGravityShiftNetworkMoveData*>(GetCurrentNetworkMoveData());
+	if (moveData != nullptr
+		&& FVector::DotProduct(moveData->GravityDirection, ServerMoveGravityDirection) < FMath::Cos(FMath::DegreesToRadians(GravityDirectionErrorTolerance)))
+	{
+		return true;
+	}
+
+	// A fast shift covers a lot of ground per frame, small drift is not worth snapping the client back
+	return FVector::DistSquared(UpdatedComponent->GetComponentLocation(), ClientWorldLocation) > FMath::Square(ShiftPositionErrorTolerance);
+}
+
+void UGravityShiftMovementComponent::RestorePredictedShift(const FVector& gravityDirection, float shiftSpeed)
+{
+	GravityDirection = gravityDirection;
+	CurrentShiftSpeed = shiftSpeed;
+}
+
+void UGravityShiftMovementComponent::CountNetPayload(int32 bits)
+{
+	if (NetPayloadBits == 0)
+	{
+		NetPayloadStartTime = FPlatformTime::Seconds();
+	}
+	NetPayloadBits += bits;
+}
+
+void UGravityShiftMovementComponent::LogNetReport(UWorld* world)
+{
+	const double now = FPlatformTime::Seconds();
+	for (TObjectIterator<UGravityShiftMovementComponent> it; it; ++it)
+	{
+		UGravityShiftMovementComponent* movement = *it;
+		if (movement->GetWorld() != world)
+		{
+			continue;
+		}
+
+		double stateSeconds = 0;
+		int32 stateConnections = 0;
+		AProtoGravityShiftCharacter* character = Cast<AProtoGravityShiftCharacter>(movement->CharacterOwner);
+		const uint64 stateBits = character != nullptr ? character->TakeReplicatedStateBits(stateSeconds, stateConnections) : 0;
+		if (movement->NetPayloadBits == 0 && stateBits == 0)
+		{
+			continue;
+		}
+
+		// Rates over at least a second, so a report right after the first packet doesn't blow up
+		const double moveSeconds = movement->NetPayloadBits > 0 ? now - movement->NetPayloadStartTime : 0;
+		const double moveBytesPerSecond = (movement->NetPayloadBits / 8.0) / FMath::Max(moveSeconds, 1.0);
+		const double stateBytesPerSecond = (stateBits / 8.0) / FMath::Max(stateSeconds, 1.0);
+		UE_LOG(LogTemp, Log, TEXT("%s: %.1f move bytes/s, %.1f state bytes/s to %d proxy connections (%.1f each)"), *GetNameSafe(movement->GetOwner()),
+			moveBytesPerSecond, stateBytesPerSecond, stateConnections, stateConnections > 0 ? stateBytesPerSecond / stateConnections : 0.0);
+		movement->NetPayloadBits = 0;
+	}
+}
+
+// Physics
+
+void UGravityShiftMovementComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	switch ((EGravityMovementMode)CustomMovementMode)
+	{
+	case EGravityMovementMode::CMOVE_Levitate:
+		PhysLevitate(deltaTime, Iterations);
+		break;
+	case EGravityMovementMode::CMOVE_ShiftFall:
+		PhysShiftFall(deltaTime, Iterations);
+		break;
+	case EGravityMovementMode::CMOVE_WallWalk:
+		PhysWallWalk(deltaTime, Iterations);
+		break;
+	default:
+		Super::PhysCustom(deltaTime, Iterations);
+		break;
+	}
+}
+
+void UGravityShiftMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+{
+	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+
+	if (bShiftInputPending)
+	{
+		bShiftInputPending = false;
+		GravityShiftStats::RecordInputLatency(FPlatformTime::Seconds() - ShiftInputTime, GFrameCounter - ShiftInputFrame);
+	}
+}
+
+void UGravityShiftMovementComponent::PhysLevitate(float deltaTime, int32 Iterations)
+{
+	// Levitating holds the character in place, there is nothing to move
+	Velocity = FVector::ZeroVector;
+}
+
+void UGravityShiftMovementComponent::PhysShiftFall(float deltaTime, int32 Iterations)
+{
+	GRAVITY_SHIFT_SCOPE(PhysShiftFall);
+
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	// Fast shifts sweep at most this far at once, so a low frame rate can't carry the capsule through thin geometry
+	const float maxSubstepDistance = FMath::Max(CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleRadius() * ShiftSubstepRadiusScale, 1.0f);
+
+	float remainingTime = deltaTime;
+	while ((remainingTime >= MIN_TICK_TIME) && (Iterations < MaxSimulationIterations) && CharacterOwner)
+	{
+		Iterations++;
+		const float timeTick = GetSimulationTimeStep(remainingTime, Iterations);
+		remainingTime -= timeTick;
+
+		int32 substeps = 1;
+		if (CurrentShiftSpeed >= ShiftSubstepSpeed)
+		{
+			const float tickDistance = (float)GravityShiftSim::AdvanceShiftSpeed(CurrentShiftSpeed, timeTick, ShiftAcceleration, MaxShiftSpeed) * timeTick;
+			// Not capped: the last iteration gets all the time left, and a cap would stretch its sweeps past the limit
+			substeps = FMath::Max(FMath::CeilToInt32(tickDistance / maxSubstepDistance), 1);
+			INC_DWORD_STAT_BY(STAT_GravityShift_ShiftSubsteps, substeps);
+		}
+
+		const float substepTime = timeTick / substeps;
+		for (int32 substep = 0; substep < substeps; substep++)
+		{
+			CurrentShiftSpeed = (float)GravityShiftSim::AdvanceShiftSpeed(CurrentShiftSpeed, substepTime, ShiftAcceleration, MaxShiftSpeed);
+			Velocity = GravityDirection * CurrentShiftSpeed;
+
+			const FVector delta = Velocity * substepTime;
+			FHitResult hit(1.f);
+			SafeMoveUpdatedComponent(delta, UpdatedComponent->GetComponentQuat(), true, hit);
+
+			if (hit.bBlockingHit)
+			{
+				HandleImpact(hit, substepTime, delta);
+				// The owner adheres to the surface at the first contact, which moves us out of this mode
+				OnShiftSurfaceHit.ExecuteIfBound(hit);
+				return;
+			}
+		}
+	}
+}
+
+void UGravityShiftMovementComponent::PhysWallWalk(float deltaTime, int32 Iterations)
+{
+	GRAVITY_SHIFT_SCOPE(PhysWallWalk);
+
+	if (deltaTime < MIN_TICK_TIME)
+	{
+		return;
+	}
+
+	if (bAsyncWallProbes)
+	{
+		// Result of the probes requested after an earlier move
+		bool bOnWall = true;
+		FHitResult surfaceHit;
+		if (ConsumeWallProbes(bOnWall, surfaceHit))
+		{
+			FVector edgeStart;
+			FVector edgeEnd;
+			if (!bOnWall && GetEdgeProbe(edgeStart, edgeEnd))
+			{
+				EdgeProbe.RequestLine(edgeStart, edgeEnd, UGravitySurfaceProxySubsystem::GetTraceChannel());
+			}
+			else if (!bOnWall)
+			{
+				LoseWallContact(deltaTime, Iterations);
+				return;
+			}
+			else if (IsSurfaceTurn(surfaceHit.ImpactNormal, SurfaceFollowAngle))
+			{
+				WrapToSurface(surfaceHit);
+			}
+		}
+
+		// Keeps walking while the edge probe waits for the budget, like the wall probes do
+		bool bEdgeHit = false;
+		FHitResult edgeHit;
+		if (EdgeProbe.Consume(bEdgeHit, edgeHit) && !WrapOverEdge(bEdgeHit, edgeHit))
+		{
+			LoseWallContact(deltaTime, Iterations);
+			return;
+		}
+	}
+
+	bool bMoved = false;
+	float remainingTime = deltaTime;
+	while ((remainingTime >= MIN_TICK_TIME) && (Iterations < MaxSimulationIterations) && CharacterOwner)
+	{
+		Iterations++;
+		const float timeTick = GetSimulationTimeStep(remainingTime, Iterations);
+		remainingTime -= timeTick;
+
+		// Walking happens in the wall plane, gravity only keeps us attached to it
+		Acceleration = FVector::VectorPlaneProject(Acceleration, GravityDirection);
+		CalcVelocity(timeTick, GroundFriction, false, GetMaxBrakingDeceleration());
+		Velocity = FVector::VectorPlaneProject(Velocity, GravityDirection);
+
+		const FVector delta = Velocity * timeTick;
+		if (delta.IsNearlyZero())
+		{
+			// Standing still on a static wall, the last probe is still valid
+			break;
+		}
+
+		FHitResult hit(1.f);
+		SafeMoveUpdatedComponent(delta, UpdatedComponent->GetComponentQuat(), true, hit);
+		if (hit.Time < 1.f)
+		{
+			HandleImpact(hit, timeTick, delta);
+
+			// Walked into a concave corner, climb onto the other face
+			if (bWrapSurfaceEdges && hit.bBlockingHit && IsSurfaceTurn(hit.ImpactNormal, SurfaceWrapAngle))
+			{
+				WrapToSurface(hit);
+				return;
+			}
+			SlideAlongSurface(delta, 1.f - hit.Time, hit.Normal, hit, true);
+		}
+		bMoved = true;
+		LastWallMoveDirection = delta.GetSafeNormal();
+
+		if (bAsyncWallProbes || !NeedsSurfaceProbe())
+		{
+			continue;
+		}
+
+		// Static walls are answered by the surface index, only dynamic ones need a trace
+		MarkSurfaceProbed();
+		FHitResult floorHit;
+		if (FindIndexedGravityFloor(floorHit) || FindGravityFloor(floorHit))
+		{
+			if (IsSurfaceTurn(floorHit.ImpactNormal, SurfaceFollowAngle))
+			{
+				WrapToSurface(floorHit);
+			}
+		}
+		else if (!WrapOverEdge())
+		{
+			LoseWallContact(remainingTime, Iterations);
+			return;
+		}
+	}
+
+	// Until the character moved far enough, and the next probe is due, the last result stands
+	WallProbeCooldown -= deltaTime;
+	if (bAsyncWallProbes && bMoved && WallProbeCooldown <= 0 && !EdgeProbe.IsPending() && NeedsSurfaceProbe())
+	{
+		WallProbeCooldown = WallProbeInterval;
+		MarkSurfaceProbed();
+
+		FHitResult indexedHit;
+		if (!FindIndexedGravityFloor(indexedHit))
+		{
+			RequestWallProbes();
+		}
+		else if (IsSurfaceTurn(indexedHit.ImpactNormal, SurfaceFollowAngle))
+		{
+			WrapToSurface(indexedHit);
+		}
+	}
+}
+
+bool UGravityShiftMovementComponent::NeedsSurfaceProbe() const
+{
+	return FVector::DistSquared(UpdatedComponent->GetComponentLocation(), SurfaceProbeLocation) > FMath::Square(SurfaceProbeDistance)
+		|| UpdatedComponent->GetComponentQuat().AngularDistance(SurfaceProbeRotation) > FMath::DegreesToRadians(SurfaceProbeAngle);
+}
+
+void UGravityShiftMovementComponent::MarkSurfaceProbed()
+{
+	SurfaceProbeLocation = UpdatedComponent->GetComponentLocation();
+	SurfaceProbeRotation = UpdatedComponent->GetComponentQuat();
+}
+
+bool UGravityShiftMovementComponent::IsSurfaceTurn(const FVector& normal, float angle) const
+{
+	return FVector::DotProduct(normal, -GravityDirection) < FMath::Cos(FMath::DegreesToRadians(angle));
+}
+
+void UGravityShiftMovementComponent::WrapToSurface(const FHitResult& hit)
+{
+	// A capsule hit normal is rounded over the edge, the owner needs the face itself
+	FHitResult surfaceHit = hit;
+	surfaceHit.Normal = hit.ImpactNormal;
+	OnShiftSurfaceHit.ExecuteIfBound(surfaceHit);
+}
+
+bool UGravityShiftMovementComponent::GetEdgeProbe(FVector& outStart, FVector& outEnd) const
+{
+	if (!bWrapSurfaceEdges || LastWallMoveDirection.IsNearlyZero())
+	{
+		return false;
+	}
+
+	// Past a convex edge the face we walked over is behind us, below the surface we left
+	outStart = UpdatedComponent->GetComponentLocation() + (GravityDirection * WallProbeLength);
+	outEnd = outStart - (LastWallMoveDirection * EdgeWrapDistance);
+	return true;
+}
+
+bool UGravityShiftMovementComponent::WrapOverEdge()
+{
+	FVector start;
+	FVector end;
+	if (!GetEdgeProbe(start, end))
+	{
+		return false;
+	}
+
+	FHitResult hit;
+	const bool bHit = LineTraceNow(hit, start, end);
+	return WrapOverEdge(bHit, hit);
+}
+
+bool UGravityShiftMovementComponent::WrapOverEdge(bool bHit, const FHitResult& hit)
+{
+	if (!bHit || !IsSurfaceTurn(hit.ImpactNormal, SurfaceWrapAngle))
+	{
+		return false;
+	}
+
+	WrapToSurface(hit);
+	return true;
+}
+
+void UGravityShiftMovementComponent::LoseWallContact(float remainingTime, int32 Iterations)
+{
+	// Walked off the wall, keep falling along the same gravity
+	EnterShiftFall(GravityDirection);
+	OnWallContactLost.ExecuteIfBound();
+	StartNewPhysics(remainingTime, Iterations);
+}
+
+bool UGravityShiftMovementComponent::FindGravityFloor(FHitResult& outHit) const
+{
+	GRAVITY_SHIFT_STAT_SCOPE(FindGravityFloor);
+
+	const UCapsuleComponent* capsule = CharacterOwner->GetCapsuleComponent();
+	const FVector location = UpdatedComponent->GetComponentLocation();
+	const FVector probe = GravityDirection * WallProbeLength;
+
+	if (bCombineWallProbes)
+	{
+		return SweepNow(outHit, location, location + probe);
+	}
+
+	const FVector capsuleOffset = FVector::UpVector * capsule->GetScaledCapsuleHalfHeight();
+
+	const FVector startTopPoint = location + capsuleOffset;
+	if (LineTraceNow(outHit, startTopPoint, startTopPoint + probe))
+	{
+		return true;
+	}
+
+	const FVector startBottomPoint = location - capsuleOffset;
+	return LineTraceNow(outHit, startBottomPoint, startBottomPoint + probe);
+}
+
+bool UGravityShiftMovementComponent::LineTraceNow(FHitResult& outHit, const FVector& start, const FVector& end) const
+{
+	const ECollisionChannel channel = UGravitySurfaceProxySubsystem::GetTraceChannel();
+	if (QuerySubsystem != nullptr)
+	{
+		return QuerySubsystem->LineTraceNow(outHit, start, end, channel, WallQueryParams);
+	}
+
+	INC_DWORD_STAT(STAT_GravityShift_Traces);
+	return GetWorld()->LineTraceSingleByChannel(outHit, start, end, channel, WallQueryParams);
+}
+
+bool UGravityShiftMovementComponent::SweepNow(FHitResult& outHit, const FVector& start, const FVector& end) const
+{
+	const UCapsuleComponent* capsule = CharacterOwner->GetCapsuleComponent();
+	const ECollisionChannel channel = UGravitySurfaceProxySubsystem::GetTraceChannel();
+	if (QuerySubsystem != nullptr)
+	{
+		return QuerySubsystem->SweepNow(outHit, start, end, capsule->GetComponentQuat(), capsule->GetCollisionShape(), channel, WallQueryParams);
+	}
+
+	INC_DWORD_STAT(STAT_GravityShift_Traces);
+	return GetWorld()->SweepSingleByChannel(outHit, start, end, capsule->GetComponentQuat(), channel, capsule->GetCollisionShape(), WallQueryParams);
+}
+
+bool UGravityShiftMovementComponent::FindIndexedGravityFloor(FHitResult& outHit) const
+{
+	GRAVITY_SHIFT_STAT_SCOPE(FindIndexedGravityFloor);
+
+	const AGravitySurfaceIndex* surfaceIndex = SurfaceSubsystem != nullptr ? SurfaceSubsystem->GetSurfaceIndex() : nullptr;
+	if (surfaceIndex == nullptr)
+	{
+		return false;
+	}
+
+	const FVector location = UpdatedComponent->GetComponentLocation();
+	const FVector capsuleOffset = FVector::UpVector * CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+
+	FGravitySurfaceHit surfaceHit;
+	if (!surfaceIndex->Raycast(location + capsuleOffset, GravityDirection, WallProbeLength, surfaceHit)
+		&& !surfaceIndex->Raycast(location - capsuleOffset, GravityDirection, WallProbeLength, surfaceHit))
+	{
+		return false;
+	}
+
+	outHit = FHitResult(1.f);
+	outHit.bBlockingHit = true;
+	outHit.Location = outHit.ImpactPoint = surfaceHit.Location;
+	outHit.Normal = outHit.ImpactNormal = surfaceHit.Patch->Normal;
+	return true;
+}
+
+void UGravityShiftMovementComponent::RequestWallProbes()
+{
+	const UCapsuleComponent* capsule = CharacterOwner->GetCapsuleComponent();
+	const FVector location = UpdatedComponent->GetComponentLocation();
+	const FVector probe = GravityDirection * WallProbeLength;
+	const ECollisionChannel channel = UGravitySurfaceProxySubsystem::GetTraceChannel();
+
+	if (bCombineWallProbes)
+	{
+		WallProbes[0].RequestSweep(location, location + probe, capsule->GetComponentQuat(), capsule->GetCollisionShape(), channel);
+		return;
+	}
+
+	const FVector capsuleOffset = FVector::UpVector * capsule->GetScaledCapsuleHalfHeight();
+	WallProbes[0].RequestLine(location + capsuleOffset, location + capsuleOffset + probe, channel);
+	WallProbes[1].RequestLine(location - capsuleOffset, location - capsuleOffset + probe, channel);
+}
+
+bool UGravityShiftMovementComponent::ConsumeWallProbes(bool& bOutOnWall, FHitResult& outHit)
+{
+	// The budget may have run only one of the pair this frame, wait for both
+	if (WallProbes[0].IsPending() || WallProbes[1].IsPending())
+	{
+		return false;
+	}
+
+	bool bTopHit = false;
+	bool bBottomHit = false;
+	FHitResult bottomHit;
+	const bool bTopReady = WallProbes[0].Consume(bTopHit, outHit);
+	const bool bBottomReady = WallProbes[1].Consume(bBottomHit, bottomHit);
+	if (!bTopHit && bBottomHit)
+	{
+		outHit = bottomHit;
+	}
+
+	bOutOnWall = bTopHit || bBottomHit;
+	return bTopReady || bBottomReady;
+}
@@ -0,0 +1,212 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GravityQuerySubsystem.h"
+#include "GravityShiftNetworking.h"
+#include "GravityShiftMovementComponent.generated.h"
+
+/** Custom movement modes used while the character's gravity is shifted */
+UENUM(BlueprintType)
+enum class EGravityMovementMode : uint8
+{
+	CMOVE_None			UMETA(Hidden),
+	CMOVE_Levitate		UMETA(DisplayName = "Levitate"),
+	CMOVE_ShiftFall		UMETA(DisplayName = "ShiftFall"),
+	CMOVE_WallWalk		UMETA(DisplayName = "WallWalk"),
+	CMOVE_MAX			UMETA(Hidden),
+};
+
+DECLARE_DELEGATE_OneParam(FOnGravitySurfaceHit, const FHitResult&);
+
+/**
+ * Character movement that simulates the gravity shift natively: levitating in place,
+ * falling along an arbitrary GravityDirection and walking on the surface it lands on.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravityShiftMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGravityShiftMovementComponent();
+
+	void SetShiftParameters(float startSpeed, float acceleration, float maxSpeed, float wallProbeLength);
+
+	void EnterLevitate();
+	void EnterShiftFall(const FVector& direction);
+	void EnterWallWalk(const FVector& wallNormal);
+	void ExitGravityShift();
+
+	bool IsGravityMovementMode(EGravityMovementMode mode) const;
+
+	FORCEINLINE const FVector& GetGravityDirection() const { return GravityDirection; }
+	FORCEINLINE float GetCurrentShiftSpeed() const { return CurrentShiftSpeed; }
+
+	/** Rewinds the shift to a saved move before it is replayed, or picks up a shift simulated elsewhere */
+	void RestorePredictedShift(const FVector& gravityDirection, float shiftSpeed);
+
+	void CountNetPayload(int32 bits);
+
+	/** Times the player input that started the current transition, reported once the next move has applied it */
+	void MarkShiftInput(double inputTime, uint64 inputFrame);
+
+	/** Seconds between async wall probes, 0 probes every frame. Raised for shifters far from any viewer */
+	FORCEINLINE void SetWallProbeInterval(float interval) { WallProbeInterval = interval; }
+
+	/** Logs the shift move payload and replicated state bytes/s of each character of world since the last report, GravityShift.NetReport */
+	static void LogNetReport(UWorld* world);
+
+	/** Called when a shift fall runs into a blocking surface, or wall walking wraps onto another one */
+	FOnGravitySurfaceHit OnShiftSurfaceHit;
+
+	/** Called when wall walking no longer finds a surface along GravityDirection, nor one to wrap onto */
+	FSimpleDelegate OnWallContactLost;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
+
+	virtual float GetMaxSpeed() const override;
+	virtual float GetMaxBrakingDeceleration() const override;
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual void MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) override;
+	virtual void ClientHandleMoveResponse(const FCharacterMoveResponseDataContainer& MoveResponse) override;
+	virtual bool ServerExceedsAllowablePositionError(float ClientTimeStamp, float DeltaTime, const FVector& Accel, const FVector& ClientWorldLocation,
+		const FVector& RelativeClientLocation, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+
+private:
+	void PhysLevitate(float deltaTime, int32 Iterations);
+	void PhysShiftFall(float deltaTime, int32 Iterations);
+	void PhysWallWalk(float deltaTime, int32 Iterations);
+
+	void LoseWallContact(float remainingTime, int32 Iterations);
+
+	/** Probes from the capsule top and bottom along GravityDirection, like the old ApplyWallGravity */
+	bool FindGravityFloor(FHitResult& outHit) const;
+
+	/** Queries that can't wait for the schedule, their time comes out of the frame's query budget */
+	bool LineTraceNow(FHitResult& outHit, const FVector& start, const FVector& end) const;
+	bool SweepNow(FHitResult& outHit, const FVector& start, const FVector& end) const;
+
+	/** Same probes against the baked static surfaces, false when the map has none there */
+	bool FindIndexedGravityFloor(FHitResult& outHit) const;
+
+	void RequestWallProbes();
+	bool ConsumeWallProbes(bool& bOutOnWall, FHitResult& outHit);
+
+	/** The surface is only probed again once the character moved or turned far enough from the last probe */
+	bool NeedsSurfaceProbe() const;
+	void MarkSurfaceProbed();
+
+	/** True when normal turns away from the current surface by more than angle degrees */
+	bool IsSurfaceTurn(const FVector& normal, float angle) const;
+
+	/** Hands a new surface to the owner, which re-enters wall walk on it */
+	void WrapToSurface(const FHitResult& hit);
+
+	/** Line from below the lost surface back towards the face of the edge we walked over, false when there is nothing to look for */
+	bool GetEdgeProbe(FVector& outStart, FVector& outEnd) const;
+
+	/** Looks back for the edge face right away and wraps onto it */
+	bool WrapOverEdge();
+
+	/** Wraps onto the edge probe's hit, false when it found no face to wrap onto */
+	bool WrapOverEdge(bool bHit, const FHitResult& hit);
+
+	/** Run the wall probes through the frame's query budget, their result is used on a later frame */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	bool bAsyncWallProbes = true;
+
+	/** Replace the capsule top and bottom line probes by a single capsule sweep */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	bool bCombineWallProbes = false;
+
+	/** Walk over convex edges and up into concave corners instead of falling off or sliding */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	bool bWrapSurfaceEdges = true;
+
+	/** Distance in cm walked on a surface before it is probed again */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float SurfaceProbeDistance = 30;
+
+	/** Degrees the capsule turns on a surface before it is probed again */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float SurfaceProbeAngle = 10;
+
+	/** Probed surfaces tilted further than this many degrees from the current one are followed, e.g. over curved ground */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float SurfaceFollowAngle = 5;
+
+	/** Faces walked into at more than this many degrees to the current surface are climbed onto */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float SurfaceWrapAngle = 30;
+
+	/** How far back the edge face is searched for after walking off a surface */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float EdgeWrapDistance = 300;
+
+	/** Shift speed in cm/s from which each move is split into several sweeps */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float ShiftSubstepSpeed = 2000;
+
+	/** Longest sweep of a fast shift, as a fraction of the capsule radius. A frame hitch costs as many sweeps as it takes */
+	UPROPERTY(EditAnywhere, Category = GravityShift, meta = (ClampMin = "0.1"))
+	float ShiftSubstepRadiusScale = 1;
+
+	FVector GravityDirection;
+
+	FVector SurfaceProbeLocation = FVector::ZeroVector;
+	FQuat SurfaceProbeRotation = FQuat::Identity;
+	FVector LastWallMoveDirection = FVector::ZeroVector;
+
+	float CurrentShiftSpeed = 0;
+	float ShiftStartSpeed = 980;
+	float ShiftAcceleration = 20;
+	float MaxShiftSpeed = 10000;
+	float WallProbeLength = 200;
+
+	FCollisionQueryParams WallQueryParams;
+
+	UPROPERTY()
+	class UGravitySurfaceSubsystem* SurfaceSubsystem = nullptr;
+
+	UPROPERTY()
+	UGravityQuerySubsystem* QuerySubsystem = nullptr;
+
+	/** Top and bottom line probes, or only the first one when combined into a sweep */
+	FGravityScheduledProbe WallProbes[2];
+
+	/** Sent once the wall probes lost the surface, decides between wrapping over the edge and falling off */
+	FGravityScheduledProbe EdgeProbe;
+
+	float WallProbeInterval = 0;
+	float WallProbeCooldown = 0;
+
+	/** Distance in cm a client may drift from the server while shifting before it is corrected */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float ShiftPositionErrorTolerance = 25;
+
+	/** Angle in degrees between client and server gravity before the client is corrected */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float GravityDirectionErrorTolerance = 2;
+
+	/** Server gravity at the start of the move being checked, once the client's request is applied */
+	FVector ServerMoveGravityDirection;
+
+	FGravityShiftNetworkMoveDataContainer NetworkMoveDataContainer;
+	FGravityShiftMoveResponseDataContainer MoveResponseDataContainer;
+
+	bool bShiftInputPending = false;
+	double ShiftInputTime = 0;
+	uint64 ShiftInputFrame = 0;
+
+	uint64 NetPayloadBits = 0;
+	double NetPayloadStartTime = 0;
+};
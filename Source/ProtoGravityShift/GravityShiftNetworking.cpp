@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftNetworking.h"
+#include "GravityShiftMovementComponent.h"
+#include "ProtoGravityShiftCharacter.h"
+
+//////////////////////////////////////////////////////////////////////////
+// Encodings
+
+uint32 GravityShiftNet::EncodeUnitVector(const FVector& vector)
+{
+	const double length = FMath::Abs(vector.X) + FMath::Abs(vector.Y) + FMath::Abs(vector.Z);
+	const FVector normal = length > UE_SMALL_NUMBER ? vector / length : FVector::DownVector;
+
+	// Fold the lower hemisphere of the octahedron over the upper one
+	FVector2D octahedral(normal.X, normal.Y);
+	if (normal.Z < 0)
+	{
+		octahedral = FVector2D((1 - FMath::Abs(normal.Y)) * (normal.X >= 0 ? 1 : -1), (1 - FMath::Abs(normal.X)) * (normal.Y >= 0 ? 1 : -1));
+	}
+
+	const uint32 maxValue = (1u << UnitVectorAxisBits) - 1;
+	const uint32 u = (uint32)FMath::RoundToInt(((octahedral.X * 0.5) + 0.5) * maxValue);
+	const uint32 v = (uint32)FMath::RoundToInt(((octahedral.Y * 0.5) + 0.5) * maxValue);
+	return u | (v << UnitVectorAxisBits);
+}
+
+FVector GravityShiftNet::DecodeUnitVector(uint32 packed)
+{
+	const uint32 maxValue = (1u << UnitVectorAxisBits) - 1;
+	const double x = (((packed & maxValue) / (double)maxValue) * 2) - 1;
+	const double y = ((((packed >> UnitVectorAxisBits) & maxValue) / (double)maxValue) * 2) - 1;
+
+	FVector normal(x, y, 1 - FMath::Abs(x) - FMath::Abs(y));
+	const double fold = FMath::Max(-normal.Z, 0.0);
+	normal.X += normal.X >= 0 ? -fold : fold;
+	normal.Y += normal.Y >= 0 ? -fold : fold;
+	return normal.GetSafeNormal();
+}
+
+void GravityShiftNet::SerializeUnitVector(FArchive& Ar, FVector& vector)
+{
+	uint32 packed = Ar.IsSaving() ? EncodeUnitVector(vector) : 0;
+	Ar.SerializeInt(packed, 1u << (UnitVectorAxisBits * 2));
+	if (Ar.IsLoading())
+	{
+		vector = DecodeUnitVector(packed);
+	}
+}
+
+void GravityShiftNet::SerializeShiftState(FArchive& Ar, uint8& state)
+{
+	uint32 value = state;
+	Ar.SerializeInt(value, 1u << ShiftStateBits);
+	state = (uint8)value;
+}
+
+bool FGravityShiftNetState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	uint8 state = (uint8)ShiftState;
+	GravityShiftNet::SerializeShiftState(Ar, state);
+	ShiftState = (EShiftState)state;
+	GravityShiftNet::SerializeUnitVector(Ar, GravityDirection);
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Client moves
+
+void FGravityShiftNetworkMoveData::ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType)
+{
+	Super::ClientFillNetworkMoveData(ClientMove, MoveType);
+
+	const FSavedMove_GravityShift& shiftMove = static_cast<const FSavedMove_GravityShift&>(ClientMove);
+	ShiftState = shiftMove.ShiftState;
+	GravityDirection = shiftMove.GravityDirection;
+}
+
+bool FGravityShiftNetworkMoveData::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType)
+{
+	Super::Serialize(CharacterMovement, Ar, PackageMap, MoveType);
+
+	GravityShiftNet::SerializeShiftState(Ar, ShiftState);
+	GravityShiftNet::SerializeUnitVector(Ar, GravityDirection);
+
+	if (Ar.IsSaving())
+	{
+		static_cast<UGravityShiftMovementComponent&>(CharacterMovement).CountNetPayload(GravityShiftNet::PayloadBits);
+	}
+	return !Ar.IsError();
+}
+
+FGravityShiftNetworkMoveDataContainer::FGravityShiftNetworkMoveDataContainer()
+{
+	NewMoveData = &MoveData[0];
+	PendingMoveData = &MoveData[1];
+	OldMoveData = &MoveData[2];
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Server corrections
+
+void FGravityShiftMoveResponseDataContainer::ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment)
+{
+	Super::ServerFillResponseData(CharacterMovement, PendingAdjustment);
+
+	const UGravityShiftMovementComponent& shiftMovement = static_cast<const UGravityShiftMovementComponent&>(CharacterMovement);
+	const AProtoGravityShiftCharacter* character = Cast<AProtoGravityShiftCharacter>(shiftMovement.GetCharacterOwner());
+	ShiftState = character != nullptr ? (uint8)character->ShiftState : 0;
+	GravityDirection = shiftMovement.GetGravityDirection();
+	ShiftSpeed = shiftMovement.GetCurrentShiftSpeed();
+}
+
+bool FGravityShiftMoveResponseDataContainer::Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap)
+{
+	if (!Super::Serialize(CharacterMovement, Ar, PackageMap))
+	{
+		return false;
+	}
+
+	// Acknowledgements don't carry any shift data
+	if (IsCorrection())
+	{
+		GravityShiftNet::SerializeShiftState(Ar, ShiftState);
+		GravityShiftNet::SerializeUnitVector(Ar, GravityDirection);
+		Ar << ShiftSpeed;
+
+		if (Ar.IsSaving())
+		{
+			static_cast<UGravityShiftMovementComponent&>(CharacterMovement).CountNetPayload(GravityShiftNet::PayloadBits + 32);
+		}
+	}
+	return !Ar.IsError();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Saved moves
+
+void FSavedMove_GravityShift::Clear()
+{
+	Super::Clear();
+
+	ShiftState = 0;
+	GravityDirection = FVector::DownVector;
+	ShiftSpeed = 0;
+}
+
+void FSavedMove_GravityShift::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+
+	if (const AProtoGravityShiftCharacter* character = Cast<AProtoGravityShiftCharacter>(C))
+	{
+		ShiftState = (uint8)character->ShiftState;
+		GravityDirection = character->GetGravityMovement()->GetGravityDirection();
+		ShiftSpeed = character->GetGravityMovement()->GetCurrentShiftSpeed();
+	}
+}
+
+bool FSavedMove_GravityShift::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSavedMove_GravityShift* newShiftMove = static_cast<const FSavedMove_GravityShift*>(NewMove.Get());
+	if (ShiftState != newShiftMove->ShiftState || !GravityDirection.Equals(newShiftMove->GravityDirection))
+	{
+		return false;
+	}
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_GravityShift::PrepMoveFor(ACharacter* C)
+{
+	Super::PrepMoveFor(C);
+
+	if (UGravityShiftMovementComponent* shiftMovement = Cast<UGravityShiftMovementComponent>(C->GetCharacterMovement()))
+	{
+		shiftMovement->RestorePredictedShift(GravityDirection, ShiftSpeed);
+	}
+}
+
+FNetworkPredictionData_Client_GravityShift::FNetworkPredictionData_Client_GravityShift(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_GravityShift::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_GravityShift());
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/CharacterMovementReplication.h"
+
+/** Compact wire encodings for the gravity shift state */
+namespace GravityShiftNet
+{
+	/** Bits per octahedral axis, 11 bits keep unit vectors within ~0.1 degree */
+	constexpr int32 UnitVectorAxisBits = 11;
+	constexpr int32 ShiftStateBits = 2;
+	constexpr int32 PayloadBits = ShiftStateBits + (UnitVectorAxisBits * 2);
+
+	uint32 EncodeUnitVector(const FVector& vector);
+	FVector DecodeUnitVector(uint32 packed);
+
+	void SerializeUnitVector(FArchive& Ar, FVector& vector);
+	void SerializeShiftState(FArchive& Ar, uint8& state);
+}
+
+/** Shift data the client sends along with each move */
+struct FGravityShiftNetworkMoveData : public FCharacterNetworkMoveData
+{
+	typedef FCharacterNetworkMoveData Super;
+
+	uint8 ShiftState = 0;
+	FVector GravityDirection = FVector::DownVector;
+
+	virtual void ClientFillNetworkMoveData(const FSavedMove_Character& ClientMove, ENetworkMoveType MoveType) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override;
+};
+
+struct FGravityShiftNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
+{
+	FGravityShiftNetworkMoveDataContainer();
+
+	FGravityShiftNetworkMoveData MoveData[3];
+};
+
+/** Shift data the server sends back with corrections */
+struct FGravityShiftMoveResponseDataContainer : public FCharacterMoveResponseDataContainer
+{
+	typedef FCharacterMoveResponseDataContainer Super;
+
+	uint8 ShiftState = 0;
+	FVector GravityDirection = FVector::DownVector;
+	float ShiftSpeed = 0;
+
+	virtual void ServerFillResponseData(const UCharacterMovementComponent& CharacterMovement, const FClientAdjustment& PendingAdjustment) override;
+	virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap) override;
+};
+
+class FSavedMove_GravityShift : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	uint8 ShiftState = 0;
+	FVector GravityDirection = FVector::DownVector;
+	float ShiftSpeed = 0;
+
+	virtual void Clear() override;
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual void PrepMoveFor(ACharacter* C) override;
+};
+
+class FNetworkPredictionData_Client_GravityShift : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_GravityShift(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftRecorderComponent.h"
+#include "ProtoGravityShiftCharacter.h"
+#include "GameFramework/PlayerController.h"
+
+static FAutoConsoleCommandWithWorldAndArgs GravityShiftRecordCommand(
+	TEXT("GravityShift.Record"),
+	TEXT("Records the local player's gravity shift session to the given file, Saved/Recordings by default"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&UGravityShiftRecorderComponent::RecordCommand));
+
+static FAutoConsoleCommandWithWorld GravityShiftStopRecordingCommand(
+	TEXT("GravityShift.StopRecording"),
+	TEXT("Stops the recording started by GravityShift.Record"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&UGravityShiftRecorderComponent::StopRecordingCommand));
+
+static AProtoGravityShiftCharacter* GetLocalCharacter(UWorld* world)
+{
+	const APlayerController* playerController = world != nullptr ? world->GetFirstPlayerController() : nullptr;
+	return playerController != nullptr ? Cast<AProtoGravityShiftCharacter>(playerController->GetPawn()) : nullptr;
+}
+
+UGravityShiftRecorderComponent::UGravityShiftRecorderComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// Sample once the frame's movement is done
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+bool UGravityShiftRecorderComponent::StartRecording(const FString& path)
+{
+	StopRecording();
+
+	if (!Writer.Open(path, UWorld::RemovePIEPrefix(GetWorld()->GetOutermost()->GetName()), SampleRate))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not create gravity shift recording %s"), *path);
+		return false;
+	}
+
+	RecordingPath = path;
+	SampleTime = 0;
+	SetComponentTickEnabled(true);
+	UE_LOG(LogTemp, Log, TEXT("Recording %s to %s"), *GetNameSafe(GetOwner()), *path);
+	return true;
+}
+
+void UGravityShiftRecorderComponent::StopRecording()
+{
+	if (!Writer.IsOpen())
+	{
+		return;
+	}
+
+	const int32 frames = Writer.GetNumFrames();
+	Writer.Close();
+	SetComponentTickEnabled(false);
+	UE_LOG(LogTemp, Log, TEXT("Recorded %d frames (%.1f s) to %s, %lld bytes"), frames, (float)frames / SampleRate, *RecordingPath,
+		IFileManager::Get().FileSize(*RecordingPath));
+}
+
+void UGravityShiftRecorderComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopRecording();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UGravityShiftRecorderComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	AProtoGravityShiftCharacter* character = Cast<AProtoGravityShiftCharacter>(GetOwner());
+	if (character == nullptr || !Writer.IsOpen())
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	const float interval = 1.0f / SampleRate;
+	SampleTime += DeltaTime;
+	if (SampleTime < interval)
+	{
+		return;
+	}
+
+	FGravityShiftRecordFrame frame;
+	character->ConsumeRecordedInput(frame.Move, frame.Look, frame.Actions);
+	frame.ShiftState = (uint8)character->ShiftState;
+	frame.GravityDirection = character->GetGravityMovement()->GetGravityDirection();
+	frame.Location = character->GetActorLocation();
+	frame.Rotation = character->GetActorRotation();
+	frame.ControlRotation = character->GetControlRotation();
+
+	// A long frame covers several samples, only the first one gets the discrete input
+	while (SampleTime >= interval)
+	{
+		Writer.Append(frame);
+		frame.Look = FVector2D::ZeroVector;
+		frame.Actions = 0;
+		SampleTime -= interval;
+	}
+}
+
+void UGravityShiftRecorderComponent::RecordCommand(const TArray<FString>& args, UWorld* world)
+{
+	AProtoGravityShiftCharacter* character = GetLocalCharacter(world);
+	if (character == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("GravityShift.Record needs a local player controlling a ProtoGravityShiftCharacter"));
+		return;
+	}
+
+	UGravityShiftRecorderComponent* recorder = character->FindComponentByClass<UGravityShiftRecorderComponent>();
+	if (recorder == nullptr)
+	{
+		recorder = NewObject<UGravityShiftRecorderComponent>(character, TEXT("GravityShiftRecorder"));
+		recorder->RegisterComponent();
+	}
+	recorder->StartRecording(args.Num() > 0 ? args[0] : GravityShiftRecording::MakeDefaultPath());
+}
+
+void UGravityShiftRecorderComponent::StopRecordingCommand(UWorld* world)
+{
+	AProtoGravityShiftCharacter* character = GetLocalCharacter(world);
+	UGravityShiftRecorderComponent* recorder = character != nullptr ? character->FindComponentByClass<UGravityShiftRecorderComponent>() : nullptr;
+	if (recorder != nullptr)
+	{
+		recorder->StopRecording();
+	}
+}
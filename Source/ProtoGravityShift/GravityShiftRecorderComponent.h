@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GravityShiftRecording.h"
+#include "GravityShiftRecorderComponent.generated.h"
+
+/**
+ * Records its character's input and authoritative shift state at a fixed rate, for the
+ * benchmark commandlet to replay with -Mode=Replay. Added on demand by GravityShift.Record.
+ */
+UCLASS(ClassGroup = GravityShift, meta = (BlueprintSpawnableComponent))
+class PROTOGRAVITYSHIFT_API UGravityShiftRecorderComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGravityShiftRecorderComponent();
+
+	bool StartRecording(const FString& path);
+	void StopRecording();
+
+	FORCEINLINE bool IsRecording() const { return Writer.IsOpen(); }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** GravityShift.Record [path], records the first local player's character */
+	static void RecordCommand(const TArray<FString>& args, UWorld* world);
+
+	/** GravityShift.StopRecording */
+	static void StopRecordingCommand(UWorld* world);
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/** Frames recorded per second */
+	UPROPERTY(EditAnywhere, Category = GravityShift, meta = (ClampMin = "1", ClampMax = "240"))
+	int32 SampleRate = 30;
+
+	FGravityShiftRecordingWriter Writer;
+	FString RecordingPath;
+	float SampleTime = 0;
+};
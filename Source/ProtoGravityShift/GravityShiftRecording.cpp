@@ -0,0 +1,416 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftRecording.h"
+#include "GravityShiftNetworking.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+using namespace GravityShiftRecording;
+
+// Marks the footer where the next chunk's first frame would be
+static constexpr uint32 FooterMarker = MAX_uint32;
+
+namespace
+{
+	void WriteVarint(TArray<uint8>& out, uint32 value)
+	{
+		while (value >= 0x80)
+		{
+			out.Add((uint8)(value | 0x80));
+			value >>= 7;
+		}
+		out.Add((uint8)value);
+	}
+
+	bool ReadVarint(const uint8* data, int64& cursor, int64 end, uint32& outValue)
+	{
+		uint32 value = 0;
+		for (int32 shift = 0; shift < 35; shift += 7)
+		{
+			if (cursor >= end)
+			{
+				return false;
+			}
+			const uint8 byte = data[cursor++];
+			value |= (uint32)(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				outValue = value;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** Small deltas of either sign stay small once varint encoded */
+	uint32 ZigZag(int32 value)
+	{
+		return ((uint32)value << 1) ^ (uint32)(value >> 31);
+	}
+
+	int32 UnZigZag(uint32 value)
+	{
+		return (int32)(value >> 1) ^ -(int32)(value & 1);
+	}
+
+	template<typename T>
+	bool ReadRaw(const uint8* data, int64 size, int64& cursor, T& outValue)
+	{
+		if (cursor + (int64)sizeof(T) > size)
+		{
+			return false;
+		}
+		FMemory::Memcpy(&outValue, data + cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+
+	/** Rotations are compressed to 16 bits and wrap, so their deltas must too */
+	bool IsAngleField(int32 field)
+	{
+		return field >= Pitch && field <= ControlYaw;
+	}
+
+	int32 GetDelta(int32 field, int32 value, int32 previous)
+	{
+		const int32 delta = (int32)((uint32)value - (uint32)previous);
+		return IsAngleField(field) ? (int16)delta : delta;
+	}
+
+	int32 ApplyDelta(int32 field, int32 previous, int32 delta)
+	{
+		const int32 value = (int32)((uint32)previous + (uint32)delta);
+		return IsAngleField(field) ? (value & 0xFFFF) : value;
+	}
+}
+
+FQuantizedFrame GravityShiftRecording::Quantize(const FGravityShiftRecordFrame& frame)
+{
+	FQuantizedFrame quantized;
+	quantized.Fields[MoveX] = FMath::RoundToInt(FMath::Clamp(frame.Move.X, -1.0, 1.0) * 127);
+	quantized.Fields[MoveY] = FMath::RoundToInt(FMath::Clamp(frame.Move.Y, -1.0, 1.0) * 127);
+	quantized.Fields[LookX] = FMath::RoundToInt(frame.Look.X * 100);
+	quantized.Fields[LookY] = FMath::RoundToInt(frame.Look.Y * 100);
+	quantized.Fields[Actions] = frame.Actions;
+	quantized.Fields[ShiftState] = frame.ShiftState;
+	quantized.Fields[GravityDirection] = (int32)GravityShiftNet::EncodeUnitVector(frame.GravityDirection);
+
+	// Millimetres
+	quantized.Fields[LocationX] = FMath::RoundToInt(frame.Location.X * 10);
+	quantized.Fields[LocationY] = FMath::RoundToInt(frame.Location.Y * 10);
+	quantized.Fields[LocationZ] = FMath::RoundToInt(frame.Location.Z * 10);
+
+	quantized.Fields[Pitch] = FRotator::CompressAxisToShort(frame.Rotation.Pitch);
+	quantized.Fields[Yaw] = FRotator::CompressAxisToShort(frame.Rotation.Yaw);
+	quantized.Fields[Roll] = FRotator::CompressAxisToShort(frame.Rotation.Roll);
+	quantized.Fields[ControlPitch] = FRotator::CompressAxisToShort(frame.ControlRotation.Pitch);
+	quantized.Fields[ControlYaw] = FRotator::CompressAxisToShort(frame.ControlRotation.Yaw);
+	return quantized;
+}
+
+FGravityShiftRecordFrame GravityShiftRecording::Dequantize(const FQuantizedFrame& quantized)
+{
+	FGravityShiftRecordFrame frame;
+	frame.Move = FVector2D(quantized.Fields[MoveX], quantized.Fields[MoveY]) / 127.0;
+	frame.Look = FVector2D(quantized.Fields[LookX], quantized.Fields[LookY]) / 100.0;
+	frame.Actions = (uint8)quantized.Fields[Actions];
+	frame.ShiftState = (uint8)quantized.Fields[ShiftState];
+	frame.GravityDirection = GravityShiftNet::DecodeUnitVector((uint32)quantized.Fields[GravityDirection]);
+	frame.Location = FVector(quantized.Fields[LocationX], quantized.Fields[LocationY], quantized.Fields[LocationZ]) / 10.0;
+	frame.Rotation = FRotator(FRotator::DecompressAxisFromShort(quantized.Fields[Pitch]), FRotator::DecompressAxisFromShort(quantized.Fields[Yaw]),
+		FRotator::DecompressAxisFromShort(quantized.Fields[Roll]));
+	frame.ControlRotation = FRotator(FRotator::DecompressAxisFromShort(quantized.Fields[ControlPitch]), FRotator::DecompressAxisFromShort(quantized.Fields[ControlYaw]), 0);
+	return frame;
+}
+
+FString GravityShiftRecording::MakeDefaultPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Recordings") / FString::Printf(TEXT("GravityShift-%s.gsr"), *FDateTime::Now().ToString());
+}
+
+// Writer
+
+FGravityShiftRecordingWriter::~FGravityShiftRecordingWriter()
+{
+	Close();
+}
+
+bool FGravityShiftRecordingWriter::Open(const FString& path, const FString& mapName, int32 sampleRate)
+{
+	Close();
+	File.Reset(IFileManager::Get().CreateFileWriter(*path));
+	if (!File.IsValid())
+	{
+		return false;
+	}
+
+	uint32 magic = Magic;
+	uint16 version = Version;
+	uint16 rate = (uint16)sampleRate;
+	FTCHARToUTF8 mapNameUtf8(*mapName);
+	uint16 mapNameLength = (uint16)mapNameUtf8.Length();
+	*File << magic << version << rate << mapNameLength;
+	File->Serialize((void*)mapNameUtf8.Get(), mapNameLength);
+
+	Chunk.Reset();
+	ChunkFrames = 0;
+	NumChunks = 0;
+	NumFrames = 0;
+	return true;
+}
+
+void FGravityShiftRecordingWriter::Append(const FGravityShiftRecordFrame& frame)
+{
+	if (!File.IsValid())
+	{
+		return;
+	}
+
+	// Chunks start from zero so each one decodes without the previous
+	if (ChunkFrames == 0)
+	{
+		Previous = FQuantizedFrame();
+	}
+
+	const FQuantizedFrame quantized = Quantize(frame);
+	uint32 mask = 0;
+	int32 deltas[NumFields];
+	for (int32 field = 0; field < NumFields; field++)
+	{
+		deltas[field] = GetDelta(field, quantized.Fields[field], Previous.Fields[field]);
+		mask |= deltas[field] != 0 ? (1u << field) : 0;
+	}
+
+	WriteVarint(Chunk, mask);
+	for (int32 field = 0; field < NumFields; field++)
+	{
+		if (deltas[field] != 0)
+		{
+			WriteVarint(Chunk, ZigZag(deltas[field]));
+		}
+	}
+
+	Previous = quantized;
+	ChunkFrames++;
+	NumFrames++;
+	if (ChunkFrames == FramesPerChunk)
+	{
+		FlushChunk();
+	}
+}
+
+void FGravityShiftRecordingWriter::FlushChunk()
+{
+	if (ChunkFrames == 0)
+	{
+		return;
+	}
+
+	uint32 firstFrame = NumFrames - ChunkFrames;
+	uint32 chunkFrames = ChunkFrames;
+	uint32 byteCount = Chunk.Num();
+	*File << firstFrame << chunkFrames << byteCount;
+	File->Serialize(Chunk.GetData(), Chunk.Num());
+
+	// Whatever was flushed survives a crash
+	File->Flush();
+
+	Chunk.Reset();
+	ChunkFrames = 0;
+	NumChunks++;
+}
+
+void FGravityShiftRecordingWriter::Close()
+{
+	if (!File.IsValid())
+	{
+		return;
+	}
+
+	FlushChunk();
+
+	uint32 marker = FooterMarker;
+	uint32 numFrames = NumFrames;
+	uint32 numChunks = NumChunks;
+	uint32 magic = Magic;
+	*File << marker << numFrames << numChunks << magic;
+	File->Close();
+	File.Reset();
+}
+
+// Reader
+
+FGravityShiftRecordingReader::~FGravityShiftRecordingReader()
+{
+	// The region has to go before the file it maps
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FGravityShiftRecordingReader::Open(const FString& path)
+{
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	LoadedFile.Reset();
+	Data = nullptr;
+	Size = 0;
+
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*path));
+	if (MappedFile.IsValid())
+	{
+		MappedRegion.Reset(MappedFile->MapRegion());
+	}
+
+	if (MappedRegion.IsValid())
+	{
+		Data = MappedRegion->GetMappedPtr();
+		Size = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedFile, *path))
+	{
+		Data = LoadedFile.GetData();
+		Size = LoadedFile.Num();
+	}
+	else
+	{
+		return false;
+	}
+
+	int64 cursor = 0;
+	uint32 magic = 0;
+	uint16 version = 0;
+	uint16 rate = 0;
+	uint16 mapNameLength = 0;
+	if (!ReadRaw(Data, Size, cursor, magic) || magic != Magic
+		|| !ReadRaw(Data, Size, cursor, version) || version != Version
+		|| !ReadRaw(Data, Size, cursor, rate) || rate == 0
+		|| !ReadRaw(Data, Size, cursor, mapNameLength) || cursor + mapNameLength > Size)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s is not a gravity shift recording"), *path);
+		return false;
+	}
+
+	MapName = FString(FUTF8ToTCHAR((const ANSICHAR*)(Data + cursor), mapNameLength));
+	SampleRate = rate;
+	cursor += mapNameLength;
+
+	if (!ReadChunks(cursor))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s was cut short, reading its %d complete frames"), *path, NumFrames);
+	}
+
+	CurrentChunk = INDEX_NONE;
+	ChunkFramesLeft = 0;
+	return true;
+}
+
+bool FGravityShiftRecordingReader::ReadChunks(int64 offset)
+{
+	Chunks.Reset();
+	NumFrames = 0;
+
+	while (true)
+	{
+		uint32 firstFrame = 0;
+		if (!ReadRaw(Data, Size, offset, firstFrame))
+		{
+			return false;
+		}
+		if (firstFrame == FooterMarker)
+		{
+			return true;
+		}
+
+		uint32 chunkFrames = 0;
+		uint32 byteCount = 0;
+		if (!ReadRaw(Data, Size, offset, chunkFrames) || !ReadRaw(Data, Size, offset, byteCount) || offset + byteCount > Size)
+		{
+			return false;
+		}
+
+		FChunk& chunk = Chunks.AddDefaulted_GetRef();
+		chunk.FirstFrame = firstFrame;
+		chunk.NumFrames = chunkFrames;
+		chunk.DataOffset = offset;
+		chunk.DataSize = byteCount;
+		NumFrames += chunkFrames;
+		offset += byteCount;
+	}
+}
+
+bool FGravityShiftRecordingReader::StartChunk(int32 chunkIndex)
+{
+	if (!Chunks.IsValidIndex(chunkIndex))
+	{
+		return false;
+	}
+
+	const FChunk& chunk = Chunks[chunkIndex];
+	CurrentChunk = chunkIndex;
+	ChunkFramesLeft = chunk.NumFrames;
+	Cursor = chunk.DataOffset;
+	ChunkEnd = chunk.DataOffset + chunk.DataSize;
+	Previous = FQuantizedFrame();
+	return true;
+}
+
+bool FGravityShiftRecordingReader::Next(FGravityShiftRecordFrame& outFrame)
+{
+	while (ChunkFramesLeft == 0)
+	{
+		if (!StartChunk(CurrentChunk + 1))
+		{
+			return false;
+		}
+	}
+
+	uint32 mask = 0;
+	if (!ReadVarint(Data, Cursor, ChunkEnd, mask))
+	{
+		return false;
+	}
+	for (int32 field = 0; field < NumFields; field++)
+	{
+		if ((mask & (1u << field)) == 0)
+		{
+			continue;
+		}
+
+		uint32 delta = 0;
+		if (!ReadVarint(Data, Cursor, ChunkEnd, delta))
+		{
+			return false;
+		}
+		Previous.Fields[field] = ApplyDelta(field, Previous.Fields[field], UnZigZag(delta));
+	}
+
+	ChunkFramesLeft--;
+	outFrame = Dequantize(Previous);
+	return true;
+}
+
+bool FGravityShiftRecordingReader::Seek(int32 frame)
+{
+	for (int32 i = 0; i < Chunks.Num(); i++)
+	{
+		const FChunk& chunk = Chunks[i];
+		if (frame >= chunk.FirstFrame && frame < chunk.FirstFrame + chunk.NumFrames)
+		{
+			StartChunk(i);
+			FGravityShiftRecordFrame skipped;
+			for (int32 skip = chunk.FirstFrame; skip < frame; skip++)
+			{
+				if (!Next(skipped))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** One fixed rate sample of a recorded session: the player's input and the authoritative result */
+struct FGravityShiftRecordFrame
+{
+	FVector2D Move = FVector2D::ZeroVector;
+	FVector2D Look = FVector2D::ZeroVector;
+	uint8 Actions = 0;
+	uint8 ShiftState = 0;
+	FVector GravityDirection = FVector::DownVector;
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+	FRotator ControlRotation = FRotator::ZeroRotator;
+};
+
+/**
+ * Session file layout: a header, chunks of up to FramesPerChunk frames and a footer with the
+ * totals. Each chunk starts from a zero frame, so it can be decoded on its own, and every frame
+ * stores a mask of the quantized fields that changed followed by their zigzag varint deltas.
+ * A recording cut short has no footer and is still read up to its last complete chunk.
+ */
+namespace GravityShiftRecording
+{
+	constexpr uint32 Magic = 0x31525347; // GSR1
+	constexpr uint16 Version = 1;
+	constexpr int32 FramesPerChunk = 256;
+
+	constexpr uint8 ActionShift = 1 << 0;
+	constexpr uint8 ActionCancel = 1 << 1;
+
+	/** Fields of a frame once quantized, in the order of the change mask bits */
+	enum EField
+	{
+		MoveX,
+		MoveY,
+		LookX,
+		LookY,
+		Actions,
+		ShiftState,
+		GravityDirection,
+		LocationX,
+		LocationY,
+		LocationZ,
+		Pitch,
+		Yaw,
+		Roll,
+		ControlPitch,
+		ControlYaw,
+		NumFields
+	};
+
+	struct FQuantizedFrame
+	{
+		int32 Fields[NumFields] = {};
+	};
+
+	FQuantizedFrame Quantize(const FGravityShiftRecordFrame& frame);
+	FGravityShiftRecordFrame Dequantize(const FQuantizedFrame& frame);
+
+	FString MakeDefaultPath();
+}
+
+/** Streams frames to a session file, a chunk at a time */
+class PROTOGRAVITYSHIFT_API FGravityShiftRecordingWriter
+{
+public:
+	~FGravityShiftRecordingWriter();
+
+	bool Open(const FString& path, const FString& mapName, int32 sampleRate);
+	void Append(const FGravityShiftRecordFrame& frame);
+	void Close();
+
+	FORCEINLINE bool IsOpen() const { return File.IsValid(); }
+	FORCEINLINE int32 GetNumFrames() const { return NumFrames; }
+
+private:
+	void FlushChunk();
+
+	TUniquePtr<FArchive> File;
+	TArray<uint8> Chunk;
+	GravityShiftRecording::FQuantizedFrame Previous;
+	int32 ChunkFrames = 0;
+	int32 NumChunks = 0;
+	int32 NumFrames = 0;
+};
+
+/** Decodes a session file in place through a memory mapping, or from a loaded copy where mapping is unsupported */
+class PROTOGRAVITYSHIFT_API FGravityShiftRecordingReader
+{
+public:
+	~FGravityShiftRecordingReader();
+
+	bool Open(const FString& path);
+
+	/** Next frame in order, false at the end */
+	bool Next(FGravityShiftRecordFrame& outFrame);
+
+	/** Makes frame the next one returned, decoding forward from the start of its chunk */
+	bool Seek(int32 frame);
+
+	FORCEINLINE const FString& GetMapName() const { return MapName; }
+	FORCEINLINE int32 GetSampleRate() const { return SampleRate; }
+	FORCEINLINE int32 GetNumFrames() const { return NumFrames; }
+
+private:
+	struct FChunk
+	{
+		int32 FirstFrame;
+		int32 NumFrames;
+		int64 DataOffset;
+		int64 DataSize;
+	};
+
+	bool ReadChunks(int64 offset);
+	bool StartChunk(int32 chunkIndex);
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> LoadedFile;
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+
+	FString MapName;
+	int32 SampleRate = 0;
+	int32 NumFrames = 0;
+	TArray<FChunk> Chunks;
+
+	int32 CurrentChunk = INDEX_NONE;
+	int32 ChunkFramesLeft = 0;
+	int64 Cursor = 0;
+	int64 ChunkEnd = 0;
+	GravityShiftRecording::FQuantizedFrame Previous;
+};
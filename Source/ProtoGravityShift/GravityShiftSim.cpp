@@ -0,0 +1,293 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftSim.h"
+#include <algorithm>
+#include <cmath>
+
+namespace GravityShiftSim
+{
+	// Contacts stop this far in front of the surface, like the movement component's sweeps
+	static constexpr double SimContactOffset = 0.1;
+	static constexpr double SimFloorNormalZ = 0.7;
+	static constexpr double SimSmallNumber = 1e-8;
+
+	EState GetNextState(EState state, EEvent event)
+	{
+		switch (event)
+		{
+		case EEvent::ShiftPressed:
+			// A shift pressed mid-flight is up to the caller to buffer
+			if (state == EState::Levitating || state == EState::Accelerating)
+			{
+				return EState::Accelerating;
+			}
+			return EState::Levitating;
+		case EEvent::CancelPressed:
+			return EState::NoShift;
+		case EEvent::SurfaceHit:
+			return (state == EState::Accelerating || state == EState::WallGrounded) ? EState::WallGrounded : state;
+		case EEvent::SurfaceLost:
+			return state == EState::WallGrounded ? EState::Accelerating : state;
+		}
+		return state;
+	}
+
+	double AdvanceShiftSpeed(double speed, double deltaTime, double acceleration, double maxSpeed)
+	{
+		return std::min(speed + (deltaTime * acceleration), maxSpeed);
+	}
+
+	double GetShiftTime(double distance, double startSpeed, double acceleration, double maxSpeed)
+	{
+		if (acceleration <= 0 || startSpeed >= maxSpeed)
+		{
+			const double speed = std::min(startSpeed, maxSpeed);
+			return speed > 0 ? distance / speed : 0;
+		}
+
+		const double accelerationDistance = ((maxSpeed * maxSpeed) - (startSpeed * startSpeed)) / (2 * acceleration);
+		if (distance <= accelerationDistance)
+		{
+			return (std::sqrt((startSpeed * startSpeed) + (2 * acceleration * distance)) - startSpeed) / acceleration;
+		}
+		return ((maxSpeed - startSpeed) / acceleration) + ((distance - accelerationDistance) / maxSpeed);
+	}
+
+	double GetShiftDistance(double time, double startSpeed, double acceleration, double maxSpeed)
+	{
+		if (acceleration <= 0 || startSpeed >= maxSpeed)
+		{
+			return std::min(startSpeed, maxSpeed) * time;
+		}
+
+		const double accelerationTime = std::min((maxSpeed - startSpeed) / acceleration, time);
+		return (startSpeed * accelerationTime) + (0.5 * acceleration * accelerationTime * accelerationTime) + (maxSpeed * (time - accelerationTime));
+	}
+
+	double FSimVector::Size() const
+	{
+		return std::sqrt(Dot(*this));
+	}
+
+	FSimVector FSimVector::GetSafeNormal() const
+	{
+		const double size = Size();
+		return size > SimSmallNumber ? *this * (1 / size) : FSimVector();
+	}
+
+	void FSimBoxLevel::AddBox(const FSimVector& min, const FSimVector& max)
+	{
+		Boxes.push_back({ min, max });
+	}
+
+	void FSimBoxLevel::AddRoom(const FSimVector& min, const FSimVector& max, double thickness)
+	{
+		AddBox(FSimVector(min.X, min.Y, min.Z - thickness), FSimVector(max.X, max.Y, min.Z));
+		AddBox(FSimVector(min.X, min.Y, max.Z), FSimVector(max.X, max.Y, max.Z + thickness));
+		AddBox(FSimVector(min.X - thickness, min.Y, min.Z), FSimVector(min.X, max.Y, max.Z));
+		AddBox(FSimVector(max.X, min.Y, min.Z), FSimVector(max.X + thickness, max.Y, max.Z));
+		AddBox(FSimVector(min.X, min.Y - thickness, min.Z), FSimVector(max.X, min.Y, max.Z));
+		AddBox(FSimVector(min.X, max.Y, min.Z), FSimVector(max.X, max.Y + thickness, max.Z));
+	}
+
+	bool FSimBoxLevel::Overlaps(const FSimVector& location, double radius) const
+	{
+		for (const FBox& box : Boxes)
+		{
+			double distanceSquared = 0;
+			for (int32_t axis = 0; axis < 3; axis++)
+			{
+				const double outside = std::max({ box.Min[axis] - location[axis], 0.0, location[axis] - box.Max[axis] });
+				distanceSquared += outside * outside;
+			}
+			if (distanceSquared < radius * radius)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool FSimBoxLevel::Sweep(const FSimVector& start, const FSimVector& end, double radius, FSimHit& outHit) const
+	{
+		const FSimVector delta = end - start;
+		const double length = delta.Size();
+		if (length <= SimSmallNumber)
+		{
+			return false;
+		}
+
+		bool bHit = false;
+		outHit.Time = 1;
+		for (const FBox& box : Boxes)
+		{
+			// Slab test of the segment against the box grown by radius
+			double entry = -1;
+			double exit = 2;
+			int32_t entryAxis = -1;
+			bool bMissed = false;
+			for (int32_t axis = 0; axis < 3 && !bMissed; axis++)
+			{
+				const double min = box.Min[axis] - radius;
+				const double max = box.Max[axis] + radius;
+				if (std::abs(delta[axis]) <= SimSmallNumber)
+				{
+					bMissed = start[axis] <= min || start[axis] >= max;
+					continue;
+				}
+
+				double nearTime = (min - start[axis]) / delta[axis];
+				double farTime = (max - start[axis]) / delta[axis];
+				if (nearTime > farTime)
+				{
+					std::swap(nearTime, farTime);
+				}
+				if (nearTime > entry)
+				{
+					entry = nearTime;
+					entryAxis = axis;
+				}
+				exit = std::min(exit, farTime);
+				bMissed = entry > exit;
+			}
+
+			// Starting inside a box doesn't block, so a shifter resting on a face can leave it
+			if (bMissed || entryAxis < 0 || entry < 0 || entry >= outHit.Time)
+			{
+				continue;
+			}
+
+			bHit = true;
+			outHit.Time = entry;
+			outHit.Normal = FSimVector();
+			outHit.Normal[entryAxis] = delta[entryAxis] > 0 ? -1 : 1;
+		}
+
+		if (bHit)
+		{
+			const double time = std::max(outHit.Time - (SimContactOffset / length), 0.0);
+			outHit.Location = start + (delta * time);
+		}
+		return bHit;
+	}
+
+	FSimShifter::FSimShifter(const FSimParams& params, const ISimCollision& collision)
+		: Params(params)
+		, Collision(collision)
+	{
+	}
+
+	void FSimShifter::Reset(const FSimVector& location)
+	{
+		State = EState::NoShift;
+		Location = location;
+		Velocity = FSimVector();
+		GravityDirection = FSimVector(0, 0, -1);
+		ShiftSpeed = 0;
+		ImpactSpeed = 0;
+		TransitionRemaining = 0;
+		bGrounded = true;
+	}
+
+	void FSimShifter::HandleEvent(EEvent event, const FSimVector& direction)
+	{
+		const EState nextState = GetNextState(State, event);
+		if (nextState == State && event != EEvent::SurfaceHit)
+		{
+			return;
+		}
+
+		switch (nextState)
+		{
+		case EState::NoShift:
+			// GoBackToGround
+			GravityDirection = FSimVector(0, 0, -1);
+			Velocity = FSimVector();
+			bGrounded = false;
+			TransitionRemaining = Params.BackToGroundTransitionDuration;
+			break;
+		case EState::Levitating:
+			Velocity = FSimVector();
+			break;
+		case EState::Accelerating:
+			GravityDirection = event == EEvent::SurfaceLost ? GravityDirection : direction.GetSafeNormal();
+			ShiftSpeed = Params.ShiftStartSpeed;
+			break;
+		case EState::WallGrounded:
+			GravityDirection = -direction.GetSafeNormal();
+			ImpactSpeed = ShiftSpeed;
+			ShiftSpeed = Params.ShiftStartSpeed;
+			Velocity = FSimVector();
+			TransitionRemaining = std::max(Params.WallCapsuleTransitionDuration, Params.WallMeshTransitionDuration);
+			break;
+		}
+		State = nextState;
+	}
+
+	void FSimShifter::Step(double deltaTime)
+	{
+		TransitionRemaining = std::max(TransitionRemaining - deltaTime, 0.0);
+
+		if (State == EState::Accelerating)
+		{
+			StepShift(deltaTime);
+		}
+		else if (State == EState::NoShift && !bGrounded)
+		{
+			StepFall(deltaTime);
+		}
+	}
+
+	bool FSimShifter::IsSettled() const
+	{
+		const bool bStanding = State == EState::WallGrounded || (State == EState::NoShift && bGrounded);
+		return bStanding && TransitionRemaining <= 0;
+	}
+
+	void FSimShifter::StepShift(double deltaTime)
+	{
+		ShiftSpeed = AdvanceShiftSpeed(ShiftSpeed, deltaTime, Params.ShiftAcceleration, Params.MaxShiftSpeed);
+
+		const FSimVector end = Location + (GravityDirection * (ShiftSpeed * deltaTime));
+		FSimHit hit;
+		if (!Collision.Sweep(Location, end, Params.CapsuleRadius, hit))
+		{
+			Location = end;
+			return;
+		}
+
+		Location = hit.Location;
+		HandleEvent(EEvent::SurfaceHit, hit.Normal);
+	}
+
+	void FSimShifter::StepFall(double deltaTime)
+	{
+		Velocity = Velocity + (GravityDirection * (Params.Gravity * deltaTime));
+
+		FSimVector start = Location;
+		double remainingTime = deltaTime;
+		// One slide along whatever the fall runs into, then stop for this step
+		for (int32_t iteration = 0; iteration < 2 && remainingTime > 0; iteration++)
+		{
+			const FSimVector end = start + (Velocity * remainingTime);
+			FSimHit hit;
+			if (!Collision.Sweep(start, end, Params.CapsuleRadius, hit))
+			{
+				start = end;
+				break;
+			}
+
+			start = hit.Location;
+			remainingTime *= 1 - hit.Time;
+			if (hit.Normal.Z >= SimFloorNormalZ)
+			{
+				bGrounded = true;
+				Velocity = FSimVector();
+				break;
+			}
+			Velocity = Velocity - (hit.Normal * Velocity.Dot(hit.Normal));
+		}
+		Location = start;
+	}
+}
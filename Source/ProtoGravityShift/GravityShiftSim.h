@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Plain C++ on purpose: the module uses it in game, and GravityShiftSimMain.cpp builds it without the engine
+#include <cstdint>
+#include <vector>
+
+/**
+ * Engine independent core of the gravity shift: the shift state machine, the shift fall
+ * integrator and a fixed step simulation of one shifter against an abstract collision query.
+ * AProtoGravityShiftCharacter and UGravityShiftMovementComponent run the same transitions and speed
+ * integration, so parameters tuned here behave the same in game.
+ */
+namespace GravityShiftSim
+{
+	/** Same values as EShiftState */
+	enum class EState : uint8_t
+	{
+		NoShift,
+		Levitating,
+		Accelerating,
+		WallGrounded,
+	};
+
+	enum class EEvent : uint8_t
+	{
+		ShiftPressed,
+		CancelPressed,
+		SurfaceHit,
+		SurfaceLost,
+	};
+
+	/** State a shifter moves to on event, state itself when the event doesn't apply to it */
+	EState GetNextState(EState state, EEvent event);
+
+	/** Shift fall speed after deltaTime more of acceleration, capped at maxSpeed */
+	double AdvanceShiftSpeed(double speed, double deltaTime, double acceleration, double maxSpeed);
+
+	/** Seconds a shift starting at startSpeed takes to cover distance, the closed form of AdvanceShiftSpeed */
+	double GetShiftTime(double distance, double startSpeed, double acceleration, double maxSpeed);
+
+	/** Distance a shift starting at startSpeed covers in time, the inverse of GetShiftTime */
+	double GetShiftDistance(double time, double startSpeed, double acceleration, double maxSpeed);
+
+	struct FSimVector
+	{
+		double X = 0;
+		double Y = 0;
+		double Z = 0;
+
+		FSimVector() = default;
+		FSimVector(double x, double y, double z) : X(x), Y(y), Z(z) {}
+
+		FSimVector operator+(const FSimVector& other) const { return FSimVector(X + other.X, Y + other.Y, Z + other.Z); }
+		FSimVector operator-(const FSimVector& other) const { return FSimVector(X - other.X, Y - other.Y, Z - other.Z); }
+		FSimVector operator*(double scale) const { return FSimVector(X * scale, Y * scale, Z * scale); }
+		FSimVector operator-() const { return FSimVector(-X, -Y, -Z); }
+
+		double operator[](int32_t axis) const { return axis == 0 ? X : (axis == 1 ? Y : Z); }
+		double& operator[](int32_t axis) { return axis == 0 ? X : (axis == 1 ? Y : Z); }
+
+		double Dot(const FSimVector& other) const { return (X * other.X) + (Y * other.Y) + (Z * other.Z); }
+		double Size() const;
+		/** Zero when too short to have a direction */
+		FSimVector GetSafeNormal() const;
+	};
+
+	struct FSimHit
+	{
+		/** Centre of the swept sphere where it touches */
+		FSimVector Location;
+		FSimVector Normal;
+		/** Fraction of the sweep travelled before the contact */
+		double Time = 1;
+	};
+
+	/** The scene queries the simulation makes, a sphere of the capsule's radius stands in for the capsule */
+	class ISimCollision
+	{
+	public:
+		virtual ~ISimCollision() = default;
+
+		virtual bool Sweep(const FSimVector& start, const FSimVector& end, double radius, FSimHit& outHit) const = 0;
+	};
+
+	/** Analytic level of axis aligned boxes, enough for rooms, pillars and platforms */
+	class FSimBoxLevel : public ISimCollision
+	{
+	public:
+		void AddBox(const FSimVector& min, const FSimVector& max);
+
+		/** Floor, ceiling and four walls, thickness thick, around the inside of min and max */
+		void AddRoom(const FSimVector& min, const FSimVector& max, double thickness);
+
+		/** True when a sphere of radius at location overlaps any box */
+		bool Overlaps(const FSimVector& location, double radius) const;
+
+		/** Corners expand by radius like the faces do, close enough for shifts into walls and floors */
+		virtual bool Sweep(const FSimVector& start, const FSimVector& end, double radius, FSimHit& outHit) const override;
+
+	private:
+		struct FBox
+		{
+			FSimVector Min;
+			FSimVector Max;
+		};
+		std::vector<FBox> Boxes;
+	};
+
+	/** The character's tuning, with its defaults */
+	struct FSimParams
+	{
+		double ShiftStartSpeed = 980;
+		double ShiftAcceleration = 20;
+		double MaxShiftSpeed = 10000;
+		double WallCapsuleTransitionDuration = 0.2;
+		double WallMeshTransitionDuration = 0.2;
+		double BackToGroundTransitionDuration = 0.2;
+		double CapsuleRadius = 42;
+		/** World gravity pulling the character down outside a shift */
+		double Gravity = 980;
+	};
+
+	/**
+	 * One shifter stepped at a fixed time step. Levitating holds it in place, a shift falls along the
+	 * aim with AdvanceShiftSpeed until it hits a surface, which it then stands on. Going back to ground
+	 * falls under world gravity until it stands on a floor. Deterministic for the same inputs.
+	 */
+	class FSimShifter
+	{
+	public:
+		FSimShifter(const FSimParams& params, const ISimCollision& collision);
+
+		/** Standing on the ground at location */
+		void Reset(const FSimVector& location);
+
+		/** Applies event through GetNextState. A shift falls along direction, a surface hit stands on the surface of normal direction */
+		void HandleEvent(EEvent event, const FSimVector& direction = FSimVector());
+
+		void Step(double deltaTime);
+
+		EState GetState() const { return State; }
+		const FSimVector& GetLocation() const { return Location; }
+		const FSimVector& GetGravityDirection() const { return GravityDirection; }
+		double GetShiftSpeed() const { return ShiftSpeed; }
+
+		/** Shift speed when the last surface was hit */
+		double GetImpactSpeed() const { return ImpactSpeed; }
+
+		/** On a surface or the ground, with the orientation blend of the last transition finished */
+		bool IsSettled() const;
+
+	private:
+		void StepShift(double deltaTime);
+		void StepFall(double deltaTime);
+
+		FSimParams Params;
+		const ISimCollision& Collision;
+
+		EState State = EState::NoShift;
+		FSimVector Location;
+		FSimVector Velocity;
+		FSimVector GravityDirection = FSimVector(0, 0, -1);
+		double ShiftSpeed = 0;
+		double ImpactSpeed = 0;
+		double TransitionRemaining = 0;
+		bool bGrounded = true;
+	};
+}
@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftSimBatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace GravityShiftSim
+{
+	static constexpr double SimRoomHalfSize = 4000;
+	static constexpr double SimRoomHeight = 3000;
+	static constexpr double SimWallThickness = 100;
+	// Capsule half height of the character standing on the floor
+	static constexpr double SimStartHeight = 96;
+	static constexpr double SimStartMargin = 500;
+	static constexpr double SimMinAimPitch = -20;
+	static constexpr double SimMaxAimPitch = 45;
+	static constexpr double SimDegreesToRadians = 0.017453292519943295;
+	static constexpr int32_t SimMaxStartAttempts = 64;
+
+	/** xorshift32, so scenarios come out the same on every compiler and platform */
+	struct FSimRandom
+	{
+		uint32_t State;
+
+		explicit FSimRandom(uint32_t seed) : State(seed != 0 ? seed : 1) {}
+
+		double GetFraction()
+		{
+			State ^= State << 13;
+			State ^= State >> 17;
+			State ^= State << 5;
+			return State / 4294967296.0;
+		}
+
+		double GetInRange(double min, double max)
+		{
+			return min + ((max - min) * GetFraction());
+		}
+	};
+
+	struct FSimScenarioResult
+	{
+		bool bLanded = false;
+		double TimeToLand = 0;
+		double TimeToControl = 0;
+		double TimeToGround = 0;
+		double ImpactSpeed = 0;
+	};
+
+	double FSimRange::GetValue(int32_t step) const
+	{
+		if (Steps <= 1)
+		{
+			return Min;
+		}
+		return Min + ((Max - Min) * step / (Steps - 1));
+	}
+
+	int32_t FSimSweep::GetNumCombinations() const
+	{
+		return std::max(ShiftStartSpeed.Steps, 1) * std::max(ShiftAcceleration.Steps, 1) * std::max(MaxShiftSpeed.Steps, 1)
+			* std::max(WallTransitionDuration.Steps, 1) * std::max(BackToGroundTransitionDuration.Steps, 1);
+	}
+
+	FSimParams FSimSweep::GetCombination(int32_t index, const FSimParams& base) const
+	{
+		FSimParams params = base;
+		const FSimRange* ranges[] = { &ShiftStartSpeed, &ShiftAcceleration, &MaxShiftSpeed, &WallTransitionDuration, &BackToGroundTransitionDuration };
+		double values[5];
+		for (int32_t i = 0; i < 5; i++)
+		{
+			const int32_t steps = std::max(ranges[i]->Steps, 1);
+			values[i] = ranges[i]->GetValue(index % steps);
+			index /= steps;
+		}
+
+		params.ShiftStartSpeed = values[0];
+		params.ShiftAcceleration = values[1];
+		params.MaxShiftSpeed = values[2];
+		params.WallCapsuleTransitionDuration = values[3];
+		params.WallMeshTransitionDuration = values[3];
+		params.BackToGroundTransitionDuration = values[4];
+		return params;
+	}
+
+	void MakeTestLevel(FSimBoxLevel& outLevel)
+	{
+		outLevel.AddRoom(FSimVector(-SimRoomHalfSize, -SimRoomHalfSize, 0), FSimVector(SimRoomHalfSize, SimRoomHalfSize, SimRoomHeight), SimWallThickness);
+		outLevel.AddBox(FSimVector(-1500, -1500, 0), FSimVector(-1000, -1000, SimRoomHeight));
+		outLevel.AddBox(FSimVector(1000, 1000, 0), FSimVector(1500, 1500, SimRoomHeight));
+		outLevel.AddBox(FSimVector(1000, -1500, 0), FSimVector(1500, -1000, 1500));
+		outLevel.AddBox(FSimVector(-500, -500, 1400), FSimVector(500, 500, 1500));
+	}
+
+	std::vector<FSimScenario> MakeTestScenarios(const FSimBoxLevel& level, int32_t count, uint32_t seed, double capsuleRadius)
+	{
+		FSimRandom random(seed);
+		std::vector<FSimScenario> scenarios;
+		scenarios.reserve(std::max(count, 0));
+
+		const double startExtent = SimRoomHalfSize - SimStartMargin;
+		for (int32_t i = 0; i < count; i++)
+		{
+			FSimScenario scenario;
+			for (int32_t attempt = 0; attempt < SimMaxStartAttempts; attempt++)
+			{
+				scenario.Start = FSimVector(random.GetInRange(-startExtent, startExtent), random.GetInRange(-startExtent, startExtent), SimStartHeight);
+				if (!level.Overlaps(scenario.Start, capsuleRadius))
+				{
+					break;
+				}
+			}
+
+			const double yaw = random.GetInRange(0, 360) * SimDegreesToRadians;
+			const double pitch = random.GetInRange(SimMinAimPitch, SimMaxAimPitch) * SimDegreesToRadians;
+			scenario.Aim = FSimVector(std::cos(pitch) * std::cos(yaw), std::cos(pitch) * std::sin(yaw), std::sin(pitch));
+			scenarios.push_back(scenario);
+		}
+		return scenarios;
+	}
+
+	static FSimScenarioResult RunScenario(const FSimParams& params, const ISimCollision& collision, const FSimScenario& scenario,
+		double deltaTime, int32_t maxSteps)
+	{
+		FSimScenarioResult result;
+		FSimShifter shifter(params, collision);
+		shifter.Reset(scenario.Start);
+
+		shifter.HandleEvent(EEvent::ShiftPressed);
+		const int32_t levitateSteps = (int32_t)std::ceil(scenario.LevitateTime / deltaTime);
+		for (int32_t i = 0; i < levitateSteps; i++)
+		{
+			shifter.Step(deltaTime);
+		}
+
+		shifter.HandleEvent(EEvent::ShiftPressed, scenario.Aim);
+		int32_t steps = 0;
+		while (shifter.GetState() == EState::Accelerating && steps < maxSteps)
+		{
+			shifter.Step(deltaTime);
+			steps++;
+		}
+		if (shifter.GetState() != EState::WallGrounded)
+		{
+			return result;
+		}
+
+		result.bLanded = true;
+		result.TimeToLand = steps * deltaTime;
+		result.ImpactSpeed = shifter.GetImpactSpeed();
+		while (!shifter.IsSettled() && steps < maxSteps)
+		{
+			shifter.Step(deltaTime);
+			steps++;
+		}
+		result.TimeToControl = steps * deltaTime;
+
+		shifter.HandleEvent(EEvent::CancelPressed);
+		steps = 0;
+		while (!shifter.IsSettled() && steps < maxSteps)
+		{
+			shifter.Step(deltaTime);
+			steps++;
+		}
+		result.TimeToGround = steps * deltaTime;
+		return result;
+	}
+
+	FSimCombinationResult RunCombination(const FSimParams& params, const ISimCollision& collision,
+		const std::vector<FSimScenario>& scenarios, double deltaTime, double timeout)
+	{
+		FSimCombinationResult result;
+		result.Params = params;
+		result.Scenarios = (int32_t)scenarios.size();
+
+		const int32_t maxSteps = (int32_t)std::ceil(timeout / deltaTime);
+		int32_t reachedMaxSpeed = 0;
+		for (const FSimScenario& scenario : scenarios)
+		{
+			const FSimScenarioResult scenarioResult = RunScenario(params, collision, scenario, deltaTime, maxSteps);
+			if (!scenarioResult.bLanded)
+			{
+				continue;
+			}
+
+			result.Landed++;
+			result.MeanTimeToLand += scenarioResult.TimeToLand;
+			result.MaxTimeToLand = std::max(result.MaxTimeToLand, scenarioResult.TimeToLand);
+			result.MeanTimeToControl += scenarioResult.TimeToControl;
+			result.MeanTimeToGround += scenarioResult.TimeToGround;
+			result.MeanImpactSpeed += scenarioResult.ImpactSpeed;
+			result.MaxImpactSpeed = std::max(result.MaxImpactSpeed, scenarioResult.ImpactSpeed);
+			reachedMaxSpeed += scenarioResult.ImpactSpeed >= params.MaxShiftSpeed ? 1 : 0;
+		}
+
+		if (result.Landed > 0)
+		{
+			const double scale = 1.0 / result.Landed;
+			result.MeanTimeToLand *= scale;
+			result.MeanTimeToControl *= scale;
+			result.MeanTimeToGround *= scale;
+			result.MeanImpactSpeed *= scale;
+			result.MaxSpeedFraction = reachedMaxSpeed * scale;
+		}
+		return result;
+	}
+
+	const char* GetCsvHeader()
+	{
+		return "shiftStartSpeed,shiftAcceleration,maxShiftSpeed,wallTransitionDuration,backToGroundTransitionDuration,"
+			"scenarios,landed,meanTimeToLand,maxTimeToLand,meanTimeToControl,meanTimeToGround,meanImpactSpeed,maxImpactSpeed,maxSpeedFraction";
+	}
+
+	std::string FormatCsvRow(const FSimCombinationResult& result)
+	{
+		char row[512];
+		std::snprintf(row, sizeof(row), "%.1f,%.1f,%.1f,%.3f,%.3f,%d,%d,%.4f,%.4f,%.4f,%.4f,%.1f,%.1f,%.3f",
+			result.Params.ShiftStartSpeed, result.Params.ShiftAcceleration, result.Params.MaxShiftSpeed,
+			result.Params.WallCapsuleTransitionDuration, result.Params.BackToGroundTransitionDuration,
+			result.Scenarios, result.Landed, result.MeanTimeToLand, result.MaxTimeToLand, result.MeanTimeToControl,
+			result.MeanTimeToGround, result.MeanImpactSpeed, result.MaxImpactSpeed, result.MaxSpeedFraction);
+		return row;
+	}
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GravityShiftSim.h"
+#include <string>
+
+/**
+ * Parameter sweeps of the gravity shift over an analytic test level. Every combination runs the
+ * same scenarios, so combinations can be split over any number of threads and still give the
+ * same results. Runs from -Mode=Tuning of the benchmark commandlet, or standalone with
+ * GravityShiftSimMain.cpp.
+ */
+namespace GravityShiftSim
+{
+	struct FSimRange
+	{
+		double Min = 0;
+		double Max = 0;
+		int32_t Steps = 1;
+
+		double GetValue(int32_t step) const;
+	};
+
+	/** Each range is walked in Steps values from Min to Max, every combination of them is run */
+	struct FSimSweep
+	{
+		FSimRange ShiftStartSpeed = { 500, 2000, 4 };
+		FSimRange ShiftAcceleration = { 0, 3000, 4 };
+		FSimRange MaxShiftSpeed = { 3000, 10000, 4 };
+		FSimRange WallTransitionDuration = { 0.1, 0.4, 4 };
+		FSimRange BackToGroundTransitionDuration = { 0.1, 0.4, 4 };
+
+		int32_t GetNumCombinations() const;
+
+		/** base with the swept values of combination index */
+		FSimParams GetCombination(int32_t index, const FSimParams& base) const;
+	};
+
+	/** Stands at Start, levitates for LevitateTime, shifts along Aim, settles, then goes back to ground */
+	struct FSimScenario
+	{
+		FSimVector Start;
+		FSimVector Aim;
+		double LevitateTime = 0.5;
+	};
+
+	struct FSimCombinationResult
+	{
+		FSimParams Params;
+		int32_t Scenarios = 0;
+		/** Scenarios whose shift hit a surface within the time limit */
+		int32_t Landed = 0;
+		/** Mean seconds from the shift to the surface hit, over landed scenarios */
+		double MeanTimeToLand = 0;
+		double MaxTimeToLand = 0;
+		/** Mean seconds from the shift until standing on the surface with the transition done */
+		double MeanTimeToControl = 0;
+		/** Mean seconds from going back to ground until standing on the floor with the transition done */
+		double MeanTimeToGround = 0;
+		double MeanImpactSpeed = 0;
+		double MaxImpactSpeed = 0;
+		/** Fraction of landed shifts that reached MaxShiftSpeed */
+		double MaxSpeedFraction = 0;
+	};
+
+	/** A walled room with pillars, a low block and a floating platform to shift onto */
+	void MakeTestLevel(FSimBoxLevel& outLevel);
+
+	/** count scenarios from seed, starting on the floor of level away from its boxes */
+	std::vector<FSimScenario> MakeTestScenarios(const FSimBoxLevel& level, int32_t count, uint32_t seed, double capsuleRadius);
+
+	/** Runs every scenario with params, stepping deltaTime, each phase gives up after timeout seconds */
+	FSimCombinationResult RunCombination(const FSimParams& params, const ISimCollision& collision,
+		const std::vector<FSimScenario>& scenarios, double deltaTime, double timeout);
+
+	const char* GetCsvHeader();
+	std::string FormatCsvRow(const FSimCombinationResult& result);
+}
@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+// Standalone tuning sweep, compiled out of the game module. Build it without the engine with:
+// g++ -std=c++17 -O2 -pthread -DGRAVITY_SHIFT_SIM_STANDALONE=1 GravityShiftSim.cpp GravityShiftSimBatch.cpp GravityShiftSimMain.cpp -o GravityShiftTuning
+#if defined(GRAVITY_SHIFT_SIM_STANDALONE) && GRAVITY_SHIFT_SIM_STANDALONE
+
+#include "GravityShiftSimBatch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace GravityShiftSim;
+
+static void PrintUsage()
+{
+	std::fprintf(stderr,
+		"Usage: GravityShiftTuning [-Scenarios=64] [-Seed=1] [-StepRate=120] [-Timeout=10] [-Threads=N] [-Output=GravityShiftTuning.csv]\n"
+		"  [-StartSpeed=min:max:steps] [-Acceleration=min:max:steps] [-MaxSpeed=min:max:steps]\n"
+		"  [-WallTransition=min:max:steps] [-BackToGroundTransition=min:max:steps]\n");
+}
+
+// Both return whether arg is -Name=..., and set bOutInvalid when its value doesn't parse
+static bool ParseArgument(const char* arg, const char* name, double& outValue, bool& bOutInvalid)
+{
+	const size_t length = std::strlen(name);
+	if (std::strncmp(arg, name, length) != 0 || arg[length] != '=')
+	{
+		return false;
+	}
+
+	const char* text = arg + length + 1;
+	char* end = nullptr;
+	const double value = std::strtod(text, &end);
+	if (end == text || *end != '\0')
+	{
+		bOutInvalid = true;
+		return true;
+	}
+	outValue = value;
+	return true;
+}
+
+static bool ParseRange(const char* arg, const char* name, FSimRange& outRange, bool& bOutInvalid)
+{
+	// -Name=min:max:steps
+	const size_t length = std::strlen(name);
+	if (std::strncmp(arg, name, length) != 0 || arg[length] != '=')
+	{
+		return false;
+	}
+
+	const char* text = arg + length + 1;
+	FSimRange range;
+	int consumed = 0;
+	if (std::sscanf(text, "%lf:%lf:%d%n", &range.Min, &range.Max, &range.Steps, &consumed) != 3 || text[consumed] != '\0')
+	{
+		bOutInvalid = true;
+		return true;
+	}
+	range.Steps = std::max(range.Steps, 1);
+	outRange = range;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	FSimSweep sweep;
+	double scenarioCount = 64;
+	double seed = 1;
+	double stepRate = 120;
+	double timeout = 10;
+	double threadCount = std::thread::hardware_concurrency();
+	const char* outputPath = "GravityShiftTuning.csv";
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		bool bInvalid = false;
+		const bool bParsed = ParseArgument(arg, "-Scenarios", scenarioCount, bInvalid) || ParseArgument(arg, "-Seed", seed, bInvalid)
+			|| ParseArgument(arg, "-StepRate", stepRate, bInvalid) || ParseArgument(arg, "-Timeout", timeout, bInvalid)
+			|| ParseArgument(arg, "-Threads", threadCount, bInvalid)
+			|| ParseRange(arg, "-StartSpeed", sweep.ShiftStartSpeed, bInvalid) || ParseRange(arg, "-Acceleration", sweep.ShiftAcceleration, bInvalid)
+			|| ParseRange(arg, "-MaxSpeed", sweep.MaxShiftSpeed, bInvalid) || ParseRange(arg, "-WallTransition", sweep.WallTransitionDuration, bInvalid)
+			|| ParseRange(arg, "-BackToGroundTransition", sweep.BackToGroundTransitionDuration, bInvalid);
+		if (!bParsed && std::strncmp(arg, "-Output=", 8) == 0)
+		{
+			outputPath = arg + 8;
+		}
+		else if (!bParsed || bInvalid)
+		{
+			std::fprintf(stderr, "%s argument %s\n", bInvalid ? "Bad value in" : "Unknown", arg);
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	// Also rules out NaN
+	if (!(scenarioCount >= 1) || !(stepRate > 0) || !(timeout > 0))
+	{
+		std::fprintf(stderr, "-Scenarios must be at least 1, -StepRate and -Timeout above 0\n");
+		PrintUsage();
+		return 1;
+	}
+
+	const FSimParams base;
+	FSimBoxLevel level;
+	MakeTestLevel(level);
+	const std::vector<FSimScenario> scenarios = MakeTestScenarios(level, (int32_t)scenarioCount, (uint32_t)seed, base.CapsuleRadius);
+
+	const int32_t combinations = sweep.GetNumCombinations();
+	const double deltaTime = 1 / stepRate;
+	std::vector<FSimCombinationResult> results(combinations);
+	std::atomic<int32_t> nextCombination(0);
+
+	const auto startTime = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int32_t t = 0; t < std::max((int32_t)threadCount, 1); t++)
+	{
+		threads.emplace_back([&]()
+		{
+			for (int32_t i = nextCombination++; i < combinations; i = nextCombination++)
+			{
+				results[i] = RunCombination(sweep.GetCombination(i, base), level, scenarios, deltaTime, timeout);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	FILE* file = std::fopen(outputPath, "w");
+	if (!file)
+	{
+		std::fprintf(stderr, "Could not write %s\n", outputPath);
+		return 1;
+	}
+	std::fprintf(file, "%s\n", GetCsvHeader());
+	for (const FSimCombinationResult& result : results)
+	{
+		std::fprintf(file, "%s\n", FormatCsvRow(result).c_str());
+	}
+	std::fclose(file);
+
+	std::printf("%d combinations x %d scenarios on %d threads in %.2f s, written to %s\n",
+		combinations, (int32_t)scenarios.size(), (int32_t)threads.size(), seconds, outputPath);
+	return 0;
+}
+
+#endif
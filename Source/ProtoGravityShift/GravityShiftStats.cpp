@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftStats.h"
+#include "GameFramework/Actor.h"
+#include "ProfilingDebugging/MiscTrace.h"
+
+DEFINE_STAT(STAT_GravityShift_PhysShiftFall);
+DEFINE_STAT(STAT_GravityShift_PhysWallWalk);
+DEFINE_STAT(STAT_GravityShift_AdjustToWall);
+DEFINE_STAT(STAT_GravityShift_OrientMeshToWall);
+DEFINE_STAT(STAT_GravityShift_FindGravityFloor);
+DEFINE_STAT(STAT_GravityShift_FindIndexedGravityFloor);
+DEFINE_STAT(STAT_GravityShift_CalculateGravityDirection);
+DEFINE_STAT(STAT_GravityShift_UpdateAimProbe);
+DEFINE_STAT(STAT_GravityShift_UpdateLandingPrediction);
+DEFINE_STAT(STAT_GravityShift_OrientationBlend);
+DEFINE_STAT(STAT_GravityShift_EvaluateGravityFields);
+DEFINE_STAT(STAT_GravityShift_UpdateStasis);
+DEFINE_STAT(STAT_GravityShift_RunScheduledQueries);
+DEFINE_STAT(STAT_GravityShift_UpdateMarkers);
+
+DEFINE_STAT(STAT_GravityShift_Traces);
+DEFINE_STAT(STAT_GravityShift_SurfaceIndexQueries);
+DEFINE_STAT(STAT_GravityShift_BlendsStarted);
+DEFINE_STAT(STAT_GravityShift_Transitions);
+DEFINE_STAT(STAT_GravityShift_FieldQueries);
+DEFINE_STAT(STAT_GravityShift_ShiftSubsteps);
+DEFINE_STAT(STAT_GravityShift_StasisBodies);
+DEFINE_STAT(STAT_GravityShift_ScheduledQueries);
+DEFINE_STAT(STAT_GravityShift_DeferredQueries);
+DEFINE_STAT(STAT_GravityShift_MarkersPlaced);
+DEFINE_STAT(STAT_GravityShift_MarkerTransformUpdates);
+DEFINE_STAT(STAT_GravityShift_MarkerPoolGrowths);
+DEFINE_STAT(STAT_GravityShift_InputLatency);
+DEFINE_STAT(STAT_GravityShift_InputLatencyFrames);
+
+CSV_DEFINE_CATEGORY_MODULE(PROTOGRAVITYSHIFT_API, GravityShift, true);
+
+UE_TRACE_CHANNEL_DEFINE(GravityShiftChannel);
+
+UE_TRACE_EVENT_BEGIN(GravityShift, ShiftEvent)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ActorId)
+	UE_TRACE_EVENT_FIELD(uint8, Event)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, ActorName)
+UE_TRACE_EVENT_END()
+
+const TCHAR* GravityShiftStats::GetEventName(EGravityShiftEvent event)
+{
+	switch (event)
+	{
+	case EGravityShiftEvent::EnterLevitate:
+		return TEXT("EnterLevitate");
+	case EGravityShiftEvent::EnterAcceleration:
+		return TEXT("EnterAcceleration");
+	case EGravityShiftEvent::WallContact:
+		return TEXT("WallContact");
+	case EGravityShiftEvent::WallContactLost:
+		return TEXT("WallContactLost");
+	case EGravityShiftEvent::BackToGround:
+		return TEXT("BackToGround");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+void GravityShiftStats::RecordShiftEvent(const AActor* actor, EGravityShiftEvent event)
+{
+	INC_DWORD_STAT(STAT_GravityShift_Transitions);
+	CSV_CUSTOM_STAT(GravityShift, StateTransitions, 1, ECsvCustomStatOp::Accumulate);
+	CSV_EVENT(GravityShift, TEXT("%s %s"), *GetNameSafe(actor), GetEventName(event));
+
+	if (UE_TRACE_CHANNELEXPR_IS_ENABLED(GravityShiftChannel))
+	{
+		const FString actorName = GetNameSafe(actor);
+		UE_TRACE_LOG(GravityShift, ShiftEvent, GravityShiftChannel)
+			<< ShiftEvent.Cycle(FPlatformTime::Cycles64())
+			<< ShiftEvent.ActorId(actor != nullptr ? actor->GetUniqueID() : 0)
+			<< ShiftEvent.Event((uint8)event)
+			<< ShiftEvent.ActorName(*actorName, actorName.Len());
+
+		// Bookmarks show up on the Timing Insights timeline next to the frame they happened in
+		TRACE_BOOKMARK(TEXT("%s %s"), *actorName, GetEventName(event));
+	}
+}
+
+void GravityShiftStats::RecordInputLatency(double seconds, uint64 frames)
+{
+	const float milliseconds = (float)(seconds * 1000.0);
+	SET_FLOAT_STAT(STAT_GravityShift_InputLatency, milliseconds);
+	SET_DWORD_STAT(STAT_GravityShift_InputLatencyFrames, (uint32)frames);
+	CSV_CUSTOM_STAT(GravityShift, InputLatencyMs, milliseconds, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(GravityShift, InputLatencyFrames, (int32)frames, ECsvCustomStatOp::Set);
+}
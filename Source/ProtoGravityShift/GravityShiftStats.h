@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Trace/Trace.h"
+#include "GravityShiftTiming.h"
+
+DECLARE_STATS_GROUP(TEXT("GravityShift"), STATGROUP_GravityShift, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PhysShiftFall"), STAT_GravityShift_PhysShiftFall, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PhysWallWalk"), STAT_GravityShift_PhysWallWalk, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AdjustToWall"), STAT_GravityShift_AdjustToWall, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OrientMeshToWall"), STAT_GravityShift_OrientMeshToWall, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindGravityFloor"), STAT_GravityShift_FindGravityFloor, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindIndexedGravityFloor"), STAT_GravityShift_FindIndexedGravityFloor, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("CalculateGravityDirection"), STAT_GravityShift_CalculateGravityDirection, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateAimProbe"), STAT_GravityShift_UpdateAimProbe, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateLandingPrediction"), STAT_GravityShift_UpdateLandingPrediction, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OrientationBlend"), STAT_GravityShift_OrientationBlend, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("EvaluateGravityFields"), STAT_GravityShift_EvaluateGravityFields, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateStasis"), STAT_GravityShift_UpdateStasis, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RunScheduledQueries"), STAT_GravityShift_RunScheduledQueries, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateMarkers"), STAT_GravityShift_UpdateMarkers, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Traces Issued"), STAT_GravityShift_Traces, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Surface Index Queries"), STAT_GravityShift_SurfaceIndexQueries, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Orientation Blends Started"), STAT_GravityShift_BlendsStarted, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("State Transitions"), STAT_GravityShift_Transitions, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Gravity Field Queries"), STAT_GravityShift_FieldQueries, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shift Substeps"), STAT_GravityShift_ShiftSubsteps, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Stasis Bodies"), STAT_GravityShift_StasisBodies, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Scheduled Queries"), STAT_GravityShift_ScheduledQueries, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Deferred Queries"), STAT_GravityShift_DeferredQueries, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Markers Placed"), STAT_GravityShift_MarkersPlaced, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Marker Transform Updates"), STAT_GravityShift_MarkerTransformUpdates, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Marker Pool Growths"), STAT_GravityShift_MarkerPoolGrowths, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Shift Input Latency (ms)"), STAT_GravityShift_InputLatency, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Shift Input Latency (frames)"), STAT_GravityShift_InputLatencyFrames, STATGROUP_GravityShift, PROTOGRAVITYSHIFT_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(PROTOGRAVITYSHIFT_API, GravityShift);
+
+/** Enable with -trace=default,GravityShift */
+UE_TRACE_CHANNEL_EXTERN(GravityShiftChannel, PROTOGRAVITYSHIFT_API);
+
+enum class EGravityShiftEvent : uint8
+{
+	EnterLevitate,
+	EnterAcceleration,
+	WallContact,
+	WallContactLost,
+	BackToGround,
+};
+
+namespace GravityShiftStats
+{
+	const TCHAR* GetEventName(EGravityShiftEvent event);
+
+	/** Counts the transition and records it in CSV captures and the GravityShift trace channel */
+	void RecordShiftEvent(const AActor* actor, EGravityShiftEvent event);
+
+	/** Time and frames from a shift or cancel press to the first move that applied it, kept until the next one */
+	void RecordInputLatency(double seconds, uint64 frames);
+}
+
+/** Cycle stat, CSV timing and Insights scope around a gravity function */
+#define GRAVITY_SHIFT_STAT_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_GravityShift_##Name); \
+	CSV_SCOPED_TIMING_STAT(GravityShift, Name)
+
+/** Same as GRAVITY_SHIFT_STAT_SCOPE, also recorded by the benchmark commandlet */
+#define GRAVITY_SHIFT_SCOPE(Name) \
+	GRAVITY_SHIFT_STAT_SCOPE(Name); \
+	GRAVITY_SHIFT_TIMED_SCOPE(Name)
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityShiftTiming.h"
+
+namespace GravityShiftTiming
+{
+	static bool bIsRecording = false;
+	static uint64 ScopeCycles[(int32)EScope::Num] = {};
+	static uint32 ScopeCalls[(int32)EScope::Num] = {};
+
+	const TCHAR* GetScopeName(EScope scope)
+	{
+		switch (scope)
+		{
+		case EScope::PhysShiftFall:
+			return TEXT("PhysShiftFall");
+		case EScope::PhysWallWalk:
+			return TEXT("PhysWallWalk");
+		case EScope::AdjustToWall:
+			return TEXT("AdjustToWall");
+		case EScope::OrientMeshToWall:
+			return TEXT("OrientMeshToWall");
+		default:
+			return TEXT("Unknown");
+		}
+	}
+
+	void SetRecording(bool bRecording)
+	{
+		bIsRecording = bRecording;
+	}
+
+	bool IsRecording()
+	{
+		return bIsRecording;
+	}
+
+	void Reset()
+	{
+		FMemory::Memzero(ScopeCycles);
+		FMemory::Memzero(ScopeCalls);
+	}
+
+	double GetSeconds(EScope scope)
+	{
+		return FPlatformTime::ToSeconds64(ScopeCycles[(int32)scope]);
+	}
+
+	uint32 GetCalls(EScope scope)
+	{
+		return ScopeCalls[(int32)scope];
+	}
+
+	FScope::FScope(EScope inScope)
+		: Scope(inScope)
+		, StartCycles(bIsRecording ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	FScope::~FScope()
+	{
+		// Only the game thread records, the scopes are never entered from workers
+		if (bIsRecording && StartCycles != 0 && IsInGameThread())
+		{
+			ScopeCycles[(int32)Scope] += FPlatformTime::Cycles64() - StartCycles;
+			ScopeCalls[(int32)Scope]++;
+		}
+	}
+}
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Game thread time accumulated in the gravity shift hot paths while a benchmark is recording */
+namespace GravityShiftTiming
+{
+	enum class EScope : uint8
+	{
+		PhysShiftFall,
+		PhysWallWalk,
+		AdjustToWall,
+		OrientMeshToWall,
+		Num,
+	};
+
+	const TCHAR* GetScopeName(EScope scope);
+
+	void SetRecording(bool bRecording);
+	bool IsRecording();
+	void Reset();
+
+	double GetSeconds(EScope scope);
+	uint32 GetCalls(EScope scope);
+
+	struct FScope
+	{
+		explicit FScope(EScope inScope);
+		~FScope();
+
+		EScope Scope;
+		uint64 StartCycles;
+	};
+}
+
+#define GRAVITY_SHIFT_TIMED_SCOPE(Name) GravityShiftTiming::FScope PREPROCESSOR_JOIN(gravityShiftTimedScope, __LINE__)(GravityShiftTiming::EScope::Name)
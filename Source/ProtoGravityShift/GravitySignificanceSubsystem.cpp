@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravitySignificanceSubsystem.h"
+#include "ProtoGravityShiftCharacter.h"
+#include "GameFramework/PlayerController.h"
+
+static const FName GravityShifterTag(TEXT("GravityShifter"));
+
+void UGravitySignificanceSubsystem::RegisterShifter(AProtoGravityShiftCharacter* character)
+{
+	if (USignificanceManager* significanceManager = USignificanceManager::Get(GetWorld()))
+	{
+		significanceManager->RegisterObject(character, GravityShifterTag, &UGravitySignificanceSubsystem::CalculateSignificance,
+			USignificanceManager::EPostSignificanceType::Sequential, &UGravitySignificanceSubsystem::PostSignificance);
+	}
+}
+
+void UGravitySignificanceSubsystem::UnregisterShifter(AProtoGravityShiftCharacter* character)
+{
+	if (USignificanceManager* significanceManager = USignificanceManager::Get(GetWorld()))
+	{
+		significanceManager->UnregisterObject(character);
+	}
+}
+
+void UGravitySignificanceSubsystem::Tick(float DeltaTime)
+{
+	USignificanceManager* significanceManager = USignificanceManager::Get(GetWorld());
+	if (significanceManager == nullptr)
+	{
+		return;
+	}
+
+	Viewpoints.Reset();
+	for (FConstPlayerControllerIterator it = GetWorld()->GetPlayerControllerIterator(); it; ++it)
+	{
+		if (const APlayerController* playerController = it->Get())
+		{
+			FVector location;
+			FRotator rotation;
+			playerController->GetPlayerViewPoint(location, rotation);
+			Viewpoints.Emplace(rotation, location);
+		}
+	}
+
+	// Without viewers, e.g. in the benchmark, everybody keeps running at full rate
+	if (Viewpoints.Num() > 0)
+	{
+		significanceManager->Update(Viewpoints);
+	}
+}
+
+TStatId UGravitySignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGravitySignificanceSubsystem, STATGROUP_Tickables);
+}
+
+bool UGravitySignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+float UGravitySignificanceSubsystem::CalculateSignificance(USignificanceManager::FManagedObjectInfo* objectInfo, const FTransform& viewpoint)
+{
+	const AProtoGravityShiftCharacter* character = Cast<AProtoGravityShiftCharacter>(objectInfo->GetObject());
+	if (character == nullptr || character->IsPlayerControlled())
+	{
+		return 1;
+	}
+
+	const float distance = FVector::Dist(viewpoint.GetLocation(), character->GetActorLocation());
+	float significance = 1 - FMath::Clamp(distance / character->GetSignificanceDistance(), 0.0f, 1.0f);
+
+	// Nobody sees it, it only has to stay plausible
+	if (!character->WasRecentlyRendered(0.25f))
+	{
+		significance *= 0.5f;
+	}
+
+	// Idle characters have nothing to probe, shifting ones are what players watch
+	if (character->ShiftState == EShiftState::E_NoShift)
+	{
+		significance *= 0.5f;
+	}
+	return significance;
+}
+
+void UGravitySignificanceSubsystem::PostSignificance(USignificanceManager::FManagedObjectInfo* objectInfo, float oldSignificance, float significance, bool bFinal)
+{
+	if (AProtoGravityShiftCharacter* character = Cast<AProtoGravityShiftCharacter>(objectInfo->GetObject()))
+	{
+		character->ApplySignificance(bFinal ? 1.0f : significance);
+	}
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SignificanceManager.h"
+#include "GravitySignificanceSubsystem.generated.h"
+
+class AProtoGravityShiftCharacter;
+
+/**
+ * Feeds the player viewpoints to the significance manager and scales each shifter's gravity
+ * tick and wall probe rates by how much it matters to them: distance, whether it was rendered
+ * and whether it is a player or currently shifting.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravitySignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterShifter(AProtoGravityShiftCharacter* character);
+	void UnregisterShifter(AProtoGravityShiftCharacter* character);
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	static float CalculateSignificance(USignificanceManager::FManagedObjectInfo* objectInfo, const FTransform& viewpoint);
+	static void PostSignificance(USignificanceManager::FManagedObjectInfo* objectInfo, float oldSignificance, float significance, bool bFinal);
+
+	TArray<FTransform> Viewpoints;
+};
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityStasisComponent.h"
+#include "GravityStasisSubsystem.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+
+UGravityStasisComponent::UGravityStasisComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+void UGravityStasisComponent::Capture()
+{
+	// The overlap runs with the frame's other async queries, its result is picked up next tick
+	FCollisionQueryParams params(SCENE_QUERY_STAT(GravityStasisCapture), false, GetOwner());
+	CaptureHandle = GetWorld()->AsyncOverlapByObjectType(GetOwner()->GetActorLocation(), FQuat::Identity,
+		FCollisionObjectQueryParams(FCollisionObjectQueryParams::AllDynamicObjects), FCollisionShape::MakeSphere(Radius), params);
+	SetComponentTickEnabled(true);
+}
+
+void UGravityStasisComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	FOverlapDatum overlaps;
+	if (!CaptureHandle.IsValid() || !GetWorld()->QueryOverlapData(CaptureHandle, overlaps))
+	{
+		SetComponentTickEnabled(CaptureHandle.IsValid());
+		return;
+	}
+	CaptureHandle.Invalidate();
+	SetComponentTickEnabled(false);
+
+	const FVector center = GetOwner()->GetActorLocation();
+	TArray<UPrimitiveComponent*> bodies;
+	bodies.Reserve(overlaps.OutOverlaps.Num());
+	for (const FOverlapResult& overlap : overlaps.OutOverlaps)
+	{
+		UPrimitiveComponent* body = overlap.GetComponent();
+		if (body != nullptr && body->IsSimulatingPhysics())
+		{
+			bodies.AddUnique(body);
+		}
+	}
+
+	if (bodies.Num() > MaxBodies)
+	{
+		bodies.Sort([&center](const UPrimitiveComponent& a, const UPrimitiveComponent& b)
+		{
+			return FVector::DistSquared(a.GetComponentLocation(), center) < FVector::DistSquared(b.GetComponentLocation(), center);
+		});
+		bodies.SetNum(MaxBodies);
+	}
+
+	if (UGravityStasisSubsystem* stasis = GetWorld()->GetSubsystem<UGravityStasisSubsystem>())
+	{
+		stasis->HoldBodies(this, bodies);
+	}
+}
+
+void UGravityStasisComponent::Launch(FVector direction)
+{
+	CaptureHandle.Invalidate();
+	if (UGravityStasisSubsystem* stasis = GetWorld()->GetSubsystem<UGravityStasisSubsystem>())
+	{
+		stasis->LaunchBodies(this, direction.GetSafeNormal());
+	}
+}
+
+void UGravityStasisComponent::Release()
+{
+	CaptureHandle.Invalidate();
+	if (UGravityStasisSubsystem* stasis = GetWorld()->GetSubsystem<UGravityStasisSubsystem>())
+	{
+		stasis->ReleaseBodies(this);
+	}
+}
+
+int32 UGravityStasisComponent::GetNumHeldBodies() const
+{
+	const UGravityStasisSubsystem* stasis = GetWorld()->GetSubsystem<UGravityStasisSubsystem>();
+	return stasis != nullptr ? stasis->GetNumHeldBodies(this) : 0;
+}
+
+void UGravityStasisComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Release();
+
+	Super::EndPlay(EndPlayReason);
+}
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "GravityStasisComponent.generated.h"
+
+/**
+ * Stasis field ability: captures the simulating bodies around its owner, holds them floating
+ * above it and launches them along a gravity direction. The bodies themselves are driven by
+ * UGravityStasisSubsystem on the physics thread.
+ */
+UCLASS(ClassGroup = (GravityShift), meta = (BlueprintSpawnableComponent))
+class PROTOGRAVITYSHIFT_API UGravityStasisComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGravityStasisComponent();
+
+	/** Gathers the bodies in Radius, they are held from the next frame on */
+	UFUNCTION(BlueprintCallable, Category = GravityShift)
+	void Capture();
+
+	/** Flings every held body along direction */
+	UFUNCTION(BlueprintCallable, Category = GravityShift)
+	void Launch(FVector direction);
+
+	/** Drops every held body where it is */
+	UFUNCTION(BlueprintCallable, Category = GravityShift)
+	void Release();
+
+	UFUNCTION(BlueprintPure, Category = GravityShift)
+	int32 GetNumHeldBodies() const;
+
+	FORCEINLINE FVector GetHoldCenter() const { return GetOwner()->GetActorLocation() + (GetOwner()->GetActorUpVector() * HoldHeight); }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float Radius = 1500;
+
+	/** Nearest bodies kept when more are in range */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	int32 MaxBodies = 256;
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float HoldHeight = 250;
+
+	/** Fraction of their offset from the hold center the bodies keep, lower packs them tighter */
+	UPROPERTY(EditAnywhere, Category = GravityShift, meta = (ClampMin = "0", ClampMax = "1"))
+	float HoldSpread = 0.5f;
+
+	/** Speed in 1/s at which a held body closes on its hold point */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float HoldStiffness = 4;
+
+	/** Rate in 1/s at which a held body's velocity settles on the one towards its hold point */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float HoldDamping = 8;
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float LaunchSpeed = 2000;
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float LaunchAcceleration = 2000;
+
+	/** Seconds a launched body keeps accelerating before its own gravity takes over again */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float LaunchDuration = 2;
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	FTraceHandle CaptureHandle;
+};
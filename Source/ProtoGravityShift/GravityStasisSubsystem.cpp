@@ -0,0 +1,270 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityStasisSubsystem.h"
+#include "GravityStasisComponent.h"
+#include "GravityShiftStats.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "PBDRigidsSolver.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+
+enum class EGravityStasisMode : uint8
+{
+	Hold,
+	Launch,
+	Release,
+};
+
+struct FGravityStasisCommand
+{
+	Chaos::FSingleParticlePhysicsProxy* Proxy = nullptr;
+	EGravityStasisMode Mode = EGravityStasisMode::Hold;
+
+	/** Hold point or launch direction */
+	FVector Target = FVector::ZeroVector;
+
+	// Hold stiffness and damping, or launch speed and acceleration
+	float ParamA = 0;
+	float ParamB = 0;
+
+	/** What a released body gets back */
+	bool bGravityEnabled = true;
+};
+
+struct FGravityStasisInput : public Chaos::FSimCallbackInput
+{
+	TArray<FGravityStasisCommand> Commands;
+
+	void Reset()
+	{
+		Commands.Reset();
+	}
+};
+
+/** Applies a frame's commands to every stasis body at once, before the solver integrates them */
+class FGravityStasisCallback : public Chaos::TSimCallbackObject<FGravityStasisInput, Chaos::FSimCallbackNoOutput, Chaos::ESimCallbackOptions::Presimulate>
+{
+	virtual void OnPreSimulate_Internal() override
+	{
+		const FGravityStasisInput* input = GetConsumerInput_Internal();
+		if (input == nullptr)
+		{
+			return;
+		}
+
+		const float deltaTime = GetDeltaTime_Internal();
+		for (const FGravityStasisCommand& command : input->Commands)
+		{
+			Chaos::FRigidBodyHandle_Internal* body = command.Proxy->GetPhysicsThreadAPI();
+			if (body == nullptr)
+			{
+				continue;
+			}
+
+			if (command.Mode == EGravityStasisMode::Release)
+			{
+				body->SetGravityEnabled(command.bGravityEnabled);
+				continue;
+			}
+
+			body->SetGravityEnabled(false);
+			if (body->ObjectState() == Chaos::EObjectStateType::Sleeping)
+			{
+				body->SetObjectState(Chaos::EObjectStateType::Dynamic);
+			}
+
+			if (command.Mode == EGravityStasisMode::Hold)
+			{
+				// Close on the hold point at a rate, easing the velocity in so bodies float rather than snap
+				const FVector desired = (command.Target - FVector(body->X())) * command.ParamA;
+				const float blend = FMath::Min(1.0f, deltaTime * command.ParamB);
+				body->SetV(FMath::Lerp(FVector(body->V()), desired, blend));
+				body->SetW(body->W() * (1.0f - blend));
+			}
+			else
+			{
+				// At least the launch speed along the direction, then keep accelerating
+				const FVector velocity = body->V();
+				const float alongSpeed = FVector::DotProduct(velocity, command.Target);
+				const float boost = FMath::Max(command.ParamA - alongSpeed, 0.0f) + (command.ParamB * deltaTime);
+				body->SetV(velocity + (command.Target * boost));
+			}
+		}
+	}
+};
+
+void UGravityStasisSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (FPhysScene* scene = InWorld.GetPhysicsScene())
+	{
+		Callback = scene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FGravityStasisCallback>();
+	}
+}
+
+void UGravityStasisSubsystem::Deinitialize()
+{
+	FPhysScene* scene = GetWorld()->GetPhysicsScene();
+	if (Callback != nullptr && scene != nullptr)
+	{
+		scene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(Callback);
+	}
+	Callback = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UGravityStasisSubsystem::HoldBodies(UGravityStasisComponent* field, TConstArrayView<UPrimitiveComponent*> bodies)
+{
+	const FTransform fieldTransform(field->GetOwner()->GetActorQuat(), field->GetHoldCenter());
+	for (UPrimitiveComponent* component : bodies)
+	{
+		int32* index = BodyIndices.Find(component);
+		if (index == nullptr)
+		{
+			FStasisBody& body = Bodies.AddDefaulted_GetRef();
+			body.Component = component;
+			body.Key = component;
+			body.bGravityEnabled = component->IsGravityEnabled();
+			index = &BodyIndices.Add(component, Bodies.Num() - 1);
+		}
+
+		FStasisBody& body = Bodies[*index];
+		body.Field = field;
+		body.HoldOffset = fieldTransform.InverseTransformVectorNoScale(component->GetComponentLocation() - fieldTransform.GetLocation()) * field->HoldSpread;
+		body.LaunchTimeLeft = 0;
+	}
+}
+
+void UGravityStasisSubsystem::LaunchBodies(const UGravityStasisComponent* field, const FVector& direction)
+{
+	for (FStasisBody& body : Bodies)
+	{
+		if (body.Field == field && body.LaunchTimeLeft <= 0)
+		{
+			body.LaunchDirection = direction;
+			body.LaunchSpeed = field->LaunchSpeed;
+			body.LaunchAcceleration = field->LaunchAcceleration;
+			body.LaunchTimeLeft = field->LaunchDuration;
+		}
+	}
+}
+
+void UGravityStasisSubsystem::ReleaseBodies(const UGravityStasisComponent* field)
+{
+	for (int32 i = Bodies.Num() - 1; i >= 0; i--)
+	{
+		// Launched bodies are on their own already
+		if (Bodies[i].Field == field && Bodies[i].LaunchTimeLeft <= 0)
+		{
+			RemoveBodyAt(i);
+		}
+	}
+}
+
+int32 UGravityStasisSubsystem::GetNumHeldBodies(const UGravityStasisComponent* field) const
+{
+	int32 count = 0;
+	for (const FStasisBody& body : Bodies)
+	{
+		count += body.Field == field && body.LaunchTimeLeft <= 0 ? 1 : 0;
+	}
+	return count;
+}
+
+void UGravityStasisSubsystem::RemoveBodyAt(int32 index)
+{
+	FPendingRelease& release = PendingReleases.AddDefaulted_GetRef();
+	release.Component = Bodies[index].Component;
+	release.bGravityEnabled = Bodies[index].bGravityEnabled;
+
+	BodyIndices.Remove(Bodies[index].Key);
+	Bodies.RemoveAtSwap(index);
+	if (index < Bodies.Num())
+	{
+		BodyIndices.Add(Bodies[index].Key, index);
+	}
+}
+
+void UGravityStasisSubsystem::Tick(float DeltaTime)
+{
+	GRAVITY_SHIFT_STAT_SCOPE(UpdateStasis);
+
+	for (int32 i = Bodies.Num() - 1; i >= 0; i--)
+	{
+		const FStasisBody& body = Bodies[i];
+		const bool bLaunchOver = body.LaunchTimeLeft > 0 && body.LaunchTimeLeft <= DeltaTime;
+		const bool bFieldGone = body.LaunchTimeLeft <= 0 && !body.Field.IsValid();
+		if (!body.Component.IsValid() || !body.Component->IsSimulatingPhysics() || bLaunchOver || bFieldGone)
+		{
+			RemoveBodyAt(i);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_GravityShift_StasisBodies, Bodies.Num());
+	if (Callback == nullptr || (Bodies.Num() == 0 && PendingReleases.Num() == 0))
+	{
+		PendingReleases.Reset();
+		return;
+	}
+
+	FGravityStasisInput* input = Callback->GetProducerInputData_External();
+	input->Commands.Reserve(Bodies.Num() + PendingReleases.Num());
+
+	for (const FPendingRelease& release : PendingReleases)
+	{
+		const FBodyInstance* bodyInstance = release.Component.IsValid() ? release.Component->GetBodyInstance() : nullptr;
+		if (bodyInstance != nullptr && bodyInstance->GetPhysicsActorHandle() != nullptr)
+		{
+			FGravityStasisCommand& command = input->Commands.AddDefaulted_GetRef();
+			command.Proxy = bodyInstance->GetPhysicsActorHandle();
+			command.Mode = EGravityStasisMode::Release;
+			command.bGravityEnabled = release.bGravityEnabled;
+		}
+	}
+	PendingReleases.Reset();
+
+	for (FStasisBody& body : Bodies)
+	{
+		const FBodyInstance* bodyInstance = body.Component->GetBodyInstance();
+		if (bodyInstance == nullptr || bodyInstance->GetPhysicsActorHandle() == nullptr)
+		{
+			continue;
+		}
+
+		FGravityStasisCommand& command = input->Commands.AddDefaulted_GetRef();
+		command.Proxy = bodyInstance->GetPhysicsActorHandle();
+		if (body.LaunchTimeLeft > 0)
+		{
+			command.Mode = EGravityStasisMode::Launch;
+			command.Target = body.LaunchDirection;
+			command.ParamA = body.LaunchSpeed;
+			command.ParamB = body.LaunchAcceleration;
+			body.LaunchTimeLeft -= DeltaTime;
+		}
+		else
+		{
+			const UGravityStasisComponent* field = body.Field.Get();
+			const FTransform fieldTransform(field->GetOwner()->GetActorQuat(), field->GetHoldCenter());
+			command.Mode = EGravityStasisMode::Hold;
+			command.Target = fieldTransform.TransformPositionNoScale(body.HoldOffset);
+			command.ParamA = field->HoldStiffness;
+			command.ParamB = field->HoldDamping;
+		}
+	}
+}
+
+TStatId UGravityStasisSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGravityStasisSubsystem, STATGROUP_Tickables);
+}
+
+bool UGravityStasisSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
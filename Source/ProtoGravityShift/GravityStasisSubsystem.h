@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GravityStasisSubsystem.generated.h"
+
+class UGravityStasisComponent;
+class FGravityStasisCallback;
+
+/**
+ * Drives every body caught in a stasis field. Once per frame the game thread gathers what each
+ * body should do into a single input, and a Chaos sim callback applies it to all of them on the
+ * physics thread, gravity overrides included, before the solver steps.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravityStasisSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Bodies already held by another field move over to this one */
+	void HoldBodies(UGravityStasisComponent* field, TConstArrayView<UPrimitiveComponent*> bodies);
+	void LaunchBodies(const UGravityStasisComponent* field, const FVector& direction);
+	void ReleaseBodies(const UGravityStasisComponent* field);
+
+	int32 GetNumHeldBodies(const UGravityStasisComponent* field) const;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FStasisBody
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		TObjectKey<UPrimitiveComponent> Key;
+		TWeakObjectPtr<const UGravityStasisComponent> Field;
+
+		/** From the hold center, in the field owner's space */
+		FVector HoldOffset = FVector::ZeroVector;
+
+		FVector LaunchDirection = FVector::ZeroVector;
+		float LaunchSpeed = 0;
+		float LaunchAcceleration = 0;
+		float LaunchTimeLeft = 0;
+
+		/** Restored on release, gravity field props keep theirs off */
+		bool bGravityEnabled = true;
+	};
+
+	struct FPendingRelease
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		bool bGravityEnabled = true;
+	};
+
+	void RemoveBodyAt(int32 index);
+
+	TArray<FStasisBody> Bodies;
+	TMap<TObjectKey<UPrimitiveComponent>, int32> BodyIndices;
+
+	/** Bodies let go of since the last tick, their gravity is handed back on the physics thread too */
+	TArray<FPendingRelease> PendingReleases;
+
+	FGravityStasisCallback* Callback = nullptr;
+};
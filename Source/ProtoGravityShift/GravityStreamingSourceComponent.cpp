@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityStreamingSourceComponent.h"
+#include "GravityShiftMovementComponent.h"
+#include "GravityShiftSim.h"
+#include "Engine/World.h"
+#include "WorldPartition/WorldPartitionSubsystem.h"
+
+UGravityStreamingSourceComponent::UGravityStreamingSourceComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UGravityStreamingSourceComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UWorldPartitionSubsystem* worldPartition = GetWorld()->GetSubsystem<UWorldPartitionSubsystem>())
+	{
+		worldPartition->RegisterStreamingSourceProvider(this);
+	}
+}
+
+void UGravityStreamingSourceComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UWorldPartitionSubsystem* worldPartition = GetWorld()->GetSubsystem<UWorldPartitionSubsystem>())
+	{
+		worldPartition->UnregisterStreamingSourceProvider(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UGravityStreamingSourceComponent::SetShiftParameters(UGravityShiftMovementComponent* movement, float acceleration, float maxSpeed)
+{
+	Movement = movement;
+	ShiftAcceleration = acceleration;
+	MaxShiftSpeed = maxSpeed;
+}
+
+void UGravityStreamingSourceComponent::PredictShift(const FVector& direction, float maxDistance)
+{
+	bHasPrediction = bPredictShiftPath;
+	PredictedDirection = direction.GetSafeNormal();
+	PredictedEnd = GetOwner()->GetActorLocation() + (PredictedDirection * maxDistance);
+}
+
+void UGravityStreamingSourceComponent::ClearPrediction()
+{
+	bHasPrediction = false;
+}
+
+bool UGravityStreamingSourceComponent::GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const
+{
+	if (!bHasPrediction || Movement == nullptr)
+	{
+		return false;
+	}
+
+	const FVector location = GetOwner()->GetActorLocation();
+	const float speed = FMath::Max(Movement->GetCurrentShiftSpeed(), Movement->Velocity.Size());
+	const float remainingDistance = FVector::DotProduct(PredictedEnd - location, PredictedDirection);
+	if (remainingDistance <= 0)
+	{
+		return false;
+	}
+
+	FWorldPartitionStreamingSource& source = OutStreamingSources.AddDefaulted_GetRef();
+	source.Name = *FString::Printf(TEXT("%s_ShiftPath"), *GetOwner()->GetName());
+	source.Location = location;
+	source.Rotation = FRotator::ZeroRotator;
+	source.TargetState = EStreamingSourceTargetState::Activated;
+	source.Priority = EStreamingSourcePriority::High;
+	source.Velocity = PredictedDirection * speed;
+	source.DebugColor = FColor::Orange;
+
+	// Shapes are offsets from the character, the ones past the landing collapse onto it
+	for (int32 i = 1; i <= PathSamples; i++)
+	{
+		const float distance = FMath::Min((float)GravityShiftSim::GetShiftDistance(LookAheadTime * i / PathSamples, speed, ShiftAcceleration, MaxShiftSpeed), remainingDistance);
+
+		FStreamingSourceShape& shape = source.Shapes.AddDefaulted_GetRef();
+		shape.bUseGridLoadingRange = false;
+		shape.Radius = PathRadius;
+		shape.Location = PredictedDirection * distance;
+		if (distance >= remainingDistance)
+		{
+			break;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "WorldPartition/WorldPartitionStreamingSource.h"
+#include "GravityStreamingSourceComponent.generated.h"
+
+class UGravityShiftMovementComponent;
+
+/**
+ * While its character shifts, streams World Partition cells in along the path the shift will
+ * follow over the next seconds, at high priority, so a fast shift doesn't outrun streaming.
+ * The usual player streaming source keeps covering where the character is.
+ */
+UCLASS(ClassGroup = (GravityShift), meta = (BlueprintSpawnableComponent))
+class PROTOGRAVITYSHIFT_API UGravityStreamingSourceComponent : public UActorComponent, public IWorldPartitionStreamingSourceProvider
+{
+	GENERATED_BODY()
+
+public:
+	UGravityStreamingSourceComponent();
+
+	void SetShiftParameters(UGravityShiftMovementComponent* movement, float acceleration, float maxSpeed);
+
+	/** Starts streaming along direction, up to maxDistance where the shift is known to land */
+	void PredictShift(const FVector& direction, float maxDistance);
+	void ClearPrediction();
+
+	FORCEINLINE bool HasPrediction() const { return bHasPrediction; }
+
+	// IWorldPartitionStreamingSourceProvider
+	virtual bool GetStreamingSources(TArray<FWorldPartitionStreamingSource>& OutStreamingSources) const override;
+
+	/** Seconds of the shift ahead that are streamed in */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float LookAheadTime = 3;
+
+	/** Spheres laid along the predicted path */
+	UPROPERTY(EditAnywhere, Category = GravityShift, meta = (ClampMin = "1", ClampMax = "16"))
+	int32 PathSamples = 6;
+
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float PathRadius = 3000;
+
+	/** Off, only the player's own streaming source loads cells */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	bool bPredictShiftPath = true;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	UPROPERTY()
+	UGravityShiftMovementComponent* Movement = nullptr;
+
+	float ShiftAcceleration = 0;
+	float MaxShiftSpeed = 0;
+
+	bool bHasPrediction = false;
+	FVector PredictedDirection = FVector::ZeroVector;
+	FVector PredictedEnd = FVector::ZeroVector;
+};
@@ -0,0 +1,373 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravitySurfaceIndex.h"
+#include "GravitySurfaceSubsystem.h"
+#include "GravityShiftStats.h"
+#include "Components/StaticMeshComponent.h"
+#include "EngineUtils.h"
+#include "PhysicsEngine/BodySetup.h"
+
+const FName AGravitySurfaceIndex::SurfaceTag(TEXT("GravitySurface"));
+
+AGravitySurfaceIndex::AGravitySurfaceIndex()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+#if WITH_EDITORONLY_DATA
+	// Queried from anywhere in the map, must never be streamed out
+	bIsSpatiallyLoaded = false;
+#endif
+}
+
+void AGravitySurfaceIndex::BeginPlay()
+{
+	Super::BeginPlay();
+
+	BuildCellLookup();
+	GetWorld()->GetSubsystem<UGravitySurfaceSubsystem>()->RegisterIndex(this);
+}
+
+void AGravitySurfaceIndex::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorld()->GetSubsystem<UGravitySurfaceSubsystem>()->UnregisterIndex(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGravitySurfaceIndex::BuildCellLookup()
+{
+	CellLookup.Reset();
+	CellLookup.Reserve(Cells.Num());
+	for (int32 i = 0; i < Cells.Num(); i++)
+	{
+		CellLookup.Add(Cells[i].Coord, i);
+	}
+}
+
+FIntVector AGravitySurfaceIndex::GetCellCoord(const FVector& location) const
+{
+	return FIntVector(FMath::FloorToInt(location.X / CellSize), FMath::FloorToInt(location.Y / CellSize), FMath::FloorToInt(location.Z / CellSize));
+}
+
+void AGravitySurfaceIndex::MakeWallBasis(const FVector& normal, FVector& outForward, FVector& outRight)
+{
+	// Same construction as AdjustToWall, so baked and traced walls orient the character identically
+	const FRotator lookRotator = (FVector(normal.X, normal.Y, 0).GetSafeNormal() * -1).Rotation();
+	outRight = FRotationMatrix(lookRotator).GetScaledAxis(EAxis::Y);
+
+	const FRotator meshWallRotator = FRotationMatrix::MakeFromZX(normal, outRight * -1).Rotator();
+	outForward = FRotationMatrix(meshWallRotator).GetScaledAxis(EAxis::Y);
+}
+
+// Queries
+
+bool AGravitySurfaceIndex::Raycast(const FVector& start, const FVector& direction, float length, FGravitySurfaceHit& outHit) const
+{
+	INC_DWORD_STAT(STAT_GravityShift_SurfaceIndexQueries);
+
+	const FVector end = start + (direction * length);
+	const FIntVector minCell = GetCellCoord(start.ComponentMin(end));
+	const FIntVector maxCell = GetCellCoord(start.ComponentMax(end));
+
+	// Wall probes span one or two cells, anything much longer is cheaper to trace
+	const FIntVector cellRange = maxCell - minCell + FIntVector(1);
+	if (cellRange.X * cellRange.Y * cellRange.Z > 27)
+	{
+		return false;
+	}
+
+	outHit.Patch = nullptr;
+	outHit.Distance = length;
+
+	TArray<int32, TInlineAllocator<32>> testedPatches;
+	for (int32 x = minCell.X; x <= maxCell.X; x++)
+	{
+		for (int32 y = minCell.Y; y <= maxCell.Y; y++)
+		{
+			for (int32 z = minCell.Z; z <= maxCell.Z; z++)
+			{
+				const int32* cellIndex = CellLookup.Find(FIntVector(x, y, z));
+				if (cellIndex == nullptr)
+				{
+					continue;
+				}
+
+				const FGravitySurfaceCell& cell = Cells[*cellIndex];
+				for (int32 i = cell.FirstPatch; i < cell.FirstPatch + cell.NumPatches; i++)
+				{
+					const int32 patchIndex = PatchIndices[i];
+					if (testedPatches.Contains(patchIndex))
+					{
+						continue;
+					}
+					testedPatches.Add(patchIndex);
+
+					float distance;
+					if (RaycastPatch(Patches[patchIndex], start, direction, outHit.Distance, distance))
+					{
+						outHit.Distance = distance;
+						outHit.Patch = &Patches[patchIndex];
+					}
+				}
+			}
+		}
+	}
+
+	if (outHit.Patch == nullptr)
+	{
+		return false;
+	}
+
+	outHit.Location = start + (direction * outHit.Distance);
+	return true;
+}
+
+bool AGravitySurfaceIndex::RaycastPatch(const FGravitySurfacePatch& patch, const FVector& start, const FVector& direction, float length, float& outDistance) const
+{
+	// Only surfaces facing the ray can be stood on
+	const double facing = FVector::DotProduct(direction, patch.Normal);
+	if (facing >= 0)
+	{
+		return false;
+	}
+
+	const double distance = FVector::DotProduct(patch.Center - start, patch.Normal) / facing;
+	if (distance < 0 || distance > length)
+	{
+		return false;
+	}
+
+	const FVector local = start + (direction * distance) - patch.Center;
+	if (FMath::Abs(FVector::DotProduct(local, patch.AxisU)) > patch.HalfExtents.X
+		|| FMath::Abs(FVector::DotProduct(local, patch.AxisV)) > patch.HalfExtents.Y)
+	{
+		return false;
+	}
+
+	outDistance = distance;
+	return true;
+}
+
+// Baking
+
+namespace GravitySurfaceBake
+{
+	static void AddPatch(const FVector& center, const FVector& normal, const FVector& halfU, const FVector& halfV, float minPatchSize,
+		TArray<FGravitySurfacePatch>& outPatches)
+	{
+		const float extentU = halfU.Size();
+		const float extentV = halfV.Size();
+		if (extentU * 2 < minPatchSize || extentV * 2 < minPatchSize)
+		{
+			return;
+		}
+
+		FGravitySurfacePatch& patch = outPatches.AddDefaulted_GetRef();
+		patch.Center = center;
+		patch.Normal = normal;
+		patch.AxisU = halfU / extentU;
+		patch.AxisV = halfV / extentV;
+		patch.HalfExtents = FVector2D(extentU, extentV);
+		AGravitySurfaceIndex::MakeWallBasis(normal, patch.WallForward, patch.WallRight);
+	}
+
+	static void AddBoxPatches(const FKBoxElem& box, const FTransform& componentTransform, float minPatchSize, TArray<FGravitySurfacePatch>& outPatches)
+	{
+		const FTransform boxTransform = box.GetTransform() * componentTransform;
+		const FVector halfSize(box.X * 0.5f, box.Y * 0.5f, box.Z * 0.5f);
+
+		for (int32 axis = 0; axis < 3; axis++)
+		{
+			FVector halfU = FVector::ZeroVector;
+			halfU[(axis + 1) % 3] = halfSize[(axis + 1) % 3];
+			FVector halfV = FVector::ZeroVector;
+			halfV[(axis + 2) % 3] = halfSize[(axis + 2) % 3];
+
+			for (const float side : { 1.f, -1.f })
+			{
+				FVector offset = FVector::ZeroVector;
+				offset[axis] = halfSize[axis] * side;
+				FVector normal = FVector::ZeroVector;
+				normal[axis] = side;
+
+				AddPatch(boxTransform.TransformPosition(offset), boxTransform.TransformVector(normal).GetSafeNormal(),
+					boxTransform.TransformVector(halfU), boxTransform.TransformVector(halfV), minPatchSize, outPatches);
+			}
+		}
+	}
+
+	static void AddConvexPatches(const FKConvexElem& convex, const FTransform& componentTransform, float minPatchSize, TArray<FGravitySurfacePatch>& outPatches)
+	{
+		if (convex.IndexData.Num() < 3)
+		{
+			return;
+		}
+
+		const FTransform convexTransform = convex.GetTransform() * componentTransform;
+		TArray<FVector> vertices;
+		vertices.Reserve(convex.VertexData.Num());
+		FVector centroid = FVector::ZeroVector;
+		for (const FVector& vertex : convex.VertexData)
+		{
+			centroid += vertices.Add_GetRef(convexTransform.TransformPosition(vertex));
+		}
+		centroid /= vertices.Num();
+
+		// Coplanar triangles are merged into one face
+		struct FFace
+		{
+			FVector Normal;
+			double Distance;
+			TArray<int32> Vertices;
+		};
+		TArray<FFace> faces;
+
+		for (int32 i = 0; i + 2 < convex.IndexData.Num(); i += 3)
+		{
+			const FVector& a = vertices[convex.IndexData[i]];
+			const FVector& b = vertices[convex.IndexData[i + 1]];
+			const FVector& c = vertices[convex.IndexData[i + 2]];
+			FVector normal = FVector::CrossProduct(b - a, c - a).GetSafeNormal();
+			if (normal.IsZero())
+			{
+				continue;
+			}
+			if (FVector::DotProduct(normal, a - centroid) < 0)
+			{
+				normal *= -1;
+			}
+
+			const double distance = FVector::DotProduct(normal, a);
+			FFace* face = faces.FindByPredicate([&](const FFace& other)
+			{
+				return FVector::DotProduct(other.Normal, normal) > 0.999 && FMath::Abs(other.Distance - distance) < 1;
+			});
+			if (face == nullptr)
+			{
+				face = &faces.AddDefaulted_GetRef();
+				face->Normal = normal;
+				face->Distance = distance;
+			}
+			face->Vertices.AddUnique(convex.IndexData[i]);
+			face->Vertices.AddUnique(convex.IndexData[i + 1]);
+			face->Vertices.AddUnique(convex.IndexData[i + 2]);
+		}
+
+		for (const FFace& face : faces)
+		{
+			// The face is stored as its bounding rectangle in the face plane
+			const FVector reference = FMath::Abs(face.Normal.Z) < 0.9 ? FVector::UpVector : FVector::ForwardVector;
+			const FVector axisU = FVector::CrossProduct(face.Normal, reference).GetSafeNormal();
+			const FVector axisV = FVector::CrossProduct(face.Normal, axisU);
+
+			FVector2D minUV(TNumericLimits<double>::Max());
+			FVector2D maxUV(TNumericLimits<double>::Lowest());
+			for (const int32 vertexIndex : face.Vertices)
+			{
+				const FVector2D uv(FVector::DotProduct(vertices[vertexIndex], axisU), FVector::DotProduct(vertices[vertexIndex], axisV));
+				minUV = FVector2D::Min(minUV, uv);
+				maxUV = FVector2D::Max(maxUV, uv);
+			}
+
+			const FVector2D centerUV = (minUV + maxUV) * 0.5;
+			const FVector2D halfUV = (maxUV - minUV) * 0.5;
+			const FVector center = (face.Normal * face.Distance) + (axisU * centerUV.X) + (axisV * centerUV.Y);
+			AddPatch(center, face.Normal, axisU * halfUV.X, axisV * halfUV.Y, minPatchSize, outPatches);
+		}
+	}
+}
+
+void AGravitySurfaceIndex::GatherPatches(const AActor* actor, float minPatchSize, TArray<FGravitySurfacePatch>& outPatches)
+{
+	TInlineComponentArray<UStaticMeshComponent*> components(actor);
+	for (const UStaticMeshComponent* component : components)
+	{
+		GatherComponentPatches(component, minPatchSize, outPatches);
+	}
+}
+
+bool AGravitySurfaceIndex::GatherComponentPatches(const UStaticMeshComponent* component, float minPatchSize, TArray<FGravitySurfacePatch>& outPatches)
+{
+	if (component->Mobility != EComponentMobility::Static || !component->IsQueryCollisionEnabled())
+	{
+		return false;
+	}
+
+	// Visibility says nothing about standing on it, meshes pawns walk through can block it and solid walls ignore it
+	const bool bStaticBlocking = component->GetCollisionObjectType() == ECC_WorldStatic && component->GetCollisionResponseToChannel(ECC_Pawn) == ECR_Block;
+	const AActor* owner = component->GetOwner();
+	if (!bStaticBlocking && !component->ComponentHasTag(SurfaceTag) && (owner == nullptr || !owner->ActorHasTag(SurfaceTag)))
+	{
+		return false;
+	}
+
+	const UBodySetup* bodySetup = component->GetBodySetup();
+	if (bodySetup == nullptr)
+	{
+		return false;
+	}
+
+	const FTransform componentTransform = component->GetComponentTransform();
+	for (const FKBoxElem& box : bodySetup->AggGeom.BoxElems)
+	{
+		GravitySurfaceBake::AddBoxPatches(box, componentTransform, minPatchSize, outPatches);
+	}
+	for (const FKConvexElem& convex : bodySetup->AggGeom.ConvexElems)
+	{
+		GravitySurfaceBake::AddConvexPatches(convex, componentTransform, minPatchSize, outPatches);
+	}
+	return true;
+}
+
+#if WITH_EDITOR
+
+void AGravitySurfaceIndex::BakeSurfaceIndex()
+{
+	Modify();
+	Patches.Reset();
+
+	// Only loaded actors are visited, load the whole World Partition map before baking
+	for (TActorIterator<AActor> it(GetWorld()); it; ++it)
+	{
+		GatherPatches(*it, MinPatchSize, Patches);
+	}
+
+	TMap<FIntVector, TArray<int32>> cellPatches;
+	for (int32 i = 0; i < Patches.Num(); i++)
+	{
+		const FGravitySurfacePatch& patch = Patches[i];
+		const FVector extent = (patch.AxisU * patch.HalfExtents.X).GetAbs() + (patch.AxisV * patch.HalfExtents.Y).GetAbs();
+		const FIntVector minCell = GetCellCoord(patch.Center - extent);
+		const FIntVector maxCell = GetCellCoord(patch.Center + extent);
+		for (int32 x = minCell.X; x <= maxCell.X; x++)
+		{
+			for (int32 y = minCell.Y; y <= maxCell.Y; y++)
+			{
+				for (int32 z = minCell.Z; z <= maxCell.Z; z++)
+				{
+					cellPatches.FindOrAdd(FIntVector(x, y, z)).Add(i);
+				}
+			}
+		}
+	}
+
+	Cells.Reset(cellPatches.Num());
+	PatchIndices.Reset();
+	for (const TPair<FIntVector, TArray<int32>>& pair : cellPatches)
+	{
+		FGravitySurfaceCell& cell = Cells.AddDefaulted_GetRef();
+		cell.Coord = pair.Key;
+		cell.FirstPatch = PatchIndices.Num();
+		cell.NumPatches = pair.Value.Num();
+		PatchIndices.Append(pair.Value);
+	}
+
+	BuildCellLookup();
+
+	UE_LOG(LogTemp, Log, TEXT("Baked %d gravity surface patches into %d cells"), Patches.Num(), Cells.Num());
+}
+
+#endif
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "GravitySurfaceIndex.generated.h"
+
+/** Planar rectangle of static collision with the wall basis AdjustToWall would compute for it, which Mass shifters walk the wall with */
+USTRUCT()
+struct FGravitySurfacePatch
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector Center = FVector::ZeroVector;
+	UPROPERTY()
+	FVector Normal = FVector::UpVector;
+
+	/** Rectangle edges, HalfExtents are measured along them */
+	UPROPERTY()
+	FVector AxisU = FVector::ForwardVector;
+	UPROPERTY()
+	FVector AxisV = FVector::RightVector;
+	UPROPERTY()
+	FVector2D HalfExtents = FVector2D::ZeroVector;
+
+	UPROPERTY()
+	FVector WallForward = FVector::ForwardVector;
+	UPROPERTY()
+	FVector WallRight = FVector::RightVector;
+};
+
+/** Range of PatchIndices overlapping one grid cell */
+USTRUCT()
+struct FGravitySurfaceCell
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FIntVector Coord = FIntVector::ZeroValue;
+	UPROPERTY()
+	int32 FirstPatch = 0;
+	UPROPERTY()
+	int32 NumPatches = 0;
+};
+
+struct FGravitySurfaceHit
+{
+	FVector Location;
+	float Distance;
+	const FGravitySurfacePatch* Patch;
+};
+
+/**
+ * Baked uniform grid of the static surfaces of a map. Wall adhesion asks it which surface
+ * lies along GravityDirection instead of tracing the physics scene every frame.
+ * Place one per map and press Bake Surface Index after editing static geometry.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API AGravitySurfaceIndex : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AGravitySurfaceIndex();
+
+	/** Closest baked surface facing the ray, or false when there is none within length */
+	bool Raycast(const FVector& start, const FVector& direction, float length, FGravitySurfaceHit& outHit) const;
+
+	static void MakeWallBasis(const FVector& normal, FVector& outForward, FVector& outRight);
+
+	/** Standable faces of actor's static collision, the ones a bake or the surface navigation graph keep */
+	static void GatherPatches(const AActor* actor, float minPatchSize, TArray<FGravitySurfacePatch>& outPatches);
+
+	/**
+	 * Same for a single component, false when it isn't a gravity surface: static world geometry that
+	 * blocks characters, or anything static tagged SurfaceTag on the component or its actor
+	 */
+	static bool GatherComponentPatches(const class UStaticMeshComponent* component, float minPatchSize, TArray<FGravitySurfacePatch>& outPatches);
+
+	/** Opts static collision in as a gravity surface when it isn't WorldStatic or doesn't block pawns */
+	static const FName SurfaceTag;
+
+#if WITH_EDITOR
+	UFUNCTION(CallInEditor, Category = GravitySurface)
+	void BakeSurfaceIndex();
+#endif
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void BuildCellLookup();
+
+	FIntVector GetCellCoord(const FVector& location) const;
+
+	bool RaycastPatch(const FGravitySurfacePatch& patch, const FVector& start, const FVector& direction, float length, float& outDistance) const;
+
+	UPROPERTY(EditAnywhere, Category = GravitySurface)
+	float CellSize = 400;
+
+	/** Faces smaller than this (in cm on each side) can't hold a character and are not baked */
+	UPROPERTY(EditAnywhere, Category = GravitySurface)
+	float MinPatchSize = 40;
+
+	UPROPERTY()
+	TArray<FGravitySurfacePatch> Patches;
+	UPROPERTY()
+	TArray<FGravitySurfaceCell> Cells;
+	UPROPERTY()
+	TArray<int32> PatchIndices;
+
+	TMap<FIntVector, int32> CellLookup;
+};
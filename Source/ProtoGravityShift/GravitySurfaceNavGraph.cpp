@@ -0,0 +1,503 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravitySurfaceNavGraph.h"
+#include "GravitySurfaceIndex.h"
+#include "GravityShiftSim.h"
+#include "Algo/Reverse.h"
+
+// Tiles this much alike in normal are the same surface, and a shift between them is a walk
+static constexpr double NavSamePlaneDot = 0.99;
+static constexpr double NavShiftMaxNormalDot = 0.9;
+
+// Steeper than this onto the target surface or it is only grazed
+static constexpr double NavShiftLandingDot = -0.2;
+
+// Tiles facing each other more than this are the two sides of a slab, never walked between
+static constexpr double NavWalkMinNormalDot = -0.5;
+
+static bool RaycastTile(const FGravityNavNode& node, const FVector& start, const FVector& direction, float length)
+{
+	// Same test as the surface index: only surfaces facing the ray stop it
+	const double facing = FVector::DotProduct(direction, node.Normal);
+	if (facing >= 0)
+	{
+		return false;
+	}
+
+	const double distance = FVector::DotProduct(node.Center - start, node.Normal) / facing;
+	if (distance < 0 || distance > length)
+	{
+		return false;
+	}
+
+	const FVector local = start + (direction * distance) - node.Center;
+	return FMath::Abs(FVector::DotProduct(local, node.AxisU)) <= node.HalfExtents.X
+		&& FMath::Abs(FVector::DotProduct(local, node.AxisV)) <= node.HalfExtents.Y;
+}
+
+FVector FGravityNavNode::GetClosestPoint(const FVector& location) const
+{
+	const FVector local = location - Center;
+	const double u = FMath::Clamp(FVector::DotProduct(local, AxisU), -HalfExtents.X, HalfExtents.X);
+	const double v = FMath::Clamp(FVector::DotProduct(local, AxisV), -HalfExtents.Y, HalfExtents.Y);
+	return Center + (AxisU * u) + (AxisV * v);
+}
+
+float FGravityNavAgent::GetLinkCost(const FGravityNavLink& link) const
+{
+	if (link.Type == EGravityNavLinkType::Shift)
+	{
+		return ShiftPrepareTime + GetShiftTime(link.Distance);
+	}
+	return link.Distance / FMath::Max(WalkSpeed, 1.0f);
+}
+
+float FGravityNavAgent::GetShiftTime(float distance) const
+{
+	return (float)GravityShiftSim::GetShiftTime(distance, FMath::Max(ShiftStartSpeed, 1.0f), ShiftAcceleration, MaxShiftSpeed);
+}
+
+// Building
+
+void FGravitySurfaceNavGraph::AddLevel(TObjectKey<ULevel> level, TConstArrayView<FGravitySurfacePatch> patches, const FBuildSettings& settings)
+{
+	RemoveLevel(level);
+
+	TArray<int32>& levelNodes = LevelNodes.Add(level);
+	for (const FGravitySurfacePatch& patch : patches)
+	{
+		const int32 tilesU = FMath::Max(1, FMath::CeilToInt32(patch.HalfExtents.X * 2 / settings.NodeSize));
+		const int32 tilesV = FMath::Max(1, FMath::CeilToInt32(patch.HalfExtents.Y * 2 / settings.NodeSize));
+		const FVector2D tileHalfExtents(patch.HalfExtents.X / tilesU, patch.HalfExtents.Y / tilesV);
+
+		for (int32 u = 0; u < tilesU; u++)
+		{
+			for (int32 v = 0; v < tilesV; v++)
+			{
+				FGravityNavNode node;
+				node.Center = patch.Center
+					+ (patch.AxisU * (tileHalfExtents.X * ((2 * u) + 1) - patch.HalfExtents.X))
+					+ (patch.AxisV * (tileHalfExtents.Y * ((2 * v) + 1) - patch.HalfExtents.Y));
+				node.Normal = patch.Normal;
+				node.AxisU = patch.AxisU;
+				node.AxisV = patch.AxisV;
+				node.HalfExtents = tileHalfExtents;
+				node.Level = level;
+
+				const int32 index = Nodes.Add(MakeShared<FGravityNavNode, ESPMode::ThreadSafe>(MoveTemp(node)));
+				AddToCells(index);
+				levelNodes.Add(index);
+			}
+		}
+	}
+
+	const TSet<int32> newNodes(levelNodes);
+	for (const int32 node : levelNodes)
+	{
+		LinkNode(node, newNodes, settings);
+	}
+}
+
+void FGravitySurfaceNavGraph::RemoveLevel(TObjectKey<ULevel> level)
+{
+	TArray<int32> removedNodes;
+	if (!LevelNodes.RemoveAndCopyValue(level, removedNodes))
+	{
+		return;
+	}
+
+	for (const int32 node : removedNodes)
+	{
+		RemoveFromCells(node);
+		Nodes.RemoveAt(node);
+	}
+
+	// Shift links are one way, so any node may point into the removed level. Only the nodes that do are copied
+	const TSet<int32> removedSet(removedNodes);
+	const auto isRemoved = [&removedSet](const FGravityNavLink& link) { return removedSet.Contains(link.Target); };
+	for (auto it = Nodes.CreateIterator(); it; ++it)
+	{
+		if ((*it)->Links.ContainsByPredicate(isRemoved))
+		{
+			EditNode(it.GetIndex()).Links.RemoveAllSwap(isRemoved);
+		}
+	}
+}
+
+FGravityNavNode& FGravitySurfaceNavGraph::EditNode(int32 node)
+{
+	FNodePtr& shared = Nodes[node];
+	if (!shared.IsUnique())
+	{
+		shared = MakeShared<FGravityNavNode, ESPMode::ThreadSafe>(*shared);
+	}
+	return *shared;
+}
+
+TArray<int32>& FGravitySurfaceNavGraph::EditCell(const FIntVector& coord)
+{
+	FCellPtr& shared = Cells.FindOrAdd(coord);
+	if (!shared.IsValid())
+	{
+		shared = MakeShared<TArray<int32>, ESPMode::ThreadSafe>();
+	}
+	else if (!shared.IsUnique())
+	{
+		shared = MakeShared<TArray<int32>, ESPMode::ThreadSafe>(*shared);
+	}
+	return *shared;
+}
+
+FIntVector FGravitySurfaceNavGraph::GetCellCoord(const FVector& location) const
+{
+	return FIntVector(FMath::FloorToInt(location.X / CellSize), FMath::FloorToInt(location.Y / CellSize), FMath::FloorToInt(location.Z / CellSize));
+}
+
+void FGravitySurfaceNavGraph::AddToCells(int32 node)
+{
+	const FGravityNavNode& tile = GetNode(node);
+	const FVector extent = (tile.AxisU * tile.HalfExtents.X).GetAbs() + (tile.AxisV * tile.HalfExtents.Y).GetAbs();
+	const FIntVector minCell = GetCellCoord(tile.Center - extent);
+	const FIntVector maxCell = GetCellCoord(tile.Center + extent);
+	for (int32 x = minCell.X; x <= maxCell.X; x++)
+	{
+		for (int32 y = minCell.Y; y <= maxCell.Y; y++)
+		{
+			for (int32 z = minCell.Z; z <= maxCell.Z; z++)
+			{
+				EditCell(FIntVector(x, y, z)).Add(node);
+			}
+		}
+	}
+}
+
+void FGravitySurfaceNavGraph::RemoveFromCells(int32 node)
+{
+	const FGravityNavNode& tile = GetNode(node);
+	const FVector extent = (tile.AxisU * tile.HalfExtents.X).GetAbs() + (tile.AxisV * tile.HalfExtents.Y).GetAbs();
+	const FIntVector minCell = GetCellCoord(tile.Center - extent);
+	const FIntVector maxCell = GetCellCoord(tile.Center + extent);
+	for (int32 x = minCell.X; x <= maxCell.X; x++)
+	{
+		for (int32 y = minCell.Y; y <= maxCell.Y; y++)
+		{
+			for (int32 z = minCell.Z; z <= maxCell.Z; z++)
+			{
+				const FIntVector coord(x, y, z);
+				if (Cells.Contains(coord))
+				{
+					TArray<int32>& cell = EditCell(coord);
+					cell.RemoveSingleSwap(node);
+					if (cell.Num() == 0)
+					{
+						Cells.Remove(coord);
+					}
+				}
+			}
+		}
+	}
+}
+
+template<typename FunctionType>
+void FGravitySurfaceNavGraph::ForEachNodeInBox(const FBox& box, FunctionType&& function) const
+{
+	const FIntVector minCell = GetCellCoord(box.Min);
+	const FIntVector maxCell = GetCellCoord(box.Max);
+
+	// Tiles crossing cell borders are in several cells
+	TSet<int32> visited;
+	for (int32 x = minCell.X; x <= maxCell.X; x++)
+	{
+		for (int32 y = minCell.Y; y <= maxCell.Y; y++)
+		{
+			for (int32 z = minCell.Z; z <= maxCell.Z; z++)
+			{
+				const FCellPtr* cell = Cells.Find(FIntVector(x, y, z));
+				if (cell == nullptr)
+				{
+					continue;
+				}
+				for (const int32 node : **cell)
+				{
+					bool bAlreadyVisited = false;
+					visited.Add(node, &bAlreadyVisited);
+					if (!bAlreadyVisited)
+					{
+						function(node);
+					}
+				}
+			}
+		}
+	}
+}
+
+void FGravitySurfaceNavGraph::LinkNode(int32 node, const TSet<int32>& newNodes, const FBuildSettings& settings)
+{
+	// Linking may copy the node, so nothing is read from it once it starts
+	const FGravityNavNode& tile = GetNode(node);
+	const FVector center = tile.Center;
+	const FBox tileBox(center, center);
+	const float walkRange = tile.HalfExtents.Size() + settings.NodeSize + settings.WalkLinkGap;
+
+	// Walks are two way, so a pair of new nodes is linked once, from the lower index
+	ForEachNodeInBox(tileBox.ExpandBy(walkRange), [&](int32 other)
+	{
+		if (other != node && !(newNodes.Contains(other) && other < node))
+		{
+			TryWalkLink(node, other, settings);
+		}
+	});
+
+	// Shifts are one way, both directions are tried, the nearest targets first
+	TArray<TPair<double, int32>> shiftTargets;
+	ForEachNodeInBox(tileBox.ExpandBy(settings.MaxShiftDistance), [&](int32 other)
+	{
+		if (other != node && !(newNodes.Contains(other) && other < node))
+		{
+			shiftTargets.Emplace(FVector::DistSquared(center, GetNode(other).Center), other);
+		}
+	});
+	shiftTargets.Sort([](const TPair<double, int32>& a, const TPair<double, int32>& b) { return a.Key < b.Key; });
+
+	for (const TPair<double, int32>& target : shiftTargets)
+	{
+		TryShiftLink(node, target.Value, settings);
+		TryShiftLink(target.Value, node, settings);
+	}
+}
+
+bool FGravitySurfaceNavGraph::TryWalkLink(int32 from, int32 to, const FBuildSettings& settings)
+{
+	const FGravityNavNode& fromTile = GetNode(from);
+	const FGravityNavNode& toTile = GetNode(to);
+	if (FVector::DotProduct(fromTile.Normal, toTile.Normal) < NavWalkMinNormalDot)
+	{
+		return false;
+	}
+
+	// Closest points of the two tiles, refined once, meet on their shared edge
+	FVector fromPoint = fromTile.GetClosestPoint(toTile.Center);
+	const FVector toPoint = toTile.GetClosestPoint(fromPoint);
+	fromPoint = fromTile.GetClosestPoint(toPoint);
+	if (FVector::DistSquared(fromPoint, toPoint) > FMath::Square(settings.WalkLinkGap))
+	{
+		return false;
+	}
+
+	FGravityNavLink link;
+	link.Type = EGravityNavLinkType::Walk;
+	link.Point = (fromPoint + toPoint) * 0.5;
+	link.Distance = FVector::Dist(fromTile.Center, link.Point) + FVector::Dist(link.Point, toTile.Center);
+
+	link.Target = to;
+	EditNode(from).Links.Add(link);
+	link.Target = from;
+	EditNode(to).Links.Add(link);
+	return true;
+}
+
+bool FGravitySurfaceNavGraph::TryShiftLink(int32 from, int32 to, const FBuildSettings& settings)
+{
+	const FGravityNavNode& fromTile = GetNode(from);
+	const FGravityNavNode& toTile = GetNode(to);
+	if (FVector::DotProduct(fromTile.Normal, toTile.Normal) > NavShiftMaxNormalDot
+		|| CountLinks(from, EGravityNavLinkType::Shift) >= settings.MaxShiftLinksPerNode)
+	{
+		return false;
+	}
+
+	const FVector start = fromTile.Center + (fromTile.Normal * settings.ShiftClearance);
+	const FVector landing = toTile.GetClosestPoint(start);
+	const FVector delta = landing - start;
+	const double distance = delta.Size();
+	if (distance < settings.MinShiftDistance || distance > settings.MaxShiftDistance
+		|| FVector::DotProduct(delta / distance, toTile.Normal) > NavShiftLandingDot)
+	{
+		return false;
+	}
+
+	if (!IsShiftClear(start, landing, to))
+	{
+		return false;
+	}
+
+	FGravityNavLink& link = EditNode(from).Links.AddDefaulted_GetRef();
+	link.Target = to;
+	link.Type = EGravityNavLinkType::Shift;
+	link.Point = landing;
+	link.Distance = distance;
+	return true;
+}
+
+bool FGravitySurfaceNavGraph::IsShiftClear(const FVector& start, const FVector& end, int32 to) const
+{
+	const FGravityNavNode& target = GetNode(to);
+	const FVector delta = end - start;
+	const float length = delta.Size();
+	const FVector direction = delta / length;
+
+	// Walk the cells along the shift in quarter cell steps
+	const int32 steps = FMath::Max(1, FMath::CeilToInt32(length / (CellSize * 0.25f)));
+	TArray<FIntVector, TInlineAllocator<64>> visitedCells;
+	TSet<int32> testedNodes;
+	for (int32 i = 0; i <= steps; i++)
+	{
+		const FIntVector coord = GetCellCoord(start + (delta * ((double)i / steps)));
+		if (visitedCells.Contains(coord))
+		{
+			continue;
+		}
+		visitedCells.Add(coord);
+
+		const FCellPtr* cell = Cells.Find(coord);
+		if (cell == nullptr)
+		{
+			continue;
+		}
+
+		for (const int32 other : **cell)
+		{
+			bool bAlreadyTested = false;
+			testedNodes.Add(other, &bAlreadyTested);
+			if (other == to || bAlreadyTested)
+			{
+				continue;
+			}
+
+			// The other tiles of the target's surface are as good a landing
+			const FGravityNavNode& node = GetNode(other);
+			if (FVector::DotProduct(node.Normal, target.Normal) > NavSamePlaneDot && FMath::Abs(FVector::DotProduct(node.Center - target.Center, target.Normal)) < 1)
+			{
+				continue;
+			}
+
+			// Stop short of the landing, tiles touching the target there don't block it
+			if (RaycastTile(node, start, direction, length - 1))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int32 FGravitySurfaceNavGraph::CountLinks(int32 node, EGravityNavLinkType type) const
+{
+	int32 count = 0;
+	for (const FGravityNavLink& link : GetNode(node).Links)
+	{
+		count += link.Type == type ? 1 : 0;
+	}
+	return count;
+}
+
+// Queries
+
+int32 FGravitySurfaceNavGraph::FindNearestNode(const FVector& location, float maxDistance) const
+{
+	int32 nearest = INDEX_NONE;
+	double nearestDistanceSq = FMath::Square(maxDistance);
+	ForEachNodeInBox(FBox(location, location).ExpandBy(maxDistance), [&](int32 node)
+	{
+		const double distanceSq = FVector::DistSquared(location, GetNode(node).GetClosestPoint(location));
+		if (distanceSq <= nearestDistanceSq)
+		{
+			nearest = node;
+			nearestDistanceSq = distanceSq;
+		}
+	});
+	return nearest;
+}
+
+bool FGravitySurfaceNavGraph::FindPath(const FVector& start, const FVector& goal, float maxSnapDistance, const FGravityNavAgent& agent,
+	TArray<FGravityNavPathPoint>& outPath) const
+{
+	outPath.Reset();
+
+	const int32 startNode = FindNearestNode(start, maxSnapDistance);
+	const int32 goalNode = FindNearestNode(goal, maxSnapDistance);
+	if (startNode == INDEX_NONE || goalNode == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// Straight to the goal at top speed, never more than what is left
+	const FVector goalCenter = GetNode(goalNode).Center;
+	const float inverseMaxSpeed = 1.0f / agent.GetMaxSpeed();
+	auto heuristic = [&](int32 node) { return FVector::Dist(GetNode(node).Center, goalCenter) * inverseMaxSpeed; };
+	auto lowerCost = [](const TPair<float, int32>& a, const TPair<float, int32>& b) { return a.Key < b.Key; };
+
+	const int32 maxIndex = Nodes.GetMaxIndex();
+	TArray<float> costs;
+	costs.Init(MAX_flt, maxIndex);
+	TArray<int32> previousNodes;
+	previousNodes.Init(INDEX_NONE, maxIndex);
+	TArray<int32> previousLinks;
+	previousLinks.Init(INDEX_NONE, maxIndex);
+	TBitArray<> closed(false, maxIndex);
+
+	TArray<TPair<float, int32>> open;
+	costs[startNode] = 0;
+	open.HeapPush(TPair<float, int32>(heuristic(startNode), startNode), lowerCost);
+
+	while (open.Num() > 0)
+	{
+		TPair<float, int32> current;
+		open.HeapPop(current, lowerCost, false);
+		const int32 node = current.Value;
+		if (node == goalNode)
+		{
+			break;
+		}
+		if (closed[node])
+		{
+			continue;
+		}
+		closed[node] = true;
+
+		const TArray<FGravityNavLink>& links = GetNode(node).Links;
+		for (int32 i = 0; i < links.Num(); i++)
+		{
+			const FGravityNavLink& link = links[i];
+			const float cost = costs[node] + agent.GetLinkCost(link);
+			if (cost < costs[link.Target])
+			{
+				costs[link.Target] = cost;
+				previousNodes[link.Target] = node;
+				previousLinks[link.Target] = i;
+				open.HeapPush(TPair<float, int32>(cost + heuristic(link.Target), link.Target), lowerCost);
+			}
+		}
+	}
+
+	if (goalNode != startNode && previousNodes[goalNode] == INDEX_NONE)
+	{
+		return false;
+	}
+
+	TArray<int32> chain;
+	for (int32 node = goalNode; node != startNode; node = previousNodes[node])
+	{
+		chain.Add(node);
+	}
+	Algo::Reverse(chain);
+
+	const FGravityNavNode& startTile = GetNode(startNode);
+	outPath.Add({ startTile.GetClosestPoint(start), startTile.Normal, EGravityNavLinkType::Walk });
+	for (const int32 node : chain)
+	{
+		const FGravityNavNode& fromTile = GetNode(previousNodes[node]);
+		const FGravityNavLink& link = fromTile.Links[previousLinks[node]];
+		if (link.Type == EGravityNavLinkType::Shift)
+		{
+			// Shifts take off from the middle of the tile they were linked from
+			outPath.Add({ fromTile.Center, fromTile.Normal, EGravityNavLinkType::Walk });
+		}
+		outPath.Add({ link.Point, GetNode(node).Normal, link.Type });
+	}
+
+	const FGravityNavNode& goalTile = GetNode(goalNode);
+	outPath.Add({ goalTile.GetClosestPoint(goal), goalTile.Normal, EGravityNavLinkType::Walk });
+	return true;
+}
@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+struct FGravitySurfacePatch;
+class ULevel;
+
+enum class EGravityNavLinkType : uint8
+{
+	/** Walking over the edge shared with the next surface, the movement component wraps onto it */
+	Walk,
+	/** Levitating and shifting in a straight line onto a surface facing this one */
+	Shift,
+};
+
+struct FGravityNavLink
+{
+	int32 Target = INDEX_NONE;
+	EGravityNavLinkType Type = EGravityNavLinkType::Walk;
+
+	/** Middle of the shared edge for a walk, landing point for a shift */
+	FVector Point = FVector::ZeroVector;
+
+	/** From the node's center to the target's, through Point */
+	float Distance = 0;
+};
+
+/** A tile of standable surface, no larger than the graph's node size */
+struct FGravityNavNode
+{
+	FVector Center = FVector::ZeroVector;
+	FVector Normal = FVector::UpVector;
+	FVector AxisU = FVector::ForwardVector;
+	FVector AxisV = FVector::RightVector;
+	FVector2D HalfExtents = FVector2D::ZeroVector;
+
+	TObjectKey<ULevel> Level;
+	TArray<FGravityNavLink> Links;
+
+	FVector GetClosestPoint(const FVector& location) const;
+};
+
+/** How fast a character covers each kind of link, path costs are in seconds */
+struct FGravityNavAgent
+{
+	float WalkSpeed = 500;
+	float ShiftStartSpeed = 980;
+	float ShiftAcceleration = 20;
+	float MaxShiftSpeed = 10000;
+
+	/** Levitating and aiming before a shift sets off */
+	float ShiftPrepareTime = 0.5f;
+
+	float GetLinkCost(const FGravityNavLink& link) const;
+
+	/** Seconds to shift distance, with the same integration as PhysShiftFall */
+	float GetShiftTime(float distance) const;
+
+	/** Fastest either way of moving, for an A* heuristic that never overestimates */
+	FORCEINLINE float GetMaxSpeed() const { return FMath::Max3(WalkSpeed, ShiftStartSpeed, MaxShiftSpeed); }
+};
+
+struct FGravityNavPathPoint
+{
+	FVector Location = FVector::ZeroVector;
+	FVector Normal = FVector::UpVector;
+
+	/** How this point is reached from the previous one */
+	EGravityNavLinkType Arrival = EGravityNavLinkType::Walk;
+};
+
+/**
+ * Standable surfaces tiled into nodes, linked by walks over the edges they share and by
+ * straight shifts between surfaces that face each other. Levels are added and removed one
+ * at a time, only the nodes of the changed level get relinked, and shift links are checked
+ * against the graph's own surfaces so a build never touches the physics scene.
+ * Nodes and cells are shared between copies of a graph and only copied once a copy changes them,
+ * so building on a copy costs the nodes it touches rather than the whole graph.
+ */
+class PROTOGRAVITYSHIFT_API FGravitySurfaceNavGraph
+{
+public:
+	struct FBuildSettings
+	{
+		/** Surfaces are split into square tiles this size at most, in cm */
+		float NodeSize = 400;
+
+		/** Largest gap between two tiles that are walked across */
+		float WalkLinkGap = 10;
+
+		/** Height above a surface a shift starts from, about the capsule's half height */
+		float ShiftClearance = 90;
+		float MinShiftDistance = 300;
+		float MaxShiftDistance = 3000;
+		int32 MaxShiftLinksPerNode = 16;
+	};
+
+	void AddLevel(TObjectKey<ULevel> level, TConstArrayView<FGravitySurfacePatch> patches, const FBuildSettings& settings);
+	void RemoveLevel(TObjectKey<ULevel> level);
+
+	/** Node whose tile comes closest to location, INDEX_NONE if none is within maxDistance */
+	int32 FindNearestNode(const FVector& location, float maxDistance) const;
+
+	/** A* between the nodes nearest start and goal, false when they aren't within maxSnapDistance or not connected */
+	bool FindPath(const FVector& start, const FVector& goal, float maxSnapDistance, const FGravityNavAgent& agent, TArray<FGravityNavPathPoint>& outPath) const;
+
+	FORCEINLINE int32 GetNumNodes() const { return Nodes.Num(); }
+	FORCEINLINE const FGravityNavNode& GetNode(int32 node) const { return *Nodes[node]; }
+
+private:
+	typedef TSharedPtr<FGravityNavNode, ESPMode::ThreadSafe> FNodePtr;
+	typedef TSharedPtr<TArray<int32>, ESPMode::ThreadSafe> FCellPtr;
+
+	static constexpr float CellSize = 1000;
+
+	/** The node or cell, copied first if another graph still shares it */
+	FGravityNavNode& EditNode(int32 node);
+	TArray<int32>& EditCell(const FIntVector& coord);
+
+	FIntVector GetCellCoord(const FVector& location) const;
+	void AddToCells(int32 node);
+	void RemoveFromCells(int32 node);
+
+	template<typename FunctionType>
+	void ForEachNodeInBox(const FBox& box, FunctionType&& function) const;
+
+	/** Links node with every other one, skipping new nodes below it that already did so */
+	void LinkNode(int32 node, const TSet<int32>& newNodes, const FBuildSettings& settings);
+	bool TryWalkLink(int32 from, int32 to, const FBuildSettings& settings);
+	bool TryShiftLink(int32 from, int32 to, const FBuildSettings& settings);
+
+	/** True when the first surface a shift from start meets is to, or a tile in its plane */
+	bool IsShiftClear(const FVector& start, const FVector& end, int32 to) const;
+
+	int32 CountLinks(int32 node, EGravityNavLinkType type) const;
+
+	TSparseArray<FNodePtr> Nodes;
+	TMap<FIntVector, FCellPtr> Cells;
+	TMap<TObjectKey<ULevel>, TArray<int32>> LevelNodes;
+};
@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravitySurfaceNavSubsystem.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+
+// Same as the surface index bake: smaller faces can't hold a character
+static constexpr float NavMinPatchSize = 40;
+
+// How far from the graph a path may start or end, about a capsule's height
+static constexpr float NavMaxSnapDistance = 250;
+
+void UGravitySurfaceNavSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	Graph = MakeShared<FGravitySurfaceNavGraph, ESPMode::ThreadSafe>();
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UGravitySurfaceNavSubsystem::OnLevelAdded);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UGravitySurfaceNavSubsystem::OnLevelRemoved);
+
+	for (ULevel* level : InWorld.GetLevels())
+	{
+		if (level->bIsVisible)
+		{
+			OnLevelAdded(level, &InWorld);
+		}
+	}
+}
+
+void UGravitySurfaceNavSubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	// Tasks only hold their own copies of the graph, they can finish on their own
+	PathQueries.Reset();
+	PendingBuilds.Reset();
+
+	Super::Deinitialize();
+}
+
+void UGravitySurfaceNavSubsystem::OnLevelAdded(ULevel* level, UWorld* world)
+{
+	if (world != GetWorld() || level == nullptr || AddedLevels.Contains(level))
+	{
+		return;
+	}
+	AddedLevels.Add(level);
+
+	// Gathered here, the actors can only be read on the game thread
+	FLevelBuild& build = PendingBuilds.AddDefaulted_GetRef();
+	build.Level = level;
+	for (const AActor* actor : level->Actors)
+	{
+		if (actor != nullptr)
+		{
+			AGravitySurfaceIndex::GatherPatches(actor, NavMinPatchSize, build.Patches);
+		}
+	}
+}
+
+void UGravitySurfaceNavSubsystem::OnLevelRemoved(ULevel* level, UWorld* world)
+{
+	if (world != GetWorld())
+	{
+		return;
+	}
+
+	// No level means all of them
+	TArray<TObjectKey<ULevel>> removedLevels;
+	if (level == nullptr)
+	{
+		removedLevels = AddedLevels.Array();
+	}
+	else if (AddedLevels.Contains(level))
+	{
+		removedLevels.Add(level);
+	}
+
+	for (const TObjectKey<ULevel>& removedLevel : removedLevels)
+	{
+		AddedLevels.Remove(removedLevel);
+		FLevelBuild& build = PendingBuilds.AddDefaulted_GetRef();
+		build.Level = removedLevel;
+		build.bRemove = true;
+	}
+}
+
+void UGravitySurfaceNavSubsystem::StartBuild()
+{
+	// Every change since the last build goes into one new graph, in order
+	BuildTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [graph = Graph, builds = MoveTemp(PendingBuilds)]()
+	{
+		// Shares the nodes with the published graph, only the ones these changes touch are copied
+		const double startTime = FPlatformTime::Seconds();
+		FGraphPtr newGraph = MakeShared<FGravitySurfaceNavGraph, ESPMode::ThreadSafe>(*graph);
+		const FGravitySurfaceNavGraph::FBuildSettings settings;
+		for (const FLevelBuild& build : builds)
+		{
+			if (build.bRemove)
+			{
+				newGraph->RemoveLevel(build.Level);
+			}
+			else
+			{
+				newGraph->AddLevel(build.Level, build.Patches, settings);
+			}
+		}
+
+		UE_LOG(LogTemp, Verbose, TEXT("Surface navigation: %d level changes, %d nodes, built in %.1f ms"),
+			builds.Num(), newGraph->GetNumNodes(), (FPlatformTime::Seconds() - startTime) * 1000.0);
+		return newGraph;
+	});
+	PendingBuilds.Reset();
+}
+
+void UGravitySurfaceNavSubsystem::FindPathAsync(const FVector& start, const FVector& goal, const FGravityNavAgent& agent, FOnGravityNavPathFound onFound)
+{
+	FPathQuery& query = PathQueries.AddDefaulted_GetRef();
+	query.OnFound = MoveTemp(onFound);
+	query.Task = UE::Tasks::Launch(UE_SOURCE_LOCATION, [graph = Graph, start, goal, agent]()
+	{
+		FPathResult result;
+		if (graph.IsValid())
+		{
+			result.bFound = graph->FindPath(start, goal, NavMaxSnapDistance, agent, result.Path);
+		}
+		return result;
+	});
+}
+
+int32 UGravitySurfaceNavSubsystem::GetNumNodes() const
+{
+	return Graph.IsValid() ? Graph->GetNumNodes() : 0;
+}
+
+void UGravitySurfaceNavSubsystem::Tick(float DeltaTime)
+{
+	if (BuildTask.IsValid() && BuildTask.IsCompleted())
+	{
+		Graph = BuildTask.GetResult();
+		BuildTask = {};
+	}
+	if (!BuildTask.IsValid() && PendingBuilds.Num() > 0 && Graph.IsValid())
+	{
+		StartBuild();
+	}
+
+	// Callbacks may start new queries, so finished ones are taken out first
+	TArray<FPathQuery> finishedQueries;
+	for (int32 i = PathQueries.Num() - 1; i >= 0; i--)
+	{
+		if (PathQueries[i].Task.IsCompleted())
+		{
+			finishedQueries.Add(MoveTemp(PathQueries[i]));
+			PathQueries.RemoveAtSwap(i);
+		}
+	}
+	for (FPathQuery& query : finishedQueries)
+	{
+		const FPathResult& result = query.Task.GetResult();
+		query.OnFound.ExecuteIfBound(result.bFound, result.Path);
+	}
+}
+
+TStatId UGravitySurfaceNavSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGravitySurfaceNavSubsystem, STATGROUP_Tickables);
+}
+
+bool UGravitySurfaceNavSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
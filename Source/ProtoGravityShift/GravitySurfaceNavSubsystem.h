@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include "GravitySurfaceNavGraph.h"
+#include "GravitySurfaceIndex.h"
+#include "GravitySurfaceNavSubsystem.generated.h"
+
+DECLARE_DELEGATE_TwoParams(FOnGravityNavPathFound, bool /* bFound */, const TArray<FGravityNavPathPoint>& /* path */);
+
+/**
+ * Keeps a navigation graph of the standable static surfaces, floors, walls and ceilings, for AI
+ * gravity shifters. Each level, World Partition cells included, is added to the graph when it
+ * streams in and removed when it streams out, on a worker thread. Paths are searched on
+ * worker threads too, against the graph as it was when the query started.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravitySurfaceNavSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** onFound is called on the game thread once the path is known, a frame later at the earliest */
+	void FindPathAsync(const FVector& start, const FVector& goal, const FGravityNavAgent& agent, FOnGravityNavPathFound onFound);
+
+	/** True while streamed in levels are still being added, paths through them may not be found yet */
+	FORCEINLINE bool IsBuilding() const { return BuildTask.IsValid() || PendingBuilds.Num() > 0; }
+
+	int32 GetNumNodes() const;
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	typedef TSharedPtr<FGravitySurfaceNavGraph, ESPMode::ThreadSafe> FGraphPtr;
+
+	struct FLevelBuild
+	{
+		TObjectKey<ULevel> Level;
+		TArray<FGravitySurfacePatch> Patches;
+		bool bRemove = false;
+	};
+
+	struct FPathResult
+	{
+		bool bFound = false;
+		TArray<FGravityNavPathPoint> Path;
+	};
+
+	struct FPathQuery
+	{
+		UE::Tasks::TTask<FPathResult> Task;
+		FOnGravityNavPathFound OnFound;
+	};
+
+	void OnLevelAdded(ULevel* level, UWorld* world);
+	void OnLevelRemoved(ULevel* level, UWorld* world);
+	void StartBuild();
+
+	/** Read only once published, builds work on a copy that shares its unchanged nodes */
+	FGraphPtr Graph;
+
+	TArray<FLevelBuild> PendingBuilds;
+	UE::Tasks::TTask<FGraphPtr> BuildTask;
+	TSet<TObjectKey<ULevel>> AddedLevels;
+
+	TArray<FPathQuery> PathQueries;
+
+	FDelegateHandle LevelAddedHandle;
+	FDelegateHandle LevelRemovedHandle;
+};
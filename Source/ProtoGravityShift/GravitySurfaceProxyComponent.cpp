@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravitySurfaceProxyComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+
+UGravitySurfaceProxyComponent::UGravitySurfaceProxyComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	// The boxes are already in world space
+	Mobility = EComponentMobility::Static;
+	SetUsingAbsoluteLocation(true);
+	SetUsingAbsoluteRotation(true);
+	SetUsingAbsoluteScale(true);
+
+	SetCollisionProfileName(TEXT("GravitySurfaceProxy"));
+	SetGenerateOverlapEvents(false);
+	SetCanEverAffectNavigation(false);
+	CanCharacterStepUpOn = ECB_No;
+	bHiddenInGame = true;
+}
+
+void UGravitySurfaceProxyComponent::SetBoxes(TArray<FKBoxElem>&& boxes)
+{
+	// Boxes are analytic shapes, nothing needs cooking at runtime
+	ProxyBodySetup = NewObject<UBodySetup>(this, NAME_None, RF_Transient);
+	ProxyBodySetup->CollisionTraceFlag = CTF_UseSimpleAsComplex;
+	ProxyBodySetup->bNeverNeedsCookedCollisionData = true;
+	ProxyBodySetup->AggGeom.BoxElems = MoveTemp(boxes);
+
+	if (IsRegistered())
+	{
+		RecreatePhysicsState();
+		UpdateBounds();
+	}
+}
+
+const TArray<FKBoxElem>& UGravitySurfaceProxyComponent::GetBoxes() const
+{
+	static const TArray<FKBoxElem> noBoxes;
+	return ProxyBodySetup != nullptr ? ProxyBodySetup->AggGeom.BoxElems : noBoxes;
+}
+
+UBodySetup* UGravitySurfaceProxyComponent::GetBodySetup()
+{
+	return ProxyBodySetup;
+}
+
+FBoxSphereBounds UGravitySurfaceProxyComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (ProxyBodySetup == nullptr || ProxyBodySetup->AggGeom.BoxElems.Num() == 0)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0);
+	}
+	return FBoxSphereBounds(ProxyBodySetup->AggGeom.CalcAABB(LocalToWorld));
+}
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+#include "PhysicsEngine/BoxElem.h"
+#include "GravitySurfaceProxyComponent.generated.h"
+
+class UBodySetup;
+
+/**
+ * Simplified collision of a static actor's walls, a set of world space boxes that only block
+ * the GravitySurface trace channel. Added at runtime by UGravitySurfaceProxySubsystem.
+ */
+UCLASS(ClassGroup = (GravityShift))
+class PROTOGRAVITYSHIFT_API UGravitySurfaceProxyComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+	UGravitySurfaceProxyComponent();
+
+	/** Set before the component is registered, the physics body is built from them */
+	void SetBoxes(TArray<FKBoxElem>&& boxes);
+
+	const TArray<FKBoxElem>& GetBoxes() const;
+
+	virtual UBodySetup* GetBodySetup() override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+
+private:
+	UPROPERTY(Transient)
+	UBodySetup* ProxyBodySetup = nullptr;
+};
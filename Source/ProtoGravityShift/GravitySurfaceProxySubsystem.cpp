@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravitySurfaceProxySubsystem.h"
+#include "GravitySurfaceProxyComponent.h"
+#include "GravitySurfaceIndex.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/Level.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static int32 GravitySurfaceChannel = 1;
+static FAutoConsoleVariableRef CVarGravitySurfaceChannel(
+	TEXT("GravityShift.SurfaceChannel"),
+	GravitySurfaceChannel,
+	TEXT("1 probes gravity surfaces against their simplified proxies only, 0 against the full Visibility collision"));
+
+// Faces thinner than this are left out, a probe can hardly land on them
+static constexpr float ProxyMinFaceSize = 5;
+
+// Depth of the box behind each face, enough that no probe starts inside it
+static constexpr float ProxyThickness = 10;
+
+ECollisionChannel UGravitySurfaceProxySubsystem::GetTraceChannel()
+{
+	return GravitySurfaceChannel != 0 ? ECC_GravitySurface : ECC_Visibility;
+}
+
+void UGravitySurfaceProxySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UGravitySurfaceProxySubsystem::OnLevelAdded);
+
+	for (ULevel* level : InWorld.GetLevels())
+	{
+		if (level->bIsVisible)
+		{
+			OnLevelAdded(level, &InWorld);
+		}
+	}
+}
+
+void UGravitySurfaceProxySubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+
+	Super::Deinitialize();
+}
+
+void UGravitySurfaceProxySubsystem::OnLevelAdded(ULevel* level, UWorld* world)
+{
+	if (world != GetWorld() || level == nullptr)
+	{
+		return;
+	}
+
+	const double startTime = FPlatformTime::Seconds();
+	for (AActor* actor : level->Actors)
+	{
+		if (actor != nullptr)
+		{
+			AddProxy(actor);
+		}
+	}
+	UE_LOG(LogTemp, Verbose, TEXT("Gravity surface proxies for %s built in %.2f ms"), *GetNameSafe(level->GetOuter()), (FPlatformTime::Seconds() - startTime) * 1000.0);
+}
+
+void UGravitySurfaceProxySubsystem::AddProxy(AActor* actor)
+{
+	if (actor->FindComponentByClass<UGravitySurfaceProxyComponent>() != nullptr)
+	{
+		return;
+	}
+
+	TArray<FKBoxElem> boxes;
+	TArray<FGravitySurfacePatch> patches;
+	TInlineComponentArray<UStaticMeshComponent*> components(actor);
+	for (const UStaticMeshComponent* component : components)
+	{
+		patches.Reset();
+		if (!AGravitySurfaceIndex::GatherComponentPatches(component, ProxyMinFaceSize, patches))
+		{
+			continue;
+		}
+
+		for (const FGravitySurfacePatch& patch : patches)
+		{
+			// The front of the box is the face itself
+			FKBoxElem& box = boxes.AddDefaulted_GetRef();
+			box.Center = patch.Center - (patch.Normal * (ProxyThickness * 0.5f));
+			box.Rotation = FRotationMatrix::MakeFromXY(patch.AxisU, patch.AxisV).Rotator();
+			box.X = patch.HalfExtents.X * 2;
+			box.Y = patch.HalfExtents.Y * 2;
+			box.Z = ProxyThickness;
+		}
+
+		// Only complex collision, its bounds are the closest simple shape there is
+		const UStaticMesh* mesh = component->GetStaticMesh();
+		if (patches.Num() == 0 && mesh != nullptr)
+		{
+			const FTransform& transform = component->GetComponentTransform();
+			const FBox localBox = mesh->GetBoundingBox();
+			const FVector size = localBox.GetSize() * transform.GetScale3D().GetAbs();
+
+			FKBoxElem& box = boxes.AddDefaulted_GetRef();
+			box.Center = transform.TransformPosition(localBox.GetCenter());
+			box.Rotation = transform.Rotator();
+			box.X = size.X;
+			box.Y = size.Y;
+			box.Z = size.Z;
+		}
+	}
+
+	if (boxes.Num() == 0)
+	{
+		return;
+	}
+
+	UGravitySurfaceProxyComponent* proxy = NewObject<UGravitySurfaceProxyComponent>(actor, NAME_None, RF_Transient);
+	proxy->SetBoxes(MoveTemp(boxes));
+	proxy->RegisterComponent();
+}
+
+bool UGravitySurfaceProxySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
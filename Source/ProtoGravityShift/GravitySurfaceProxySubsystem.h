@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GravitySurfaceProxySubsystem.generated.h"
+
+/** Trace channel of the gravity surface proxies, see DefaultEngine.ini */
+#define ECC_GravitySurface ECC_GameTraceChannel1
+
+/**
+ * Gives the static walls of each level a simplified collision proxy as it streams in: a thin box
+ * behind every face of their simple collision, or their bounding box when they only have complex
+ * collision. The proxies only block the GravitySurface channel, so gravity probes skip props,
+ * characters and triangle meshes entirely.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravitySurfaceProxySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Channel of the wall, aim and landing probes, Visibility when GravityShift.SurfaceChannel is 0 */
+	static ECollisionChannel GetTraceChannel();
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void OnLevelAdded(ULevel* level, UWorld* world);
+
+	/** Proxies are owned by the actor they stand in for, and stream out with it */
+	void AddProxy(AActor* actor);
+
+	FDelegateHandle LevelAddedHandle;
+};
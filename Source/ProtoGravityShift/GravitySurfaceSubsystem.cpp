@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravitySurfaceSubsystem.h"
+#include "GravitySurfaceIndex.h"
+
+void UGravitySurfaceSubsystem::RegisterIndex(AGravitySurfaceIndex* index)
+{
+	if (SurfaceIndex != nullptr && SurfaceIndex != index)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("More than one GravitySurfaceIndex in the map, using %s"), *index->GetName());
+	}
+	SurfaceIndex = index;
+}
+
+void UGravitySurfaceSubsystem::UnregisterIndex(AGravitySurfaceIndex* index)
+{
+	if (SurfaceIndex == index)
+	{
+		SurfaceIndex = nullptr;
+	}
+}
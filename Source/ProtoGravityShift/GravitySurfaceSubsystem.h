@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GravitySurfaceSubsystem.generated.h"
+
+class AGravitySurfaceIndex;
+
+/**
+ * Gives gravity code access to the map's baked surface index, if it has one.
+ */
+UCLASS()
+class PROTOGRAVITYSHIFT_API UGravitySurfaceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterIndex(AGravitySurfaceIndex* index);
+	void UnregisterIndex(AGravitySurfaceIndex* index);
+
+	FORCEINLINE AGravitySurfaceIndex* GetSurfaceIndex() const { return SurfaceIndex; }
+
+private:
+	UPROPERTY()
+	AGravitySurfaceIndex* SurfaceIndex = nullptr;
+};
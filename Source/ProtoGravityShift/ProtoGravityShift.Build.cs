@@ -9,5 +9,7 @@ public class ProtoGravityShift : ModuleRules
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "HeadMountedDisplay", "EnhancedInput" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "MassEntity", "MassCommon", "MassSpawner", "Json", "SignificanceManager", "Chaos", "PhysicsCore", "AnimationCore", "Slate", "SlateCore" });
 	}
 }
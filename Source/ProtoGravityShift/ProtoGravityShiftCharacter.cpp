@@ -10,15 +10,37 @@
 #include "EnhancedInputComponent.h"
 #include "EnhancedInputSubsystems.h"
 #include "Kismet/KismetMathLibrary.h"
-#include "Kismet/KismetSystemLibrary.h"
-#include "Blueprint/UserWidget.h"
-
+#include "Engine/ActorChannel.h"
+#include "Engine/GameInstance.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Net/UnrealNetwork.h"
+#include "GravityShiftStats.h"
+#include "GravitySignificanceSubsystem.h"
+#include "GravityFieldSubsystem.h"
+#include "GravityShiftRecording.h"
+#include "GravityShiftAnimInstance.h"
+#include "GravityMath.h"
+#include "GravityQuerySubsystem.h"
+#include "GravitySurfaceProxySubsystem.h"
+#include "GravityShiftSim.h"
+
+// Frames an aim probe result is still trusted for, the query budget may defer the next one
+static constexpr uint64 AimPointMaxAge = 4;
+
+static_assert((uint8)EShiftState::E_WallGrounded == (uint8)GravityShiftSim::EState::WallGrounded, "EShiftState must match the simulation's states");
 
 //////////////////////////////////////////////////////////////////////////
 // AProtoGravityShiftCharacter
 
-AProtoGravityShiftCharacter::AProtoGravityShiftCharacter()
+AProtoGravityShiftCharacter::AProtoGravityShiftCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UGravityShiftMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
+	// Shift work runs on GravityTick only while levitating, nothing is left for the actor tick.
+	// A Blueprint child with an Event Tick still gets one, the Blueprint compiler turns it back on.
+	PrimaryActorTick.bCanEverTick = false;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
 
@@ -39,10 +61,18 @@ AProtoGravityShiftCharacter::AProtoGravityShiftCharacter()
 	GetCharacterMovement()->MinAnalogWalkSpeed = 20.f;
 	GetCharacterMovement()->BrakingDecelerationWalking = 2000.f;
 
-	CameraOffsetTimeline = CreateDefaultSubobject<UTimelineComponent>(TEXT("CameraOffsetTimeline"));
+	GravityMovement = Cast<UGravityShiftMovementComponent>(GetCharacterMovement());
+
+	CapsuleOrientation = CreateDefaultSubobject<UGravityOrientationComponent>(TEXT("CapsuleOrientation"));
+	CapsuleOrientation->SetUpdatedComponent(GetCapsuleComponent());
+	MeshOrientation = CreateDefaultSubobject<UGravityOrientationComponent>(TEXT("MeshOrientation"));
+	MeshOrientation->SetUpdatedComponent(GetMesh());
+
+	StasisField = CreateDefaultSubobject<UGravityStasisComponent>(TEXT("StasisField"));
+	ShiftStreamingSource = CreateDefaultSubobject<UGravityStreamingSourceComponent>(TEXT("ShiftStreamingSource"));
 
 	// Create a camera boom (pulls in towards the player if there is a collision)
-	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
+	CameraBoom = CreateDefaultSubobject<UGravityCameraBoom>(TEXT("CameraBoom"));
 	CameraBoom->SetupAttachment(RootComponent);
 	CameraBoom->TargetArmLength = 400.0f; // The camera follows at this distance behind the character	
 	CameraBoom->bUsePawnControlRotation = true; // Rotate the arm based on the controller
@@ -69,11 +99,7 @@ void AProtoGravityShiftCharacter::BeginPlay()
 			Subsystem->AddMappingContext(DefaultMappingContext, 0);
 		}
 	}
-	UpdateFunctionSignature.BindDynamic(this, &AProtoGravityShiftCharacter::UpdateCameraOffsetTimeline);
-	if (CameraOffsetTimelineFloatCurve != nullptr)
-	{
-		CameraOffsetTimeline->AddInterpFloat(CameraOffsetTimelineFloatCurve, UpdateFunctionSignature);
-	}
+	CameraBoom->SetOffsets(CameraOffsetDefault, CameraOffsetLevitating, CameraOffsetTimelineFloatCurve);
 
 	MeshStartingPosOffset = GetMesh()->GetRelativeLocation();
 	MeshStartingRotOffset = GetMesh()->GetRelativeRotation();
@@ -81,16 +107,136 @@ void AProtoGravityShiftCharacter::BeginPlay()
 	DefaultAirControl = GetCharacterMovement()->AirControl;
 	DefaultGravityScale = GetCharacterMovement()->GravityScale;
 
-	MarkerWidget = CreateWidget<UGravityMarkerWidget>(this->GetGameInstance(), MarkerWidgetClass);
-	MarkerWidget->AddToViewport();
-	MarkerWidget->SetVisibility(ESlateVisibility::Hidden);
+	GravityMovement->SetShiftParameters(ShiftStartSpeed, ShiftAcceleration, MaxShiftSpeed, WallRaycastLength);
+	GravityMovement->OnShiftSurfaceHit.BindUObject(this, &AProtoGravityShiftCharacter::OnShiftSurfaceHit);
+	GravityMovement->OnWallContactLost.BindUObject(this, &AProtoGravityShiftCharacter::OnWallContactLost);
+
+	AimQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(GravityAimProbe), false, this);
+	AimProbe.Register(GetWorld(), this, AimQueryParams);
+	LandingPredictor.Configure(LandingSegmentLength, AimRaycastLength, LandingSegmentsPerFrame);
+	LandingPredictor.SetShiftParameters(ShiftStartSpeed, ShiftAcceleration, MaxShiftSpeed);
+	ShiftStreamingSource->SetShiftParameters(GravityMovement, ShiftAcceleration, MaxShiftSpeed);
+
+	MarkerSubsystem = GetWorld()->GetSubsystem<UGravityMarkerSubsystem>();
+	if (MarkerSubsystem != nullptr && IsLocallyControlled() && IsPlayerControlled())
+	{
+		MarkerSubsystem->SetStyle(MarkerStyle);
+	}
 
+	GravityTick.Character = this;
+	GravityTick.RegisterTickFunction(GetLevel());
+	GravityTick.SetTickFunctionEnable(ShiftState == EShiftState::E_Levitating);
+	// A shift committed by the gravity tick moves the character in the same frame
+	GetCharacterMovement()->PrimaryComponentTick.AddPrerequisite(this, GravityTick);
+	if (UGravitySignificanceSubsystem* significance = GetWorld()->GetSubsystem<UGravitySignificanceSubsystem>())
+	{
+		significance->RegisterShifter(this);
+	}
+	if (UGravityFieldSubsystem* fields = GetWorld()->GetSubsystem<UGravityFieldSubsystem>())
+	{
+		fields->RegisterSampler(GetCapsuleComponent(), false);
+	}
 }
 
-void AProtoGravityShiftCharacter::Tick(float deltaTime)
+void AProtoGravityShiftCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(deltaTime);
-	//UE_LOG(LogTemp, Log, TEXT("ShiftState: %s"), *UEnum::GetDisplayValueAsText(ShiftState).ToString());
+	if (UGravitySignificanceSubsystem* significance = GetWorld()->GetSubsystem<UGravitySignificanceSubsystem>())
+	{
+		significance->UnregisterShifter(this);
+	}
+	if (UGravityFieldSubsystem* fields = GetWorld()->GetSubsystem<UGravityFieldSubsystem>())
+	{
+		fields->UnregisterSampler(GetCapsuleComponent());
+	}
+	if (MarkerSubsystem != nullptr)
+	{
+		MarkerSubsystem->RemoveMarkers(this);
+	}
+	AimProbe.Unregister();
+	GetCharacterMovement()->PrimaryComponentTick.RemovePrerequisite(this, GravityTick);
+	GravityTick.UnRegisterTickFunction();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void FGravityShiftTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (IsValid(Character))
+	{
+		Character->TickGravityShift(DeltaTime);
+	}
+}
+
+FString FGravityShiftTickFunction::DiagnosticMessage()
+{
+	return FString::Printf(TEXT("%s[GravityShift]"), *GetNameSafe(Character));
+}
+
+void AProtoGravityShiftCharacter::TickGravityShift(float deltaTime)
+{
+	if (bShiftInputBuffered)
+	{
+		TryCommitShiftInput();
+		GravityTick.SetTickFunctionEnable(ShiftState == EShiftState::E_Levitating || bShiftInputBuffered);
+	}
+
+	// Accelerating and wall walking are integrated by the movement component, only the aim is left here
+	if (ShiftState == EShiftState::E_Levitating)
+	{
+		UpdateAimProbe();
+		UpdateLandingPrediction();
+	}
+}
+
+void AProtoGravityShiftCharacter::ApplySignificance(float significance)
+{
+	// Full rate close to a viewer, then 30, 10 and 4 Hz
+	float interval = 0.25f;
+	if (significance >= 0.66f)
+	{
+		interval = 0;
+	}
+	else if (significance >= 0.33f)
+	{
+		interval = 1.0f / 30.0f;
+	}
+	else if (significance > 0)
+	{
+		interval = 0.1f;
+	}
+
+	if (GravityTick.TickInterval != interval)
+	{
+		GravityTick.UpdateTickIntervalAndCoolDown(interval);
+		GravityMovement->SetWallProbeInterval(interval);
+	}
+}
+
+void AProtoGravityShiftCharacter::OnShiftStateChanged(EGravityShiftEvent event)
+{
+	GravityShiftStats::RecordShiftEvent(this, event);
+	RefreshShiftState();
+}
+
+void AProtoGravityShiftCharacter::RefreshShiftState()
+{
+	GravityTick.SetTickFunctionEnable(ShiftState == EShiftState::E_Levitating || bShiftInputBuffered);
+
+	if (ShiftState == EShiftState::E_Accelerating)
+	{
+		ShiftStreamingSource->PredictShift(GravityMovement->GetGravityDirection(), GetPredictedShiftDistance());
+	}
+	else
+	{
+		ShiftStreamingSource->ClearPrediction();
+	}
+
+	// Gravity only changes on transitions, so this is the only place proxies need to hear about it
+	if (HasAuthority())
+	{
+		ShiftNetState.ShiftState = ShiftState;
+		ShiftNetState.GravityDirection = GravityMovement->GetGravityDirection();
+	}
 }
 
 // Input
@@ -110,6 +256,10 @@ void AProtoGravityShiftCharacter::SetupPlayerInputComponent(class UInputComponen
 		//Looking
 		EnhancedInputComponent->BindAction(LookAction, ETriggerEvent::Triggered, this, &AProtoGravityShiftCharacter::Look);
 
+		//Shifting, on press rather than on release
+		EnhancedInputComponent->BindAction(ShiftAction, ETriggerEvent::Started, this, &AProtoGravityShiftCharacter::Shift);
+		EnhancedInputComponent->BindAction(CancelAction, ETriggerEvent::Started, this, &AProtoGravityShiftCharacter::CancelShift);
+
 	}
 
 }
@@ -118,6 +268,7 @@ void AProtoGravityShiftCharacter::Move(const FInputActionValue& Value)
 {
 	// input is a Vector2D
 	FVector2D MovementVector = Value.Get<FVector2D>();
+	RecordedMove = MovementVector;
 
 	if (Controller != nullptr)
 	{
@@ -141,6 +292,7 @@ void AProtoGravityShiftCharacter::Look(const FInputActionValue& Value)
 {
 	// input is a Vector2D
 	FVector2D LookAxisVector = Value.Get<FVector2D>();
+	RecordedLook += LookAxisVector;
 
 	if (Controller != nullptr)
 	{
@@ -150,134 +302,524 @@ void AProtoGravityShiftCharacter::Look(const FInputActionValue& Value)
 	}
 }
 
+void AProtoGravityShiftCharacter::Shift()
+{
+	ShiftInputTime = FPlatformTime::Seconds();
+	ShiftInputFrame = GFrameCounter;
+	bShiftInputBuffered = true;
+
+	if (!TryCommitShiftInput() && bShiftInputBuffered)
+	{
+		GravityTick.SetTickFunctionEnable(true);
+	}
+}
+
+void AProtoGravityShiftCharacter::CancelShift()
+{
+	bShiftInputBuffered = false;
+	const GravityShiftSim::EState state = (GravityShiftSim::EState)ShiftState;
+	if (GravityShiftSim::GetNextState(state, GravityShiftSim::EEvent::CancelPressed) != state)
+	{
+		GoBackToGround();
+		GravityMovement->MarkShiftInput(FPlatformTime::Seconds(), GFrameCounter);
+	}
+}
+
+bool AProtoGravityShiftCharacter::TryCommitShiftInput()
+{
+	const bool bExpired = FPlatformTime::Seconds() - ShiftInputTime > ShiftInputBufferTime;
+
+	const GravityShiftSim::EState state = (GravityShiftSim::EState)ShiftState;
+	const GravityShiftSim::EState nextState = GravityShiftSim::GetNextState(state, GravityShiftSim::EEvent::ShiftPressed);
+	if (nextState == state)
+	{
+		// Pressed while still shifting, levitates off the surface if it is reached in time
+		bShiftInputBuffered = !bExpired;
+		return false;
+	}
+
+	if (nextState == GravityShiftSim::EState::Accelerating)
+	{
+		// The aim is requested as levitation starts, so this only waits when the press came in the same frame
+		ConsumeAimProbe();
+		if (AimPointFrame == 0 && !bExpired)
+		{
+			return false;
+		}
+		// Past the buffer the press still shifts, with a trace of its own
+		bShiftInputBuffered = false;
+		EnterAcceleration();
+	}
+	else
+	{
+		bShiftInputBuffered = false;
+		EnterLevitating();
+	}
+
+	GravityMovement->MarkShiftInput(ShiftInputTime, ShiftInputFrame);
+	return true;
+}
+
 // Gravity Controls
 
 void AProtoGravityShiftCharacter::GoBackToGround()
 {
+	RecordAction(GravityShiftRecording::ActionCancel);
+
+	// Inside a gravity field the ground is wherever the field pulls, so fall towards it
+	FVector fieldGravity;
+	if (GetFieldGravity(fieldGravity) && !fieldGravity.GetSafeNormal().Equals(FVector::DownVector, 0.01f))
+	{
+		ResetMeshRotation(BackToGroundTransitionDuration);
+		EnterAccelerationTowards(fieldGravity);
+		return;
+	}
+
 	GetCharacterMovement()->GravityScale = DefaultGravityScale;
 	GetCharacterMovement()->AirControl = DefaultAirControl;
-	GetCharacterMovement()->SetMovementMode(EMovementMode::MOVE_Falling);
 	GetCharacterMovement()->bOrientRotationToMovement = true;
-	CameraOffsetTimeline->Reverse();
-	MarkerWidget->SetVisibility(ESlateVisibility::Hidden);
+	GravityMovement->ExitGravityShift();
+	CameraBoom->SetLevitating(false);
+	CameraBoom->SetGravityUp(FVector::UpVector, BackToGroundTransitionDuration);
+	HideMarkers();
 
-	ResetMeshRotation();
+	ResetMeshRotation(BackToGroundTransitionDuration);
 
 	ShiftState = EShiftState::E_NoShift;
+	OnShiftStateChanged(EGravityShiftEvent::BackToGround);
+}
+
+bool AProtoGravityShiftCharacter::GetFieldGravity(FVector& outGravity) const
+{
+	const UGravityFieldSubsystem* fields = GetWorld()->GetSubsystem<UGravityFieldSubsystem>();
+	return fields != nullptr && fields->GetSampledGravity(GetCapsuleComponent(), outGravity);
+}
+
+void AProtoGravityShiftCharacter::HideMarkers()
+{
+	if (MarkerSubsystem != nullptr)
+	{
+		MarkerSubsystem->SetAimMarker(this, false);
+		MarkerSubsystem->SetLandingMarker(this, false);
+	}
+}
+
+void AProtoGravityShiftCharacter::RecordAction(uint8 action)
+{
+	if (IsLocallyControlled() && IsPlayerControlled())
+	{
+		RecordedActions |= action;
+	}
+}
+
+void AProtoGravityShiftCharacter::PlayInput(const FVector2D& move, uint8 actions, const FVector& shiftDirection)
+{
+	if ((actions & GravityShiftRecording::ActionCancel) != 0)
+	{
+		GoBackToGround();
+	}
+	if ((actions & GravityShiftRecording::ActionShift) != 0)
+	{
+		const GravityShiftSim::EState state = (GravityShiftSim::EState)ShiftState;
+		const GravityShiftSim::EState nextState = GravityShiftSim::GetNextState(state, GravityShiftSim::EEvent::ShiftPressed);
+		if (nextState == GravityShiftSim::EState::Levitating)
+		{
+			EnterLevitating();
+		}
+		else if (nextState != state)
+		{
+			EnterAccelerationTowards(shiftDirection);
+		}
+	}
+
+	if (move.IsZero())
+	{
+		return;
+	}
+	if (ShiftState == EShiftState::E_WallGrounded)
+	{
+		MoveOnWall(move, WallForward, WallRight, WallNormal, MeshWallRotator);
+	}
+	else
+	{
+		Move(FInputActionValue(move));
+	}
 }
 
-void AProtoGravityShiftCharacter::ResetMeshRotation()
+void AProtoGravityShiftCharacter::ConsumeRecordedInput(FVector2D& outMove, FVector2D& outLook, uint8& outActions)
 {
-	FLatentActionInfo MeshLatentInfo;
-	MeshLatentInfo.CallbackTarget = this;
-	UKismetSystemLibrary::MoveComponentTo(GetMesh(), MeshStartingPosOffset, MeshStartingRotOffset
-		, false, false, BackToGroundTransitionDuration, true, EMoveComponentAction::Move, MeshLatentInfo);
+	outMove = RecordedMove;
+	outLook = RecordedLook;
+	outActions = RecordedActions;
+	RecordedMove = FVector2D::ZeroVector;
+	RecordedLook = FVector2D::ZeroVector;
+	RecordedActions = 0;
+}
+
+void AProtoGravityShiftCharacter::ResetMeshRotation(float duration)
+{
+	if (UGravityShiftAnimInstance* animInstance = GetGravityAnimInstance())
+	{
+		animInstance->SetWallFacing(0);
+	}
+	MeshOrientation->MoveTo(MeshStartingPosOffset, MeshStartingRotOffset.Quaternion(), duration);
 }
 
 void AProtoGravityShiftCharacter::EnterLevitating()
 {
-	GetCharacterMovement()->Velocity = FVector::ZeroVector;
+	RecordAction(GravityShiftRecording::ActionShift);
+
 	GetCharacterMovement()->AirControl = 0;
-	GetCharacterMovement()->SetMovementMode(EMovementMode::MOVE_Falling);
 	GetCharacterMovement()->GravityScale = 0;
 	GetCharacterMovement()->bOrientRotationToMovement = false;
+	GravityMovement->EnterLevitate();
+
+	CameraBoom->SetLevitating(true);
 
-	CameraOffsetTimeline->Play();
-	MarkerWidget->SetVisibility(ESlateVisibility::Visible);
+	ResetMeshRotation(BackToGroundTransitionDuration);
 
+	LandingPredictor.Reset();
+	LandingSolutionSerial = 0;
 
-	ResetMeshRotation();
+	ShiftState = EShiftState::E_Levitating;
+	OnShiftStateChanged(EGravityShiftEvent::EnterLevitate);
+
+	// Resolved by the end of this frame, so a shift pressed on the next one doesn't have to trace
+	AimProbe.Reset();
+	AimPointFrame = 0;
+	UpdateAimProbe();
 }
 
 void AProtoGravityShiftCharacter::EnterAcceleration()
 {
-	MarkerWidget->SetVisibility(ESlateVisibility::Hidden);
-	CameraOffsetTimeline->Reverse();
+	RecordAction(GravityShiftRecording::ActionShift);
+	EnterAccelerationTowards(CalculateGravityDirection());
+}
+
+void AProtoGravityShiftCharacter::LaunchStasisField()
+{
+	StasisField->Launch(CalculateGravityDirection());
+}
+
+void AProtoGravityShiftCharacter::EnterAccelerationTowards(const FVector& direction)
+{
+	HideMarkers();
+	CameraBoom->SetLevitating(false);
 	GetCharacterMovement()->AirControl = DefaultAirControl;
 	GetCharacterMovement()->GravityScale = 0;
-	GravityDirection = CalculateGravityDirection();
-	CurrentShiftAcceleration = ShiftStartSpeed;
+	GravityDirection = direction.GetSafeNormal();
+	GravityMovement->EnterShiftFall(GravityDirection);
+
+	ShiftState = EShiftState::E_Accelerating;
+	OnShiftStateChanged(EGravityShiftEvent::EnterAcceleration);
 }
 
-FVector AProtoGravityShiftCharacter::CalculateGravityDirection()
+void AProtoGravityShiftCharacter::RestoreShiftState(EShiftState state, const FVector& gravityDirection)
 {
-	FVector endPoint = FollowCamera->GetComponentLocation() + (FollowCamera->GetForwardVector() * 9000);
-	FVector startPoint = FollowCamera->GetComponentLocation();
+	// Corrections and replicated state land here, so nothing is recorded, announced or blended: the transition already happened
+	UCharacterMovementComponent* movement = GetCharacterMovement();
+	bShiftInputBuffered = false;
+	HideMarkers();
 
-	// Ignore any specific actors
-	TArray<AActor*> ignoreActors;
-	// Ignore self or remove this line to not ignore any
-	ignoreActors.Init(this, 1);
+	switch (state)
+	{
+	case EShiftState::E_NoShift:
+		movement->GravityScale = DefaultGravityScale;
+		movement->AirControl = DefaultAirControl;
+		movement->bOrientRotationToMovement = true;
+		GravityMovement->ExitGravityShift();
+		ResetMeshRotation(0);
+		break;
+	case EShiftState::E_Levitating:
+		movement->GravityScale = 0;
+		movement->AirControl = 0;
+		movement->bOrientRotationToMovement = false;
+		GravityMovement->EnterLevitate();
+		ResetMeshRotation(0);
+		LandingPredictor.Reset();
+		LandingSolutionSerial = 0;
+		break;
+	case EShiftState::E_Accelerating:
+		movement->GravityScale = 0;
+		movement->AirControl = DefaultAirControl;
+		GravityDirection = gravityDirection.GetSafeNormal();
+		GravityMovement->EnterShiftFall(GravityDirection);
+		break;
+	case EShiftState::E_WallGrounded:
+	{
+		// Rebuild the contact AdjustToWall expects from the capsule resting against the surface
+		FHitResult hitInfo;
+		hitInfo.Normal = hitInfo.ImpactNormal = -gravityDirection;
+		hitInfo.ImpactPoint = hitInfo.Location = GetActorLocation() + (gravityDirection * GetCapsuleComponent()->GetScaledCapsuleRadius());
+		ApplyWallContact(hitInfo, 0, 0);
+		break;
+	}
+	default:
+		break;
+	}
 
-	FHitResult hitResult;
-	bool didHit = UKismetSystemLibrary::LineTraceSingle(GetWorld(), startPoint, endPoint, ETraceTypeQuery::TraceTypeQuery1, false, ignoreActors, EDrawDebugTrace::None, hitResult, true);
-	if (didHit)
+	// Only the player's own view follows the corrected state, without a blend
+	if (IsLocallyControlled())
 	{
-		endPoint = hitResult.Location;
+		if ((state == EShiftState::E_Levitating) != (ShiftState == EShiftState::E_Levitating))
+		{
+			CameraBoom->SetLevitating(state == EShiftState::E_Levitating);
+		}
+		if (state == EShiftState::E_WallGrounded || state == EShiftState::E_NoShift)
+		{
+			CameraBoom->SetGravityUp(state == EShiftState::E_WallGrounded ? -gravityDirection : FVector::UpVector, 0);
+		}
 	}
 
-	FVector result = endPoint - GetActorLocation();
-	return result.GetSafeNormal();
+	ShiftState = state;
+	RefreshShiftState();
 }
 
-// Tick functions
+void AProtoGravityShiftCharacter::ApplyShiftRequest(EShiftState requestedState, const FVector& gravityDirection)
+{
+	if (requestedState == ShiftState)
+	{
+		return;
+	}
 
-void AProtoGravityShiftCharacter::ShiftAccelerating(float deltaTime)
+	switch (requestedState)
+	{
+	case EShiftState::E_NoShift:
+		GoBackToGround();
+		break;
+	case EShiftState::E_Levitating:
+		EnterLevitating();
+		break;
+	case EShiftState::E_Accelerating:
+		// Losing a wall is detected by the server, only a shift out of levitation comes from input
+		if (ShiftState == EShiftState::E_Levitating)
+		{
+			EnterAccelerationTowards(gravityDirection);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void AProtoGravityShiftCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	CurrentShiftAcceleration += deltaTime * ShiftAcceleration;
-	CurrentShiftAcceleration = UKismetMathLibrary::Min(CurrentShiftAcceleration, MaxShiftSpeed);
-	GetCharacterMovement()->Velocity = GravityDirection.GetSafeNormal() * CurrentShiftAcceleration;
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	ShiftState = EShiftState::E_Accelerating;
+	// The owner predicts its own shift through the movement component
+	DOREPLIFETIME_CONDITION(AProtoGravityShiftCharacter, ShiftNetState, COND_SimulatedOnly);
 }
 
-void AProtoGravityShiftCharacter::ApplyWallGravity(float deltaTime)
+void AProtoGravityShiftCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
 {
-	// Ignore any specific actors
-	TArray<AActor*> ignoreActors;
-	// Ignore self or remove this line to not ignore any
-	ignoreActors.Init(this, 1);
+	Super::PreReplication(ChangedPropertyTracker);
 
-	float capsuleHeight = GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+	const UNetDriver* netDriver = GetNetDriver();
+	if (netDriver == nullptr || !netDriver->IsServer())
+	{
+		return;
+	}
 
-	FVector startTopPoint = GetActorLocation() + (FVector::UpVector * capsuleHeight);
-	FVector endTopPoint = startTopPoint + (GravityDirection * WallRaycastLength);
+	// A connection gets the state when its channel opens and whenever it changed since that connection last got it
+	const uint32 packedState = (uint32)ShiftNetState.ShiftState | (GravityShiftNet::EncodeUnitVector(ShiftNetState.GravityDirection) << GravityShiftNet::ShiftStateBits);
+	const UNetConnection* ownerConnection = GetNetConnection();
+	for (UNetConnection* connection : netDriver->ClientConnections)
+	{
+		if (connection == nullptr || connection == ownerConnection || connection->FindActorChannelRef(this) == nullptr)
+		{
+			SentNetStates.Remove(connection);
+			continue;
+		}
 
+		uint32& sentState = SentNetStates.FindOrAdd(connection, ~0u);
+		if (sentState != packedState)
+		{
+			sentState = packedState;
+			if (SentNetStateBits == 0)
+			{
+				SentNetStateStartTime = FPlatformTime::Seconds();
+			}
+			SentNetStateBits += GravityShiftNet::PayloadBits;
+		}
+	}
+
+	for (auto it = SentNetStates.CreateIterator(); it; ++it)
+	{
+		if (!it.Key().IsValid())
+		{
+			it.RemoveCurrent();
+		}
+	}
+}
+
+uint64 AProtoGravityShiftCharacter::TakeReplicatedStateBits(double& outSeconds, int32& outConnections)
+{
+	const uint64 bits = SentNetStateBits;
+	outSeconds = bits > 0 ? FPlatformTime::Seconds() - SentNetStateStartTime : 0;
+	outConnections = SentNetStates.Num();
+	SentNetStateBits = 0;
+	return bits;
+}
+
+void AProtoGravityShiftCharacter::OnRep_ShiftNetState()
+{
+	// Quantized on the wire, so compare loosely
+	if (ShiftNetState.ShiftState != ShiftState || !ShiftNetState.GravityDirection.Equals(GravityDirection, 0.01f))
+	{
+		RestoreShiftState(ShiftNetState.ShiftState, ShiftNetState.GravityDirection);
+	}
+}
+
+FVector AProtoGravityShiftCharacter::CalculateGravityDirection()
+{
+	GRAVITY_SHIFT_STAT_SCOPE(CalculateGravityDirection);
+
+	ConsumeAimProbe();
+
+	FVector endPoint;
+	if (AimPointFrame > 0 && GFrameCounter - AimPointFrame <= AimPointMaxAge)
+	{
+		// Already resolved by the aim probe, possibly a few frames ago when the query budget was tight
+		endPoint = AimPoint;
+	}
+	else
+	{
+		FVector startPoint = FollowCamera->GetComponentLocation();
+		endPoint = startPoint + (FollowCamera->GetForwardVector() * AimRaycastLength);
+
+		// Can't wait for the schedule, but still counts against the frame's budget
+		const ECollisionChannel channel = UGravitySurfaceProxySubsystem::GetTraceChannel();
+		FHitResult hitResult;
+		bool didHit = false;
+		if (UGravityQuerySubsystem* queries = GetWorld()->GetSubsystem<UGravityQuerySubsystem>())
+		{
+			didHit = queries->LineTraceNow(hitResult, startPoint, endPoint, channel, AimQueryParams);
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_GravityShift_Traces);
+			didHit = GetWorld()->LineTraceSingleByChannel(hitResult, startPoint, endPoint, channel, AimQueryParams);
+		}
+		if (didHit)
+		{
+			endPoint = hitResult.Location;
+		}
+	}
+
+	FVector result = endPoint - GetActorLocation();
+	return result.GetSafeNormal();
+}
+
+float AProtoGravityShiftCharacter::GetPredictedShiftDistance() const
+{
+	// Only trust the landing if it was predicted for this direction
+	if (LandingPredictor.HasPrediction())
+	{
+		const FGravityLandingPrediction& prediction = LandingPredictor.GetPrediction();
+		const FVector toLanding = prediction.Location - GetActorLocation();
+		if (prediction.bHit && FVector::DotProduct(toLanding.GetSafeNormal(), GravityMovement->GetGravityDirection()) > 0.99f)
+		{
+			return toLanding.Size();
+		}
+	}
+	return WORLD_MAX;
+}
+
+void AProtoGravityShiftCharacter::ConsumeAimProbe()
+{
+	bool didHit = false;
 	FHitResult hitResult;
-	bool didTopHit = UKismetSystemLibrary::LineTraceSingle(GetWorld(), startTopPoint, endTopPoint, ETraceTypeQuery::TraceTypeQuery1
-																	, false, ignoreActors, EDrawDebugTrace::None, hitResult, true,
-																	FLinearColor::Red, FLinearColor::Green,5.0f);
+	if (AimProbe.Consume(didHit, hitResult))
+	{
+		AimPoint = didHit ? hitResult.Location : AimProbeEnd;
+		AimPointFrame = GFrameCounter;
+	}
+}
+
+void AProtoGravityShiftCharacter::UpdateAimProbe()
+{
+	GRAVITY_SHIFT_STAT_SCOPE(UpdateAimProbe);
+
+	ConsumeAimProbe();
 
-	FVector startBottomPoint = GetActorLocation() - (FVector::UpVector * capsuleHeight);
-	FVector endBottomPoint = startBottomPoint + (GravityDirection * WallRaycastLength);
-	bool didBottomHit = UKismetSystemLibrary::LineTraceSingle(GetWorld(), startBottomPoint, endBottomPoint, ETraceTypeQuery::TraceTypeQuery1
-																	, false, ignoreActors, EDrawDebugTrace::None, hitResult, true,
-																	FLinearColor::Red, FLinearColor::Green, 5.0f);
+	FVector startPoint = FollowCamera->GetComponentLocation();
+	AimProbeEnd = startPoint + (FollowCamera->GetForwardVector() * AimRaycastLength);
+	AimProbe.RequestLine(startPoint, AimProbeEnd, UGravitySurfaceProxySubsystem::GetTraceChannel());
+}
 
-	if (didTopHit || didBottomHit)
+void AProtoGravityShiftCharacter::UpdateLandingPrediction()
+{
+	GRAVITY_SHIFT_STAT_SCOPE(UpdateLandingPrediction);
+
+	// Only players see their own markers, everybody else's shifts are telegraphed if they want to be
+	const bool bPlayerMarkers = IsLocallyControlled() && IsPlayerControlled();
+	if (MarkerSubsystem == nullptr || !MarkerSubsystem->IsDrawing() || (!bPlayerMarkers && !bTelegraphShifts))
 	{
-		CurrentShiftAcceleration = ShiftStartSpeed;
+		return;
 	}
-	else {
-		ShiftAccelerating(deltaTime);
+	if (bPlayerMarkers)
+	{
+		MarkerSubsystem->SetAimMarker(this, AimPointFrame != 0, AimPoint);
+	}
+
+	const UCapsuleComponent* capsule = GetCapsuleComponent();
+	LandingPredictor.Update(GetWorld(), GetActorLocation(), CalculateGravityDirection(), capsule->GetComponentQuat(), capsule->GetCollisionShape(), AimQueryParams);
+
+	if (LandingPredictor.GetSolutionSerial() != LandingSolutionSerial)
+	{
+		LandingSolutionSerial = LandingPredictor.GetSolutionSerial();
+		const FGravityLandingPrediction& prediction = LandingPredictor.GetPrediction();
+		MarkerSubsystem->SetLandingMarker(this, prediction.bHit, prediction.ImpactPoint, prediction.ImpactNormal, prediction.TimeToLand);
 	}
 }
 
+// Tick functions
+
+void AProtoGravityShiftCharacter::ShiftAccelerating(float deltaTime)
+{
+	// Integrated by UGravityShiftMovementComponent::PhysShiftFall, kept so existing Blueprint graphs still load
+}
+
+void AProtoGravityShiftCharacter::ApplyWallGravity(float deltaTime)
+{
+	// Probed by UGravityShiftMovementComponent::PhysWallWalk, kept so existing Blueprint graphs still load
+}
+
+void AProtoGravityShiftCharacter::OnShiftSurfaceHit(const FHitResult& hitInfo)
+{
+	AdjustToWall(hitInfo);
+}
+
+void AProtoGravityShiftCharacter::OnWallContactLost()
+{
+	ShiftState = EShiftState::E_Accelerating;
+	OnShiftStateChanged(EGravityShiftEvent::WallContactLost);
+}
+
 void AProtoGravityShiftCharacter::AdjustToWall(FHitResult hitInfo)
 {
-	GetCharacterMovement()->SetMovementMode(EMovementMode::MOVE_Flying);
-	GetCharacterMovement()->StopMovementImmediately();
-	GetCharacterMovement()->bOrientRotationToMovement = false;
+	GRAVITY_SHIFT_SCOPE(AdjustToWall);
+
+	// The movement component and a Blueprint hit event can both report the same contact
+	if (ShiftState == EShiftState::E_WallGrounded && WallNormal.Equals(hitInfo.Normal))
+	{
+		return;
+	}
 
-	FVector lookDir = FVector(hitInfo.Normal.X, hitInfo.Normal.Y, 0).GetSafeNormal();
-	lookDir *= -500;
+	ApplyWallContact(hitInfo, WallCapsuleTransitionDuration, WallMeshTransitionDuration);
+	CameraBoom->SetGravityUp(hitInfo.Normal, WallCapsuleTransitionDuration);
 
-	FVector capsulePos = GetCapsuleComponent()->GetComponentLocation();
-	FVector endPoint = capsulePos + lookDir;
-	FRotator lookRotator = UKismetMathLibrary::FindLookAtRotation(capsulePos, endPoint);
+	ShiftState = EShiftState::E_WallGrounded;
+	OnShiftStateChanged(EGravityShiftEvent::WallContact);
+}
+
+void AProtoGravityShiftCharacter::ApplyWallContact(const FHitResult& hitInfo, float capsuleDuration, float meshDuration)
+{
+	GravityMovement->EnterWallWalk(hitInfo.Normal);
+	GetCharacterMovement()->bOrientRotationToMovement = false;
 
-	FLatentActionInfo CapsuleLatentInfo;
-	CapsuleLatentInfo.CallbackTarget = this;
+	// The capsule faces into the wall, level
+	const FQuat lookRotation = GravityMath::MakeHeadingRotation(-hitInfo.Normal);
 
 	/*************************************************************************************/
 
@@ -292,47 +834,29 @@ void AProtoGravityShiftCharacter::AdjustToWall(FHitResult hitInfo)
 		location -= (FVector::UpVector * capsuleHeight);
 	}
 
-	if (WallCapsuleTransitionDuration > 0)
-	{
-		UKismetSystemLibrary::MoveComponentTo(GetCapsuleComponent(), location, lookRotator,
-			false, false, WallCapsuleTransitionDuration, true, EMoveComponentAction::Type::Move, CapsuleLatentInfo);
-	}
-	else {
-		GetCapsuleComponent()->SetWorldLocation(location);
-		GetCapsuleComponent()->SetWorldRotation(lookRotator);
-	}
+	CapsuleOrientation->MoveTo(location, lookRotation, capsuleDuration);
 	/*************************************************************************************/
 
-	FVector capsuleRight = UKismetMathLibrary::GetRightVector(lookRotator);
-
+	FVector capsuleRight = lookRotation.GetAxisY();
 
-	FTransform transform = UKismetMathLibrary::MakeTransform(hitInfo.ImpactPoint, lookRotator);
-	MeshWallRotator = UKismetMathLibrary::MakeRotFromZX(hitInfo.Normal, capsuleRight * -1);
-
-	FLatentActionInfo MeshLatentInfo;
-	MeshLatentInfo.CallbackTarget = this;
+	const FQuat meshWallRotation = GravityMath::MakeSurfaceBasis(hitInfo.Normal, capsuleRight * -1);
+	MeshWallRotator = meshWallRotation.Rotator();
 
 	/*************************************************************************************/
 	FVector meshPosOffset = UKismetMathLibrary::InverseTransformLocation(GetRootComponent()->GetRelativeTransform(), hitInfo.ImpactPoint);
-	FRotator meshRot = UKismetMathLibrary::InverseTransformRotation(transform, MeshWallRotator);
-	if (WallMeshTransitionDuration > 0)
+	const FQuat meshRot = GravityMath::MakeRelativeRotation(lookRotation, meshWallRotation);
+	MeshOrientation->MoveTo(meshPosOffset, meshRot, meshDuration);
+	if (UGravityShiftAnimInstance* animInstance = GetGravityAnimInstance())
 	{
-		UKismetSystemLibrary::MoveComponentTo(GetMesh(), meshPosOffset, meshRot
-			, false, false, WallMeshTransitionDuration, true, EMoveComponentAction::Type::Move, MeshLatentInfo);
-	}
-	else {
-		GetMesh()->SetRelativeLocation(meshPosOffset);
-		GetMesh()->SetRelativeRotation(meshRot);
+		animInstance->SetWallFacing(0);
 	}
 	/*************************************************************************************/
 
 	WallNormal = hitInfo.Normal;
 	WallRight = capsuleRight;
-	WallForward = UKismetMathLibrary::GetRightVector(MeshWallRotator);
+	WallForward = meshWallRotation.GetAxisY();
 
 	GravityDirection = -hitInfo.Normal;
-
-	ShiftState = EShiftState::E_WallGrounded;
 }
 
 // Move on wall functions
@@ -347,36 +871,48 @@ void AProtoGravityShiftCharacter::MoveOnWall(FVector2D inputVector, FVector forw
 
 void AProtoGravityShiftCharacter::OrientMeshToWall(FVector2D inputVector, FVector forward, FVector right, FVector normal, FRotator wallRotator)
 {
-	FVector inputDirection = (right * inputVector.X) + (forward * inputVector.Y);
-	inputDirection.Normalize();
+	GRAVITY_SHIFT_SCOPE(OrientMeshToWall);
 
-	double rad = FMath::Acos(forward.GetSafeNormal().Dot(inputDirection.GetSafeNormal()));
-	double angle = FMath::RadiansToDegrees(rad);
+	// forward and right are the wall basis, so the input's angle from forward is its own heading
+	const double angle = GravityMath::InputHeading(inputVector);
 
-	if (FMath::Abs(inputVector.X) > 0)
+	// Turned on the animation threads from the wall rotation the mesh already has
+	if (UGravityShiftAnimInstance* animInstance = GetGravityAnimInstance())
 	{
-		angle *= FMath::Sign(inputVector.X);
+		animInstance->SetWallFacing(angle);
+		return;
 	}
 
-	FVector forwardVector = UKismetMathLibrary::GetForwardVector(wallRotator);
-	FVector adjustedWallRotation = UKismetMathLibrary::RotateAngleAxis(forwardVector, angle, normal);
+	const FQuat finalRotation = GravityMath::RotateAboutAxis(wallRotator.Quaternion(), normal, angle);
 
-	FRotator finalRotation = UKismetMathLibrary::MakeRotFromZX(normal, adjustedWallRotation);
-
-	FLatentActionInfo MeshLatentInfo;
-	MeshLatentInfo.CallbackTarget = this;
-
-	FRotator relativeRotation = UKismetMathLibrary::InverseTransformRotation(GetRootComponent()->GetRelativeTransform(), finalRotation);
-	UKismetSystemLibrary::MoveComponentTo(GetMesh(), GetMesh()->GetRelativeLocation(), relativeRotation,
-		false, false, 0.1f, true, EMoveComponentAction::Type::Move, MeshLatentInfo);
+	const FQuat relativeRotation = GravityMath::MakeRelativeRotation(GetRootComponent()->GetRelativeTransform().GetRotation(), finalRotation);
+	MeshOrientation->RotateTo(relativeRotation, 0.1f);
 	/*************************************************************************************/
 
 }
 
-void AProtoGravityShiftCharacter::UpdateCameraOffsetTimeline(float output)
+FGravityNavAgent AProtoGravityShiftCharacter::GetSurfaceNavAgent() const
+{
+	FGravityNavAgent agent;
+	agent.WalkSpeed = GetCharacterMovement()->MaxWalkSpeed;
+	agent.ShiftStartSpeed = ShiftStartSpeed;
+	agent.ShiftAcceleration = ShiftAcceleration;
+	agent.MaxShiftSpeed = MaxShiftSpeed;
+	return agent;
+}
+
+bool AProtoGravityShiftCharacter::FindSurfacePath(const FVector& goal, FOnGravityNavPathFound onFound) const
 {
-	if (CameraBoom != nullptr)
+	UGravitySurfaceNavSubsystem* navigation = GetWorld()->GetSubsystem<UGravitySurfaceNavSubsystem>();
+	if (navigation == nullptr)
 	{
-		CameraBoom->SocketOffset = UKismetMathLibrary::VLerp(CameraOffsetDefault, CameraOffsetLevitating, output);
+		return false;
 	}
+	navigation->FindPathAsync(GetActorLocation(), goal, GetSurfaceNavAgent(), MoveTemp(onFound));
+	return true;
+}
+
+UGravityShiftAnimInstance* AProtoGravityShiftCharacter::GetGravityAnimInstance() const
+{
+	return Cast<UGravityShiftAnimInstance>(GetMesh()->GetAnimInstance());
 }
@@ -6,9 +6,18 @@
 #include "GameFramework/Character.h"
 #include "InputActionValue.h"
 #include "GravityMarkerWidget.h"
-#include <Components/TimelineComponent.h>
+#include "GravityMarkerSubsystem.h"
+#include "GravityShiftMovementComponent.h"
+#include "GravityOrientationComponent.h"
+#include "GravityLandingPredictor.h"
+#include "GravityCameraBoom.h"
+#include "GravityStasisComponent.h"
+#include "GravityStreamingSourceComponent.h"
+#include "GravitySurfaceNavSubsystem.h"
 #include "ProtoGravityShiftCharacter.generated.h"
 
+enum class EGravityShiftEvent : uint8;
+
 UENUM(BlueprintType)
 enum class EShiftState : uint8
 {
@@ -18,6 +27,56 @@ enum class EShiftState : uint8
 	E_WallGrounded		UMETA(DisplayName = "WallGrounded"),
 };
 
+/** Shift state replicated to simulated proxies, packed into 24 bits by NetSerialize */
+USTRUCT()
+struct FGravityShiftNetState
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	EShiftState ShiftState = EShiftState::E_NoShift;
+	UPROPERTY()
+	FVector GravityDirection = FVector::DownVector;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FGravityShiftNetState& other) const
+	{
+		return ShiftState == other.ShiftState && GravityDirection.Equals(other.GravityDirection);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FGravityShiftNetState> : public TStructOpsTypeTraitsBase2<FGravityShiftNetState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
+/** Native gravity update, only registered as enabled while the character is shifting */
+USTRUCT()
+struct FGravityShiftTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	class AProtoGravityShiftCharacter* Character = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FGravityShiftTickFunction> : public TStructOpsTypeTraitsBase2<FGravityShiftTickFunction>
+{
+	enum
+	{
+		WithCopy = false,
+	};
+};
+
 UCLASS(config=Game)
 class AProtoGravityShiftCharacter : public ACharacter
 {
@@ -30,11 +89,31 @@ public:
 private:
 	/** Camera boom positioning the camera behind the character */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
-	class USpringArmComponent* CameraBoom;
+	UGravityCameraBoom* CameraBoom;
 
 	/** Follow camera */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UCameraComponent* FollowCamera;
+
+	/** Character movement, cast once to the gravity shift movement component */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
+	UGravityShiftMovementComponent* GravityMovement;
+
+	/** Blends the capsule onto walls */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
+	UGravityOrientationComponent* CapsuleOrientation;
+
+	/** Blends the mesh between its wall and ground orientations */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
+	UGravityOrientationComponent* MeshOrientation;
+
+	/** Lifts the props around the character and flings them along the aim */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
+	UGravityStasisComponent* StasisField;
+
+	/** Streams the World Partition cells along a shift in ahead of the character */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
+	UGravityStreamingSourceComponent* ShiftStreamingSource;
 	
 	/** MappingContext */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
@@ -52,6 +131,18 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
 	class UInputAction* LookAction;
 
+	/** Shift Input Action, levitates and then shifts towards the marker */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
+	class UInputAction* ShiftAction;
+
+	/** Cancel Input Action, returns gravity to normal */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
+	class UInputAction* CancelAction;
+
+	/** Seconds a shift pressed during a transition, e.g. just before landing, waits for it to finish */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Input, meta = (AllowPrivateAccess = "true"))
+	float ShiftInputBufferTime = 0.2f;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
 	float WallCapsuleTransitionDuration = 0.2f;
 
@@ -63,6 +154,9 @@ private:
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
 	float WallRaycastLength = 200;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
+	float AimRaycastLength = 9000;
 	/******************************************************************************************/
 	UPROPERTY(BlueprintReadWrite, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
 	FRotator MeshWallRotator;
@@ -86,10 +180,28 @@ private:
 	FVector GravityDirection;
 	/******************************************************************************************/
 
+	/** No longer created, the markers are drawn by UGravityMarkerSubsystem. Kept so existing Blueprints still load */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = GravityShift, meta = (AllowPrivateAccess = "true"))
 	TSubclassOf<UGravityMarkerWidget> MarkerWidgetClass;
 
-	UUserWidget* MarkerWidget;
+	/** Brushes of the aim and landing markers, taken from the player's character */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	FGravityMarkerStyle MarkerStyle;
+
+	/** Show local players where this character's shift will land when it isn't theirs, e.g. for AI */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	bool bTelegraphShifts = true;
+
+	UPROPERTY()
+	UGravityMarkerSubsystem* MarkerSubsystem = nullptr;
+
+	/** Length of each capsule sweep of the landing prediction */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float LandingSegmentLength = 1500;
+
+	/** Landing prediction sweeps requested per frame, a long shift is resolved over several frames */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	int32 LandingSegmentsPerFrame = 2;
 
 	UPROPERTY(EditAnywhere, Category = GravityShift)
 	UCurveFloat* CameraOffsetTimelineFloatCurve;
@@ -106,26 +218,106 @@ private:
 	float MaxShiftSpeed = 10000;
 
 
-protected:
+private:
+	float CurrentLerpTime;
 
-	//TimelineComponent to animate Door meshes
-	UPROPERTY(VisibleAnywhere, BlueprintReadWrite)
-	UTimelineComponent* CameraOffsetTimeline;
+	/** Camera aim, requested every frame while levitating and run within the frame's query budget */
+	FGravityScheduledProbe AimProbe;
+	FCollisionQueryParams AimQueryParams;
+	FVector AimProbeEnd;
+	FVector AimPoint;
+	uint64 AimPointFrame = 0;
 
-	FOnTimelineFloat UpdateFunctionSignature;
+	/** Shift press waiting for a transition to finish, committed by GravityTick */
+	bool bShiftInputBuffered = false;
+	double ShiftInputTime = 0;
+	uint64 ShiftInputFrame = 0;
 
-private:
-	float CurrentShiftAcceleration;
-	float CurrentLerpTime;
+	FGravityLandingPredictor LandingPredictor;
+	uint32 LandingSolutionSerial = 0;
+
+	UPROPERTY(ReplicatedUsing = OnRep_ShiftNetState)
+	FGravityShiftNetState ShiftNetState;
+
+	/** Packed state each open proxy channel was last sent, on the server, to count what each connection receives */
+	TMap<TWeakObjectPtr<UNetConnection>, uint32> SentNetStates;
+	uint64 SentNetStateBits = 0;
+	double SentNetStateStartTime = 0;
+
+	FGravityShiftTickFunction GravityTick;
+
+	/** Distance in cm at which a shifter stops being significant to a viewer */
+	UPROPERTY(EditAnywhere, Category = GravityShift)
+	float SignificanceDistance = 6000;
+
+	/** Player input since the last ConsumeRecordedInput, sampled by UGravityShiftRecorderComponent */
+	FVector2D RecordedMove = FVector2D::ZeroVector;
+	FVector2D RecordedLook = FVector2D::ZeroVector;
+	uint8 RecordedActions = 0;
 
 public:
-	AProtoGravityShiftCharacter();
+	AProtoGravityShiftCharacter(const FObjectInitializer& ObjectInitializer);
 
 public:
 	/** Returns CameraBoom subobject **/
-	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
+	FORCEINLINE UGravityCameraBoom* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
+	/** Returns GravityMovement subobject **/
+	FORCEINLINE UGravityShiftMovementComponent* GetGravityMovement() const { return GravityMovement; }
+	/** Returns StasisField subobject **/
+	FORCEINLINE UGravityStasisComponent* GetStasisField() const { return StasisField; }
+	/** Returns ShiftStreamingSource subobject **/
+	FORCEINLINE UGravityStreamingSourceComponent* GetShiftStreamingSource() const { return ShiftStreamingSource; }
+
+	FORCEINLINE const FVector& GetGravityDirection() const { return GravityDirection; }
+	FORCEINLINE const FVector& GetWallNormal() const { return WallNormal; }
+
+	/** Starts a shift along direction instead of the camera aim, for scripted and simulated shifters */
+	void EnterAccelerationTowards(const FVector& direction);
+
+	/**
+	 * Puts the character in state from wherever it stands, without replaying the transitions that lead there.
+	 * Nothing is recorded or announced and nothing blends, for corrections and replicated state
+	 */
+	void RestoreShiftState(EShiftState state, const FVector& gravityDirection);
+
+	/**
+	 * Bits of replicated shift state sent to simulated proxies since the last call, over the seconds since the first
+	 * of them, and the number of connections it is currently sent to
+	 */
+	uint64 TakeReplicatedStateBits(double& outSeconds, int32& outConnections);
+
+	/** Server side of a shift the owning client predicted. Wall contacts are left to the server's own simulation */
+	void ApplyShiftRequest(EShiftState requestedState, const FVector& gravityDirection);
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Counts the shift state about to go out to each simulated proxy connection, see GravityShift.NetReport */
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	/** Work that only matters while shifting, run by GravityTick */
+	void TickGravityShift(float deltaTime);
+
+	/** Lowers the gravity tick and wall probe rates of shifters that matter less to the viewers, 1 is full rate */
+	void ApplySignificance(float significance);
+
+	FORCEINLINE float GetSignificanceDistance() const { return SignificanceDistance; }
+
+	/**
+	 * One frame of scripted or recorded input, played the way the bindings and the character Blueprint play it.
+	 * Actions are GravityShiftRecording flags, and a shift goes along shiftDirection rather than the camera aim
+	 */
+	void PlayInput(const FVector2D& move, uint8 actions, const FVector& shiftDirection);
+
+	/** Hands the input recorded since the last call over to a recorder, then clears it */
+	void ConsumeRecordedInput(FVector2D& outMove, FVector2D& outLook, uint8& outActions);
+
+	/** Speeds the surface navigation graph costs this character's paths with */
+	FGravityNavAgent GetSurfaceNavAgent() const;
+
+	/** Path over floors, walls and ceilings to goal, searched off the game thread. False without a navigation graph */
+	bool FindSurfacePath(const FVector& goal, FOnGravityNavPathFound onFound) const;
 
 protected:
 
@@ -135,8 +327,7 @@ protected:
 	// To add mapping context
 	virtual void BeginPlay();
 
-	// Called every frame
-	virtual void Tick(float deltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	/** Called for movement input */
 	void Move(const FInputActionValue& Value);
@@ -144,12 +335,32 @@ protected:
 	/** Called for looking input */
 	void Look(const FInputActionValue& Value);
 
+	/** Called for shift input */
+	void Shift();
+
+	/** Called for cancel input */
+	void CancelShift();
+
 private:
 
 	UFUNCTION(BlueprintCallable, Category = GravityShift)
 	void GoBackToGround();
 
-	void ResetMeshRotation();
+	void ResetMeshRotation(float duration);
+
+	/** Gravity of the field the character stands in, sampled by UGravityFieldSubsystem. False outside every field */
+	bool GetFieldGravity(FVector& outGravity) const;
+
+	void HideMarkers();
+
+	/** Notes a shift or cancel from the local player for the recorder, see GravityShiftRecording */
+	void RecordAction(uint8 action);
+
+	/** Bookkeeping shared by every transition: stats, then RefreshShiftState */
+	void OnShiftStateChanged(EGravityShiftEvent event);
+
+	/** Brings replication, the gravity tick and the streaming prediction in line with ShiftState */
+	void RefreshShiftState();
 
 	UFUNCTION(BlueprintCallable, Category = GravityShift)
 	void EnterLevitating();
@@ -157,25 +368,52 @@ private:
 	UFUNCTION(BlueprintCallable, Category = GravityShift)
 	void EnterAcceleration();
 
+	/** Launches the stasis field's bodies towards the camera aim, like a shift */
+	UFUNCTION(BlueprintCallable, Category = GravityShift)
+	void LaunchStasisField();
+
 	FVector CalculateGravityDirection();
 
+	/** Takes in the aim probe's result if one came in since the last call */
+	void ConsumeAimProbe();
 
-	UFUNCTION(BlueprintCallable, Category = GravityShift)
+	void UpdateAimProbe();
+
+	/** Commits the buffered shift press if the current state allows it, false while it still waits */
+	bool TryCommitShiftInput();
+
+	void UpdateLandingPrediction();
+
+	/** Where the current shift will stop, as far as the landing predictor knows */
+	float GetPredictedShiftDistance() const;
+
+
+	UFUNCTION(BlueprintCallable, Category = GravityShift, meta = (DeprecatedFunction, DeprecationMessage = "The shift is integrated by GravityShiftMovementComponent, remove this call from the tick graph."))
 	void ShiftAccelerating(float deltaTime);
 
-	UFUNCTION(BlueprintCallable, Category = GravityShift)
+	UFUNCTION(BlueprintCallable, Category = GravityShift, meta = (DeprecatedFunction, DeprecationMessage = "Wall adhesion runs in GravityShiftMovementComponent, remove this call from the tick graph."))
 	void ApplyWallGravity(float deltaTime);
 
+	void OnShiftSurfaceHit(const FHitResult& hitInfo);
+
+	void OnWallContactLost();
+
 
 	UFUNCTION(BlueprintCallable, Category = GravityShift)
 	void AdjustToWall(FHitResult hitInfo);
 
+	/** Stands the capsule and mesh on the wall of hitInfo, blending over the durations. AdjustToWall without the state change */
+	void ApplyWallContact(const FHitResult& hitInfo, float capsuleDuration, float meshDuration);
+
 	UFUNCTION(BlueprintCallable, Category = GravityShift)
 	void MoveOnWall(FVector2D inputVector, FVector forward, FVector right, FVector normal, FRotator wallRotator);
 
 	void OrientMeshToWall(FVector2D inputVector, FVector forward, FVector right, FVector normal, FRotator wallRotator);
 
+	/** The mesh's anim instance when it turns the mesh on walls itself, see UGravityShiftAnimInstance */
+	class UGravityShiftAnimInstance* GetGravityAnimInstance() const;
+
 	UFUNCTION()
-	void UpdateCameraOffsetTimeline(float output);
+	void OnRep_ShiftNetState();
 };
 
@@ -0,0 +1,254 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityMarkerLayer.h"
+#include "Debugging/SlateDebugging.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Input/HittestGrid.h"
+#include "Misc/AutomationTest.h"
+#include "Rendering/DrawElements.h"
+#include "Widgets/SInvalidationPanel.h"
+#include "Widgets/SOverlay.h"
+#include "Widgets/SVirtualWindow.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_SLATE_DEBUGGING
+
+// A 1080p viewport split between four players, watching targets levitate and shift on and off
+static const FVector2D MarkerTestViewportSize(1920, 1080);
+static constexpr int32 MarkerTestPlayers = 4;
+static constexpr int32 MarkerTestTargets = 64;
+static constexpr int32 MarkerTestFrames = 240;
+static constexpr int32 MarkerTestMinShownFrames = 30;
+static constexpr int32 MarkerTestMaxShownFrames = 120;
+static constexpr float MarkerTestDriftPerFrame = 2;
+static constexpr float MarkerTestFrameTime = 1.0f / 60.0f;
+
+namespace
+{
+	/** Which targets are shown on each frame and where each player sees them, the same for every pass */
+	struct FMarkerScript
+	{
+		TArray<bool> Shown;
+		TArray<FVector2D> Positions;
+
+		bool IsShown(int32 frame, int32 target) const { return Shown[(frame * MarkerTestTargets) + target]; }
+		const FVector2D& GetPosition(int32 frame, int32 target, int32 player) const
+		{
+			return Positions[(((frame * MarkerTestTargets) + target) * MarkerTestPlayers) + player];
+		}
+	};
+
+	FMarkerScript MakeMarkerScript(int32 seed)
+	{
+		FRandomStream random(seed);
+		const FVector2D viewSize = MarkerTestViewportSize * 0.5f;
+
+		FMarkerScript script;
+		script.Shown.SetNumZeroed(MarkerTestFrames * MarkerTestTargets);
+		script.Positions.SetNumUninitialized(MarkerTestFrames * MarkerTestTargets * MarkerTestPlayers);
+		for (int32 target = 0; target < MarkerTestTargets; target++)
+		{
+			bool bShown = false;
+			int32 framesLeft = random.RandRange(1, MarkerTestMaxShownFrames);
+			const bool bMoving = random.FRand() < 0.5f;
+			FVector2D targetPositions[MarkerTestPlayers];
+			for (int32 player = 0; player < MarkerTestPlayers; player++)
+			{
+				const FVector2D viewOrigin((player % 2) * viewSize.X, (player / 2) * viewSize.Y);
+				targetPositions[player] = viewOrigin + FVector2D(random.FRand() * viewSize.X, random.FRand() * viewSize.Y);
+			}
+
+			for (int32 frame = 0; frame < MarkerTestFrames; frame++)
+			{
+				if (--framesLeft <= 0)
+				{
+					bShown = !bShown;
+					framesLeft = random.RandRange(MarkerTestMinShownFrames, MarkerTestMaxShownFrames);
+				}
+				script.Shown[(frame * MarkerTestTargets) + target] = bShown;
+				for (int32 player = 0; player < MarkerTestPlayers; player++)
+				{
+					if (bMoving)
+					{
+						targetPositions[player] += FVector2D(random.FRandRange(-1, 1), random.FRandRange(-1, 1)) * MarkerTestDriftPerFrame;
+					}
+					script.Positions[(((frame * MarkerTestTargets) + target) * MarkerTestPlayers) + player] = targetPositions[player];
+				}
+			}
+		}
+		return script;
+	}
+
+	/** Hosts content in an invalidation panel inside a virtual window, the way the marker subsystem adds it to the viewport */
+	class FMarkerTestWindow
+	{
+	public:
+		explicit FMarkerTestWindow(const TSharedRef<SWidget>& content)
+		{
+			Window = SNew(SVirtualWindow).Size(MarkerTestViewportSize);
+			Window->SetContent(SNew(SInvalidationPanel)[content]);
+		}
+
+		/** One Slate frame: invalidation, prepass, then the paint that also ticks the widgets */
+		void DrawFrame()
+		{
+			Time += MarkerTestFrameTime;
+			Window->ProcessWindowInvalidation();
+			Window->SlatePrepass(1.0f);
+
+			const FGeometry geometry = FGeometry::MakeRoot(MarkerTestViewportSize, FSlateLayoutTransform());
+			FSlateWindowElementList elements(Window);
+			FPaintArgs paintArgs(nullptr, HittestGrid, FVector2D::ZeroVector, Time, MarkerTestFrameTime);
+			Window->Paint(paintArgs, geometry, FSlateRect(FVector2D::ZeroVector, MarkerTestViewportSize), elements, 0, FWidgetStyle(), true);
+		}
+
+	private:
+		TSharedPtr<SVirtualWindow> Window;
+		FHittestGrid HittestGrid;
+		double Time = 0;
+	};
+
+	/** Counts the widget invalidations Slate reports that make it lay widgets out again */
+	class FLayoutInvalidationCounter
+	{
+	public:
+		FLayoutInvalidationCounter()
+		{
+			Handle = FSlateDebugging::WidgetInvalidateEvent.AddLambda([this](const FSlateDebuggingInvalidateArgs& args)
+			{
+				if (EnumHasAnyFlags(args.InvalidateWidgetReason, EInvalidateWidgetReason::Layout | EInvalidateWidgetReason::Visibility | EInvalidateWidgetReason::ChildOrder))
+				{
+					Count++;
+				}
+			});
+		}
+
+		~FLayoutInvalidationCounter()
+		{
+			FSlateDebugging::WidgetInvalidateEvent.Remove(Handle);
+		}
+
+		int32 Count = 0;
+
+	private:
+		FDelegateHandle Handle;
+	};
+}
+
+// Commandlets and dedicated servers have no Slate to draw with
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGravityMarkerLayerLayoutTest, "ProtoGravityShift.Markers.PooledLayerLayout",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FGravityMarkerLayerLayoutTest::RunTest(const FString& Parameters)
+{
+	if (!FSlateApplication::IsInitialized())
+	{
+		AddError(TEXT("Slate is not initialized, the marker layout can't be checked"));
+		return false;
+	}
+
+	const FMarkerScript script = MakeMarkerScript(0);
+	FSlateBrush brush;
+	brush.ImageSize = FVector2D(32, 32);
+	const FVector2D halfSize = FVector2D(brush.ImageSize) * 0.5f;
+
+	// Pooled layer: every frame places what is shown, players see their own target as a landing and the rest as telegraphs
+	TSharedRef<SGravityMarkerLayer> layer = SNew(SGravityMarkerLayer);
+	for (int32 kind = 0; kind < (int32)EGravityMarkerKind::Num; kind++)
+	{
+		layer->SetBrush((EGravityMarkerKind)kind, &brush);
+	}
+	FMarkerTestWindow layerWindow(layer);
+	auto drawLayer = [&](int32 frame)
+	{
+		layer->BeginUpdate();
+		for (int32 player = 0; player < MarkerTestPlayers; player++)
+		{
+			for (int32 target = 0; target < MarkerTestTargets; target++)
+			{
+				if (script.IsShown(frame, target))
+				{
+					layer->PlaceMarker(target == player ? EGravityMarkerKind::Landing : EGravityMarkerKind::Telegraph, script.GetPosition(frame, target, player));
+				}
+			}
+		}
+		layer->EndUpdate();
+		layerWindow.DrawFrame();
+	};
+
+	// The per-character overlay it replaced: one widget per target and player, shown and hidden with every state change
+	TSharedRef<SOverlay> overlay = SNew(SOverlay);
+	TArray<TSharedRef<SGravityMarker>> widgets;
+	for (int32 i = 0; i < MarkerTestTargets * MarkerTestPlayers; i++)
+	{
+		TSharedRef<SGravityMarker> widget = SNew(SGravityMarker).Brush(&brush);
+		widget->SetVisibility(EVisibility::Hidden);
+		overlay->AddSlot().HAlign(HAlign_Left).VAlign(VAlign_Top)[widget];
+		widgets.Add(widget);
+	}
+	FMarkerTestWindow overlayWindow(overlay);
+	auto drawOverlay = [&](int32 frame)
+	{
+		for (int32 target = 0; target < MarkerTestTargets; target++)
+		{
+			const bool bShown = script.IsShown(frame, target);
+			const bool bWasShown = script.IsShown(frame > 0 ? frame - 1 : MarkerTestFrames - 1, target);
+			for (int32 player = 0; player < MarkerTestPlayers; player++)
+			{
+				const TSharedRef<SGravityMarker>& widget = widgets[(target * MarkerTestPlayers) + player];
+				if (bShown != bWasShown)
+				{
+					widget->SetVisibility(bShown ? EVisibility::HitTestInvisible : EVisibility::Hidden);
+				}
+				if (bShown)
+				{
+					widget->SetRenderTransform(FSlateRenderTransform(FVector2f(script.GetPosition(frame, target, player) - halfSize)));
+				}
+			}
+		}
+		overlayWindow.DrawFrame();
+	};
+
+	// The first run through the script grows the pools to their final size
+	for (int32 frame = 0; frame < MarkerTestFrames; frame++)
+	{
+		drawLayer(frame);
+		drawOverlay(frame);
+	}
+
+	int32 layerLayouts = 0;
+	int32 layerPoolGrowths = 0;
+	int32 layerTransformUpdates = 0;
+	{
+		FLayoutInvalidationCounter counter;
+		for (int32 frame = 0; frame < MarkerTestFrames; frame++)
+		{
+			drawLayer(frame);
+			layerPoolGrowths += layer->GetNumPoolGrowths();
+			layerTransformUpdates += layer->GetNumTransformUpdates();
+		}
+		layerLayouts = counter.Count;
+	}
+
+	int32 overlayLayouts = 0;
+	{
+		FLayoutInvalidationCounter counter;
+		for (int32 frame = 0; frame < MarkerTestFrames; frame++)
+		{
+			drawOverlay(frame);
+		}
+		overlayLayouts = counter.Count;
+	}
+
+	AddInfo(FString::Printf(TEXT("Layout invalidations over %d frames: pooled layer %d (%d transform updates), per-character overlay %d"),
+		MarkerTestFrames, layerLayouts, layerTransformUpdates, overlayLayouts));
+
+	// Without the baseline seeing any, the counter isn't hearing from Slate and the pooled result means nothing
+	TestTrue(TEXT("Per-character overlay invalidates layout as markers show and hide"), overlayLayouts > 0);
+	TestEqual(TEXT("Pooled layer grows after warm-up"), layerPoolGrowths, 0);
+	TestEqual(TEXT("Pooled layer layout invalidations after warm-up"), layerLayouts, 0);
+	TestTrue(TEXT("Pooled layer moves markers"), layerTransformUpdates > 0);
+	return true;
+}
+
+#endif
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GravityMath.h"
+#include "Kismet/KismetMathLibrary.h"
+
+/**
+ * The Kismet chains AdjustToWall and OrientMeshToWall were written with, next to the same
+ * orientations through GravityMath. GravityMathTests checks that they agree and the -Mode=Math
+ * benchmark times them.
+ */
+namespace GravityMathReference
+{
+	/**
+	 * Random surfaces to orient on, with an input and a forward hint each. Floors, ceilings and
+	 * straight walls come up the most in play, so each gets its share.
+	 */
+	inline void MakeSamples(FRandomStream& random, int32 count, TArray<FVector>& outNormals, TArray<FVector2D>& outInputs, TArray<FVector>& outHints)
+	{
+		outNormals.Reset(count);
+		outInputs.Reset(count);
+		outHints.Reset(count);
+		for (int32 i = 0; i < count; i++)
+		{
+			switch (i % 8)
+			{
+			case 0:
+				outNormals.Add(FVector::UpVector);
+				break;
+			case 1:
+				outNormals.Add(FVector::DownVector);
+				break;
+			case 2:
+				outNormals.Add(FVector(random.FRand() < 0.5f ? 1 : -1, 0, 0));
+				break;
+			default:
+				outNormals.Add(random.GetUnitVector());
+				break;
+			}
+			const float inputAngle = random.FRandRange(-UE_PI, UE_PI);
+			outInputs.Add(FVector2D(FMath::Sin(inputAngle), FMath::Cos(inputAngle)) * random.FRandRange(0.2f, 1.0f));
+			outHints.Add(random.GetUnitVector());
+		}
+	}
+
+	/** Look, mesh wall and relative mesh rotations, as AdjustToWall used to compute them */
+	inline void KismetWallRotations(const FVector& normal, FQuat& outLook, FQuat& outMeshWall, FQuat& outMesh)
+	{
+		const FVector lookDir = FVector(normal.X, normal.Y, 0).GetSafeNormal() * -500;
+		const FRotator lookRotator = UKismetMathLibrary::FindLookAtRotation(FVector::ZeroVector, lookDir);
+		const FVector capsuleRight = UKismetMathLibrary::GetRightVector(lookRotator);
+		const FTransform transform = UKismetMathLibrary::MakeTransform(FVector::ZeroVector, lookRotator);
+		const FRotator meshWallRotator = UKismetMathLibrary::MakeRotFromZX(normal, capsuleRight * -1);
+
+		outLook = lookRotator.Quaternion();
+		outMeshWall = meshWallRotator.Quaternion();
+		outMesh = UKismetMathLibrary::InverseTransformRotation(transform, meshWallRotator).Quaternion();
+	}
+
+	inline void MathWallRotations(const FVector& normal, FQuat& outLook, FQuat& outMeshWall, FQuat& outMesh)
+	{
+		outLook = GravityMath::MakeHeadingRotation(-normal);
+		outMeshWall = GravityMath::MakeSurfaceBasis(normal, outLook.GetAxisY() * -1);
+		outMesh = GravityMath::MakeRelativeRotation(outLook, outMeshWall);
+	}
+
+	/** Mesh rotation facing the input on a wall, as OrientMeshToWall used to compute it */
+	inline FQuat KismetMeshFacing(const FVector2D& input, const FVector& forward, const FVector& right, const FVector& normal, const FRotator& wallRotator, const FQuat& parent)
+	{
+		FVector inputDirection = (right * input.X) + (forward * input.Y);
+		inputDirection.Normalize();
+		double angle = FMath::RadiansToDegrees(FMath::Acos(forward.GetSafeNormal().Dot(inputDirection.GetSafeNormal())));
+		if (FMath::Abs(input.X) > 0)
+		{
+			angle *= FMath::Sign(input.X);
+		}
+
+		const FVector adjustedWallRotation = UKismetMathLibrary::RotateAngleAxis(UKismetMathLibrary::GetForwardVector(wallRotator), angle, normal);
+		return parent.Inverse() * FRotationMatrix::MakeFromZX(normal, adjustedWallRotation).ToQuat();
+	}
+
+	inline FQuat MathMeshFacing(const FVector2D& input, const FVector& normal, const FQuat& wallRotation, const FQuat& parent)
+	{
+		return GravityMath::MakeRelativeRotation(parent, GravityMath::RotateAboutAxis(wallRotation, normal, GravityMath::InputHeading(input)));
+	}
+}
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GravityMathReference.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static constexpr int32 MathTestSamples = 4096;
+static constexpr int32 MathTestSeed = 0;
+// GravityMath may differ from the Kismet chains by rounding, not by a visible angle
+static constexpr double MathToleranceDegrees = 0.01;
+// The batch runs in float
+static constexpr double MathBatchToleranceDegrees = 0.05;
+
+/** Fails with the first few samples over tolerance and the count of the rest */
+static void TestAngularErrors(FAutomationTestBase& test, const TCHAR* what, const TArray<double>& errors, double toleranceDegrees)
+{
+	constexpr int32 maxReported = 5;
+	int32 mismatches = 0;
+	double maxError = 0;
+	for (int32 i = 0; i < errors.Num(); i++)
+	{
+		const double errorDegrees = FMath::RadiansToDegrees(errors[i]);
+		maxError = FMath::Max(maxError, errorDegrees);
+		if (errorDegrees > toleranceDegrees && ++mismatches <= maxReported)
+		{
+			test.AddError(FString::Printf(TEXT("%s: sample %d is %.4f degrees off"), what, i, errorDegrees));
+		}
+	}
+
+	test.AddInfo(FString::Printf(TEXT("%s: max error %.6f degrees over %d samples"), what, maxError, errors.Num()));
+	test.TestEqual(FString::Printf(TEXT("%s samples over %.2f degrees"), what, toleranceDegrees), mismatches, 0);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGravityMathWallRotationTest, "ProtoGravityShift.Math.WallRotation",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FGravityMathWallRotationTest::RunTest(const FString& Parameters)
+{
+	FRandomStream random(MathTestSeed);
+	TArray<FVector> normals;
+	TArray<FVector2D> inputs;
+	TArray<FVector> hints;
+	GravityMathReference::MakeSamples(random, MathTestSamples, normals, inputs, hints);
+
+	TArray<double> errors;
+	for (const FVector& normal : normals)
+	{
+		FQuat kismetLook, kismetMeshWall, kismetMesh;
+		FQuat mathLook, mathMeshWall, mathMesh;
+		GravityMathReference::KismetWallRotations(normal, kismetLook, kismetMeshWall, kismetMesh);
+		GravityMathReference::MathWallRotations(normal, mathLook, mathMeshWall, mathMesh);
+		errors.Add(FMath::Max3(kismetLook.AngularDistance(mathLook), kismetMeshWall.AngularDistance(mathMeshWall), kismetMesh.AngularDistance(mathMesh)));
+	}
+	TestAngularErrors(*this, TEXT("AdjustToWall"), errors, MathToleranceDegrees);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGravityMathMeshFacingTest, "ProtoGravityShift.Math.MeshFacing",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FGravityMathMeshFacingTest::RunTest(const FString& Parameters)
+{
+	FRandomStream random(MathTestSeed);
+	TArray<FVector> normals;
+	TArray<FVector2D> inputs;
+	TArray<FVector> hints;
+	GravityMathReference::MakeSamples(random, MathTestSamples, normals, inputs, hints);
+
+	// On the wall AdjustToWall leaves
+	TArray<double> errors;
+	for (int32 i = 0; i < normals.Num(); i++)
+	{
+		FQuat look, meshWall, mesh;
+		GravityMathReference::MathWallRotations(normals[i], look, meshWall, mesh);
+		const FRotator wallRotator = meshWall.Rotator();
+
+		const FQuat kismetFacing = GravityMathReference::KismetMeshFacing(inputs[i], meshWall.GetAxisY(), look.GetAxisY(), normals[i], wallRotator, look);
+		const FQuat mathFacing = GravityMathReference::MathMeshFacing(inputs[i], normals[i], wallRotator.Quaternion(), look);
+		errors.Add(kismetFacing.AngularDistance(mathFacing));
+	}
+	TestAngularErrors(*this, TEXT("OrientMeshToWall"), errors, MathToleranceDegrees);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FGravityMathSurfaceBasesTest, "ProtoGravityShift.Math.SurfaceBases",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FGravityMathSurfaceBasesTest::RunTest(const FString& Parameters)
+{
+	FRandomStream random(MathTestSeed);
+	TArray<FVector> normals;
+	TArray<FVector2D> inputs;
+	TArray<FVector> hints;
+	GravityMathReference::MakeSamples(random, MathTestSamples, normals, inputs, hints);
+
+	TArray<float> normalX, normalY, normalZ, hintX, hintY, hintZ, basisX, basisY, basisZ, basisW;
+	for (TArray<float>* values : { &normalX, &normalY, &normalZ, &hintX, &hintY, &hintZ, &basisX, &basisY, &basisZ, &basisW })
+	{
+		values->SetNumZeroed(MathTestSamples);
+	}
+	for (int32 i = 0; i < MathTestSamples; i++)
+	{
+		normalX[i] = normals[i].X;
+		normalY[i] = normals[i].Y;
+		normalZ[i] = normals[i].Z;
+		hintX[i] = hints[i].X;
+		hintY[i] = hints[i].Y;
+		hintZ[i] = hints[i].Z;
+	}
+	GravityMath::MakeSurfaceBases(normalX.GetData(), normalY.GetData(), normalZ.GetData(), hintX.GetData(), hintY.GetData(), hintZ.GetData(),
+		basisX.GetData(), basisY.GetData(), basisZ.GetData(), basisW.GetData(), MathTestSamples);
+
+	TArray<double> errors;
+	for (int32 i = 0; i < MathTestSamples; i++)
+	{
+		const FQuat batchBasis = FQuat(basisX[i], basisY[i], basisZ[i], basisW[i]).GetNormalized();
+		errors.Add(GravityMath::MakeSurfaceBasis(normals[i], hints[i]).AngularDistance(batchBasis));
+	}
+	TestAngularErrors(*this, TEXT("MakeSurfaceBases"), errors, MathBatchToleranceDegrees);
+	return true;
+}
+
+#endif